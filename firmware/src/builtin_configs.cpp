@@ -0,0 +1,110 @@
+#include "builtin_configs.h"
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+const KnobConfig BUILTIN_CONFIGS[] = {
+    // int32_t num_positions;
+    // int32_t position;
+    // float position_width_radians;
+    // float detent_strength_unit;
+    // float endstop_strength_unit;
+    // float snap_point;
+    // char descriptor[50];
+    // DisplayLayout display_layout;
+    // LedEffect led_effect;
+
+    {
+        0,
+        0,
+        10 * PI / 180,
+        0,
+        1,
+        1.1,
+        "Unbounded\nNo detents",
+    },
+    {
+        11,
+        0,
+        10 * PI / 180,
+        0,
+        1,
+        1.1,
+        "Bounded 0-10\nNo detents",
+        DisplayLayout::FILL,
+        LedEffect::POSITION,
+    },
+    {
+        73,
+        0,
+        10 * PI / 180,
+        0,
+        1,
+        1.1,
+        "Multi-rev\nNo detents",
+        DisplayLayout::FILL,
+        LedEffect::POSITION,
+    },
+    {
+        2,
+        0,
+        60 * PI / 180,
+        1,
+        1,
+        0.55, // Note the snap point is slightly past the midpoint (0.5); compare to normal detents which use a snap point *past* the next value (i.e. > 1)
+        "On/off\nStrong detent",
+    },
+    {
+        1,
+        0,
+        60 * PI / 180,
+        0.01,
+        0.6,
+        1.1,
+        "Return-to-center",
+        DisplayLayout::FILL,
+        LedEffect::POSITION,
+    },
+    {
+        256,
+        127,
+        1 * PI / 180,
+        0,
+        1,
+        1.1,
+        "Fine values\nNo detents",
+    },
+    {
+        256,
+        127,
+        1 * PI / 180,
+        1,
+        10,
+        1.1,
+        "Fine values\nWith detents",
+    },
+    {
+        32,
+        0,
+        8.225806452 * PI / 180,
+        2,
+        10,
+        1.1,
+        "Coarse values\nStrong detents",
+        DisplayLayout::DIAL,
+        LedEffect::POSITION,
+    },
+    {
+        32,
+        0,
+        8.225806452 * PI / 180,
+        0.2,
+        10,
+        1.1,
+        "Coarse values\nWeak detents",
+        DisplayLayout::DIAL,
+    },
+};
+
+const uint8_t BUILTIN_CONFIG_COUNT = sizeof(BUILTIN_CONFIGS) / sizeof(BUILTIN_CONFIGS[0]);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "knob_data.h"
+
+// Built-in configs, used unless a config library has been uploaded to flash (see ConfigLibraryStore). Config ids
+// number them from 1.
+extern const KnobConfig BUILTIN_CONFIGS[];
+extern const uint8_t BUILTIN_CONFIG_COUNT;
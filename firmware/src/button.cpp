@@ -0,0 +1,47 @@
+#include "button.h"
+
+// Edges within this long of the last accepted change are treated as contact bounce
+static const uint32_t DEBOUNCE_MILLIS = 20;
+
+Button::Button(uint8_t pin, uint32_t notify_bits) : pin_(pin), notify_bits_(notify_bits) {}
+
+void Button::begin(TaskHandle_t task) {
+    task_ = task;
+    // GPIO 34 and up are input only, without internal pull-ups
+    pinMode(pin_, pin_ >= 34 ? INPUT : INPUT_PULLUP);
+    pressed_ = digitalRead(pin_) == LOW;
+    attachInterruptArg(digitalPinToInterrupt(pin_), onEdge, this, CHANGE);
+}
+
+ButtonEvent Button::update(uint32_t now_millis) {
+    bool pressed = digitalRead(pin_) == LOW;
+    if (pressed == pressed_) {
+        needs_recheck_ = false;
+        return ButtonEvent::NONE;
+    }
+    if (now_millis - last_change_millis_ < DEBOUNCE_MILLIS) {
+        needs_recheck_ = true;
+        return ButtonEvent::NONE;
+    }
+    needs_recheck_ = false;
+    pressed_ = pressed;
+    last_change_millis_ = now_millis;
+    return pressed ? ButtonEvent::PRESSED : ButtonEvent::RELEASED;
+}
+
+bool Button::needsRecheck() {
+    return needs_recheck_;
+}
+
+uint32_t Button::getRecheckMillis() {
+    return last_change_millis_ + DEBOUNCE_MILLIS;
+}
+
+void IRAM_ATTR Button::onEdge(void* arg) {
+    Button* button = static_cast<Button*>(arg);
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(button->task_, button->notify_bits_, eSetBits, &woken);
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
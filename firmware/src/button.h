@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+
+enum class ButtonEvent : uint8_t {
+    NONE,
+    PRESSED,
+    RELEASED,
+};
+
+// Active-low button read from a GPIO edge interrupt. The interrupt only notifies a task (setting notify_bits in
+// its notification value); the task then calls update(), which reports a press on the very first edge and ignores
+// further edges for the debounce time. If an edge was ignored, the task must call update() again at
+// getRecheckMillis() so the final level isn't missed.
+class Button {
+    public:
+        Button(uint8_t pin, uint32_t notify_bits);
+
+        void begin(TaskHandle_t task);
+
+        ButtonEvent update(uint32_t now_millis);
+
+        bool needsRecheck();
+        uint32_t getRecheckMillis();
+
+    private:
+        const uint8_t pin_;
+        const uint32_t notify_bits_;
+        TaskHandle_t task_ = nullptr;
+
+        bool pressed_ = false;
+        uint32_t last_change_millis_ = 0;
+        bool needs_recheck_ = false;
+
+        static void IRAM_ATTR onEdge(void* arg);
+};
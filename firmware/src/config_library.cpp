@@ -0,0 +1,113 @@
+#include <string.h>
+
+#include "config_library.h"
+#include "protocol.h"
+
+bool ConfigLibrary::load(const uint8_t* image, size_t size) {
+    unload();
+    if (image == nullptr || size < sizeof(ConfigLibraryHeader)) {
+        return false;
+    }
+    ConfigLibraryHeader header;
+    memcpy(&header, image, sizeof(header));
+    if (!validate(header, image + sizeof(header), size - sizeof(header))) {
+        return false;
+    }
+    records_ = reinterpret_cast<const ConfigRecord*>(image + sizeof(header));
+    count_ = header.count;
+    return true;
+}
+
+void ConfigLibrary::unload() {
+    records_ = nullptr;
+    count_ = 0;
+}
+
+int32_t ConfigLibrary::find(uint32_t id) const {
+    for (uint32_t i = 0; i < count_; i++) {
+        if (records_[i].id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool ConfigLibrary::validate(const ConfigLibraryHeader& header, const uint8_t* records, size_t size) {
+    if (header.magic != CONFIG_LIBRARY_MAGIC || header.version != CONFIG_LIBRARY_VERSION || header.record_size != sizeof(ConfigRecord)) {
+        return false;
+    }
+    if (header.count == 0 || header.count > size / sizeof(ConfigRecord)) {
+        return false;
+    }
+    return crc32(records, header.count * sizeof(ConfigRecord)) == header.crc;
+}
+
+size_t ConfigLibrary::build(const ConfigRecord* records, uint32_t count, uint8_t* out, size_t out_size) {
+    size_t size = sizeof(ConfigLibraryHeader) + count * sizeof(ConfigRecord);
+    if (count == 0 || size > out_size) {
+        return 0;
+    }
+    ConfigLibraryHeader header = {
+        .magic = CONFIG_LIBRARY_MAGIC,
+        .version = CONFIG_LIBRARY_VERSION,
+        .record_size = sizeof(ConfigRecord),
+        .count = count,
+        .crc = crc32((const uint8_t*)records, count * sizeof(ConfigRecord)),
+    };
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), records, count * sizeof(ConfigRecord));
+    return size;
+}
+
+
+ConfigLibraryStore::ConfigLibraryStore(FlashRegion& flash) : flash_(flash) {}
+
+bool ConfigLibraryStore::begin() {
+    return library_.load(flash_.map(), flash_.getSize());
+}
+
+bool ConfigLibraryStore::beginUpload(uint32_t size) {
+    uploading_ = false;
+    if (size < sizeof(ConfigLibraryHeader) || size > flash_.getSize()) {
+        return false;
+    }
+    library_.unload();
+    uint32_t erase_size = (size + FlashRegion::SECTOR_SIZE - 1) / FlashRegion::SECTOR_SIZE * FlashRegion::SECTOR_SIZE;
+    if (!flash_.erase(0, erase_size)) {
+        return false;
+    }
+    memset(upload_header_, 0xFF, sizeof(upload_header_));
+    upload_size_ = size;
+    uploading_ = true;
+    return true;
+}
+
+bool ConfigLibraryStore::writeUpload(uint32_t offset, const uint8_t* data, size_t length) {
+    if (!uploading_ || offset + length > upload_size_) {
+        return false;
+    }
+    // Hold back the header so the image only becomes valid in commitUpload()
+    while (length > 0 && offset < sizeof(upload_header_)) {
+        upload_header_[offset++] = *data++;
+        length--;
+    }
+    return length == 0 || flash_.write(offset, data, length);
+}
+
+bool ConfigLibraryStore::commitUpload() {
+    if (!uploading_) {
+        return false;
+    }
+    uploading_ = false;
+
+    ConfigLibraryHeader header;
+    memcpy(&header, upload_header_, sizeof(header));
+    const uint8_t* image = flash_.map();
+    if (image == nullptr || !ConfigLibrary::validate(header, image + sizeof(header), upload_size_ - sizeof(header))) {
+        return false;
+    }
+    if (!flash_.write(0, upload_header_, sizeof(upload_header_))) {
+        return false;
+    }
+    return library_.load(flash_.map(), flash_.getSize());
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flash_region.h"
+#include "knob_data.h"
+
+// Records are stored as the in-memory KnobConfig so they can be used straight from memory-mapped flash. This pins
+// the struct layout (identical on the ESP32 and little-endian hosts); bump CONFIG_LIBRARY_VERSION if it changes.
+static_assert(sizeof(KnobConfig) == 76, "KnobConfig layout is part of the config library format");
+
+static const uint32_t CONFIG_LIBRARY_MAGIC = 0x46434B53; // "SKCF"
+static const uint16_t CONFIG_LIBRARY_VERSION = 1;
+
+struct ConfigLibraryHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t count;
+    // CRC-32 of the records that follow
+    uint32_t crc;
+};
+
+struct ConfigRecord {
+    // Stable identifier for selecting a config, independent of its position in the library
+    uint32_t id;
+    KnobConfig config;
+};
+
+// Read-only view of a config library image: a header followed by fixed-size records. load() only validates the
+// image and keeps a pointer into it, so the records are used in place without copying or parsing.
+class ConfigLibrary {
+    public:
+        // image must stay valid (e.g. memory-mapped flash) while loaded. Returns false if it isn't a valid library.
+        bool load(const uint8_t* image, size_t size);
+        void unload();
+
+        bool isLoaded() const { return records_ != nullptr; }
+        uint32_t getCount() const { return count_; }
+        const ConfigRecord& get(uint32_t index) const { return records_[index]; }
+        // Returns the index of the config with the given id, or -1
+        int32_t find(uint32_t id) const;
+
+        // Validates a header against the records following it in image (up to size bytes)
+        static bool validate(const ConfigLibraryHeader& header, const uint8_t* records, size_t size);
+
+        // Writes a complete image to out; returns its size, or 0 if it doesn't fit
+        static size_t build(const ConfigRecord* records, uint32_t count, uint8_t* out, size_t out_size);
+
+    private:
+        const ConfigRecord* records_ = nullptr;
+        uint32_t count_ = 0;
+};
+
+// Config library persisted in a flash region, with a staged upload: the records are written first and the header
+// only once they've been verified, so an interrupted upload leaves no valid library behind (and the firmware's
+// built-in configs are used instead).
+class ConfigLibraryStore {
+    public:
+        ConfigLibraryStore(FlashRegion& flash);
+
+        // Loads the stored library, if there is a valid one
+        bool begin();
+        const ConfigLibrary& getLibrary() const { return library_; }
+
+        // Unloads the current library and erases enough of the region for an image of the given size. An image that
+        // can't fit is refused up front, leaving the current library loaded.
+        bool beginUpload(uint32_t size);
+        // Image bytes at the given offset; the header part is held back until commitUpload()
+        bool writeUpload(uint32_t offset, const uint8_t* data, size_t length);
+        // Verifies the uploaded records against the header, then writes the header and loads the new library
+        bool commitUpload();
+
+    private:
+        FlashRegion& flash_;
+        ConfigLibrary library_;
+
+        bool uploading_ = false;
+        uint32_t upload_size_ = 0;
+        uint8_t upload_header_[sizeof(ConfigLibraryHeader)] = {};
+};
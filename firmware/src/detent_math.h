@@ -0,0 +1,218 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#include "knob_data.h"
+#include "util.h"
+
+// Selects the motor loop's detent math: 1 for fixed point (FixedDetentMath), 0 for float (FloatDetentMath)
+#ifndef SK_FIXED_POINT_DETENTS
+#define SK_FIXED_POINT_DETENTS 0
+#endif
+
+// Half width of the zone around a detent center in which the detent applies no torque: a fraction of the detent width,
+// up to a limit
+static const float DEAD_ZONE_DETENT_PERCENT = 0.2;
+static const float DEAD_ZONE_RAD = 1 * 3.14159265f / 180;
+
+// How far from a detent center the knob may rest and still have the center pulled to it, and how fast
+static const float IDLE_CORRECTION_MAX_ANGLE_RAD = 5 * 3.14159265f / 180;
+static const float IDLE_CORRECTION_RATE_ALPHA = 0.0005;
+
+// One turn: the same float SimpleFOC's sensors wrap their angle at
+static const float KNOB_TURN_RADIANS = 6.28318530718f;
+
+// An angle on the knob as whole turns plus the angle into the turn. Unlike a float angle that keeps growing (such as
+// motor.shaft_angle), it's as precise after a million turns as in the first.
+struct KnobAngle {
+    int32_t turns;
+    // [0, KNOB_TURN_RADIANS)
+    float radians;
+};
+
+// Normalizes radians into the turn. Only meant for radians within a turn or so of it.
+static inline KnobAngle makeKnobAngle(int32_t turns, float radians) {
+    while (radians < 0) {
+        radians += KNOB_TURN_RADIANS;
+        turns--;
+    }
+    while (radians >= KNOB_TURN_RADIANS) {
+        radians -= KNOB_TURN_RADIANS;
+        turns++;
+    }
+    KnobAngle angle = {turns, radians};
+    return angle;
+}
+
+static inline KnobAngle negateKnobAngle(const KnobAngle& angle) {
+    return makeKnobAngle(-angle.turns, -angle.radians);
+}
+
+// Each math policy defines an Angle (a position on the knob), a Delta (the difference of two Angles, for the knob
+// within a turn or two of a detent center), and a Fraction to scale Deltas by, with the conversions DetentTracker
+// needs. Both keep a detent center exact to within rounding however many turns and detents the knob goes through.
+
+// Whole turns plus float radians into the turn. Moving an Angle (a detent center, each time the knob snaps to the next
+// detent) would round the radians every time, and that would add up over millions of detents, so the radians are
+// kept as a pair of floats: the angle, and what rounding it lost (error-free addition, as in double-float arithmetic).
+struct FloatDetentMath {
+    struct Angle {
+        int32_t turns;
+        float radians;
+        // Far below the precision of radians
+        float radians_low;
+    };
+    typedef float Delta;
+    typedef float Fraction;
+
+    static Angle fromKnobAngle(const KnobAngle& angle) {
+        Angle result = {angle.turns, angle.radians, 0};
+        return result;
+    }
+    static Delta deltaFromRadians(float radians) { return radians; }
+    static float toRadians(Delta delta) { return delta; }
+    static Fraction fraction(float value) { return value; }
+
+    static Delta difference(const Angle& a, const Angle& b) {
+        return (float)(a.turns - b.turns) * KNOB_TURN_RADIANS + ((a.radians - b.radians) + (a.radians_low - b.radians_low));
+    }
+    static Angle offset(Angle angle, Delta delta) {
+        add(angle, delta);
+        while (angle.radians >= KNOB_TURN_RADIANS) {
+            add(angle, -KNOB_TURN_RADIANS);
+            angle.turns++;
+        }
+        while (angle.radians < 0) {
+            add(angle, KNOB_TURN_RADIANS);
+            angle.turns--;
+        }
+        return angle;
+    }
+    static Delta scale(Delta delta, Fraction fraction) { return delta * fraction; }
+    static Delta abs(Delta delta) { return fabsf(delta); }
+
+    private:
+        // The sum of the pair and value, as a pair again
+        static void add(Angle& angle, float value) {
+            // What the first sum rounded off, exactly
+            float sum = angle.radians + value;
+            float value_part = sum - angle.radians;
+            float error = (angle.radians - (sum - value_part)) + (value - value_part);
+            error += angle.radians_low;
+            // Split the result so the low part is again below the precision of the high part
+            angle.radians = sum + error;
+            angle.radians_low = error - (angle.radians - sum);
+        }
+};
+
+static const float FIXED_DETENT_UNITS_PER_RADIAN = 16777216 / KNOB_TURN_RADIANS;
+static const float FIXED_DETENT_RADIANS_PER_UNIT = KNOB_TURN_RADIANS / 16777216;
+static const double FIXED_DETENT_FINE_UNITS_PER_RADIAN = 72057594037927936.0 / KNOB_TURN_RADIANS;
+
+// Q8.56 turns: the top 8 bits count turns, wrapping every 256, and the low 56 are the fraction of a turn. Differences
+// wrap with them, so they're exact anywhere on the knob as long as the two angles are within 128 turns of each other.
+// Angles come in from the sensor, and errors go out to the torque controller, at Q8.24 (2^24 units per turn, 0.37
+// microradian); the 32 bits below that keep the rounding of the detent width from adding up over millions of
+// detents. Float only comes in converting those; the rest is integer adds and compares.
+struct FixedDetentMath {
+    typedef uint64_t Angle;
+    typedef int64_t Delta;
+    // Q1.31
+    typedef int32_t Fraction;
+
+    static Angle fromKnobAngle(const KnobAngle& angle) {
+        return ((Angle)(uint32_t)angle.turns << 56) + ((Angle)(uint32_t)(angle.radians * FIXED_DETENT_UNITS_PER_RADIAN) << 32);
+    }
+    // In double, since the detent width needs all 56 bits; this only runs when a config is set
+    static Delta deltaFromRadians(float radians) { return (Delta)llround(radians * FIXED_DETENT_FINE_UNITS_PER_RADIAN); }
+    static float toRadians(Delta delta) { return (int32_t)(delta >> 32) * FIXED_DETENT_RADIANS_PER_UNIT; }
+    // value must be in [-1, 1)
+    static Fraction fraction(float value) { return (Fraction)lrintf(value * 2147483648.f); }
+
+    static Delta difference(Angle a, Angle b) { return (Delta)(a - b); }
+    static Angle offset(Angle angle, Delta delta) { return angle + (Angle)delta; }
+    // At Q8.24, and rounded, since idle correction applies this every iteration while the knob rests
+    static Delta scale(Delta delta, Fraction fraction) {
+        return (((int64_t)(int32_t)(delta >> 32) * fraction + (1 << 30)) >> 31) * ((int64_t)1 << 32);
+    }
+    static Delta abs(Delta delta) { return delta < 0 ? -delta : delta; }
+};
+
+// Where the knob is relative to its nearest detent, for the torque controller
+struct DetentError {
+    // Angle from the current detent's center to the knob (positive when turned toward lower positions)
+    float angle_to_center;
+    // The part of angle_to_center inside the dead zone, which the detent shouldn't push against
+    float dead_zone_adjustment;
+    // Turned past the first or last position, against an endstop
+    bool out_of_bounds;
+};
+
+// Tracks the detent the knob is in and its center, stepping the config's position as the knob is turned past each
+// detent's snap point. Everything derived from the config is worked out once in configure(), so a loop iteration is a
+// couple of compares and adds in Math's types.
+template<typename Math>
+class DetentTracker {
+    public:
+        typedef typename Math::Angle Angle;
+        typedef typename Math::Delta Delta;
+
+        DetentTracker() : center_(), width_(), snap_(), dead_zone_(),
+            idle_max_(Math::deltaFromRadians(IDLE_CORRECTION_MAX_ANGLE_RAD)),
+            idle_alpha_(Math::fraction(IDLE_CORRECTION_RATE_ALPHA)) {}
+
+        // Adopts config's detent width and snap point, with the current detent centered on angle
+        void configure(const KnobConfig& config, const KnobAngle& angle) {
+            center_ = Math::fromKnobAngle(angle);
+            width_ = Math::deltaFromRadians(config.position_width_radians);
+            snap_ = Math::deltaFromRadians(config.position_width_radians * config.snap_point);
+            dead_zone_ = Math::deltaFromRadians(
+                fminf(config.position_width_radians * DEAD_ZONE_DETENT_PERCENT, DEAD_ZONE_RAD));
+        }
+
+        // For a knob at rest: if it's close to the detent's center (but not exactly there), slowly moves the center to
+        // match where it rests
+        void correctIdle(const KnobAngle& angle) {
+            Delta error = Math::difference(Math::fromKnobAngle(angle), center_);
+            if (Math::abs(error) < idle_max_) {
+                center_ = Math::offset(center_, Math::scale(error, idle_alpha_));
+            }
+        }
+
+        // Moves to the neighbouring detent (updating config.position) if angle is past the current one's snap point
+        // and the config has a position there
+        DetentError update(const KnobAngle& angle, KnobConfig& config) {
+            Delta error = Math::difference(Math::fromKnobAngle(angle), center_);
+            if (error > snap_ && (config.num_positions <= 0 || config.position > 0)) {
+                center_ = Math::offset(center_, width_);
+                error -= width_;
+                config.position--;
+            } else if (error < -snap_ && (config.num_positions <= 0 || config.position < config.num_positions - 1)) {
+                center_ = Math::offset(center_, -width_);
+                error += width_;
+                config.position++;
+            }
+
+            DetentError result;
+            result.angle_to_center = Math::toRadians(error);
+            result.dead_zone_adjustment = Math::toRadians(CLAMP(error, (Delta)-dead_zone_, dead_zone_));
+            result.out_of_bounds = config.num_positions > 0
+                && ((error > 0 && config.position == 0) || (error < 0 && config.position == config.num_positions - 1));
+            return result;
+        }
+
+    private:
+        Angle center_;
+        Delta width_;
+        Delta snap_;
+        Delta dead_zone_;
+        Delta idle_max_;
+        typename Math::Fraction idle_alpha_;
+};
+
+#if SK_FIXED_POINT_DETENTS
+typedef DetentTracker<FixedDetentMath> Detents;
+#else
+typedef DetentTracker<FloatDetentMath> Detents;
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+// The framebuffer type that display drawing code renders into: a TFT_eSPI sprite on the device, or a
+// software canvas implementing the same subset of the API when building on a host.
+#ifdef ARDUINO
+#include <TFT_eSPI.h>
+typedef TFT_eSprite Canvas;
+#else
+#include "software_canvas.h"
+typedef SoftwareCanvas Canvas;
+#endif
+
+struct DisplayColors {
+    uint16_t background;
+    uint16_t text;
+    uint16_t arc;
+    uint16_t fill;
+    uint16_t dot;
+};
+
+struct DisplayFonts {
+    const GFXfont* value;
+    const GFXfont* description;
+};
@@ -0,0 +1,37 @@
+#if (defined(SK_DISPLAY) && (SK_DISPLAY >0))
+#include "display_layouts.h"
+
+#define COUNT_OF(A) (sizeof(A) / sizeof(A[0]))
+
+static const uint8_t DIAL_GAUGE_THICKNESS = 6;
+
+FillLayout::FillLayout(const DisplayFonts& fonts) :
+        value_(fonts.value, TFT_WIDTH / 2, TFT_HEIGHT / 2 - VALUE_OFFSET),
+        description_(fonts.description, TFT_WIDTH / 2, TFT_HEIGHT / 2 + DESCRIPTION_Y_OFFSET),
+        ring_(DRAW_ARC, 0),
+        widgets_{&fill_, &value_, &description_, &ticks_, &ring_, &pointer_} {}
+
+uint8_t FillLayout::getWidgetCount() const {
+    return COUNT_OF(widgets_);
+}
+
+Widget* FillLayout::getWidget(uint8_t index) {
+    return widgets_[index];
+}
+
+
+DialLayout::DialLayout(const DisplayFonts& fonts) :
+        gauge_(true, DIAL_GAUGE_THICKNESS),
+        value_(fonts.value, TFT_WIDTH / 2, TFT_HEIGHT / 2 - VALUE_OFFSET),
+        description_(fonts.description, TFT_WIDTH / 2, TFT_HEIGHT / 2 + DESCRIPTION_Y_OFFSET),
+        widgets_{&gauge_, &value_, &description_, &ticks_, &pointer_} {}
+
+uint8_t DialLayout::getWidgetCount() const {
+    return COUNT_OF(widgets_);
+}
+
+Widget* DialLayout::getWidget(uint8_t index) {
+    return widgets_[index];
+}
+
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+
+#if (defined(SK_DISPLAY) && (SK_DISPLAY >0))
+
+#include "widgets.h"
+
+// A fixed set of widgets, in back-to-front drawing order.
+class Layout {
+    public:
+        virtual ~Layout() {};
+
+        virtual uint8_t getWidgetCount() const = 0;
+        virtual Widget* getWidget(uint8_t index) = 0;
+};
+
+// Fill level behind the value, with a thin ring outline (if DRAW_ARC) and endstop ticks.
+class FillLayout : public Layout {
+    public:
+        FillLayout(const DisplayFonts& fonts);
+
+        uint8_t getWidgetCount() const override;
+        Widget* getWidget(uint8_t index) override;
+
+    private:
+        FillBar fill_;
+        ValueLabel value_;
+        TextBlock description_;
+        TickMarks ticks_;
+        ArcGauge ring_;
+        PointerDot pointer_;
+
+        Widget* widgets_[6];
+};
+
+// Progress arc around the edge of the display instead of a fill.
+class DialLayout : public Layout {
+    public:
+        DialLayout(const DisplayFonts& fonts);
+
+        uint8_t getWidgetCount() const override;
+        Widget* getWidget(uint8_t index) override;
+
+    private:
+        ArcGauge gauge_;
+        ValueLabel value_;
+        TextBlock description_;
+        TickMarks ticks_;
+        PointerDot pointer_;
+
+        Widget* widgets_[5];
+};
+
+#endif
@@ -0,0 +1,103 @@
+#if (defined(SK_DISPLAY) && (SK_DISPLAY >0))
+#include "display_renderer.h"
+
+#include <algorithm>
+
+static const Rect SCREEN_RECT = {0, 0, TFT_WIDTH, TFT_HEIGHT};
+
+void DisplayRenderer::setLayout(Layout* layout) {
+    if (layout != layout_) {
+        layout_ = layout;
+        full_redraw_ = true;
+    }
+}
+
+void DisplayRenderer::invalidate() {
+    full_redraw_ = true;
+}
+
+void DisplayRenderer::update(const KnobState& state) {
+    if (layout_ == nullptr) {
+        return;
+    }
+    for (uint8_t i = 0; i < layout_->getWidgetCount(); i++) {
+        layout_->getWidget(i)->update(state);
+    }
+}
+
+uint8_t DisplayRenderer::render(Canvas& canvas, const DisplayColors& colors) {
+    region_count_ = 0;
+    if (layout_ == nullptr) {
+        return 0;
+    }
+
+    uint8_t widget_count = layout_->getWidgetCount();
+    for (uint8_t i = 0; i < widget_count; i++) {
+        Widget* widget = layout_->getWidget(i);
+        if (full_redraw_) {
+            widget->clearDirty();
+        } else {
+            addDirtyRegion(widget->getDirty());
+            widget->clearDirty();
+        }
+    }
+    if (full_redraw_) {
+        addDirtyRegion(SCREEN_RECT);
+        full_redraw_ = false;
+    }
+
+    for (uint8_t r = 0; r < region_count_; r++) {
+        const Rect& region = regions_[r];
+        canvas.setViewport(region.x, region.y, region.w, region.h, false);
+        canvas.fillRect(region.x, region.y, region.w, region.h, colors.background);
+        for (uint8_t i = 0; i < widget_count; i++) {
+            Widget* widget = layout_->getWidget(i);
+            if (widget->getBounds().intersects(region)) {
+                widget->draw(canvas, colors);
+            }
+        }
+    }
+    canvas.resetViewport();
+    return region_count_;
+}
+
+const Rect& DisplayRenderer::getDirtyRegion(uint8_t index) const {
+    return regions_[index];
+}
+
+// Adds an area to the redraw list, merging it into an overlapping region if there is one, or otherwise (once the
+// list is full) into whichever region grows the least.
+void DisplayRenderer::addDirtyRegion(const Rect& area) {
+    int16_t x0 = std::max<int16_t>(area.x, 0);
+    int16_t y0 = std::max<int16_t>(area.y, 0);
+    int16_t x1 = std::min<int16_t>(area.x + area.w, TFT_WIDTH);
+    int16_t y1 = std::min<int16_t>(area.y + area.h, TFT_HEIGHT);
+    Rect clipped = {x0, y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0)};
+    if (clipped.isEmpty()) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < region_count_; i++) {
+        if (regions_[i].intersects(clipped)) {
+            regions_[i] = regions_[i].merge(clipped);
+            return;
+        }
+    }
+    if (region_count_ < MAX_DIRTY_REGIONS) {
+        regions_[region_count_++] = clipped;
+        return;
+    }
+
+    uint8_t best = 0;
+    int32_t best_growth = INT32_MAX;
+    for (uint8_t i = 0; i < region_count_; i++) {
+        int32_t growth = regions_[i].merge(clipped).area() - regions_[i].area();
+        if (growth < best_growth) {
+            best = i;
+            best_growth = growth;
+        }
+    }
+    regions_[best] = regions_[best].merge(clipped);
+}
+
+#endif
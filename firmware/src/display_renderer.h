@@ -0,0 +1,38 @@
+#pragma once
+
+#if (defined(SK_DISPLAY) && (SK_DISPLAY >0))
+
+#include "display_canvas.h"
+#include "display_layouts.h"
+#include "knob_data.h"
+
+// Draws the widgets of the active layout into a canvas, redrawing only areas that widgets have invalidated.
+// This has no dependencies on the display hardware or FreeRTOS, so it can run against a software canvas on a
+// host as well as on the device.
+class DisplayRenderer {
+    public:
+        static const uint8_t MAX_DIRTY_REGIONS = 4;
+
+        // Switches layouts; the whole screen is redrawn on the next render()
+        void setLayout(Layout* layout);
+        // Redraws the whole screen on the next render()
+        void invalidate();
+
+        void update(const KnobState& state);
+
+        // Redraws invalidated areas and returns how many regions were redrawn. They can be read back with
+        // getDirtyRegion() (e.g. to push just those areas to the display) until the next call.
+        uint8_t render(Canvas& canvas, const DisplayColors& colors);
+        const Rect& getDirtyRegion(uint8_t index) const;
+
+    private:
+        Layout* layout_ = nullptr;
+        bool full_redraw_ = true;
+
+        Rect regions_[MAX_DIRTY_REGIONS];
+        uint8_t region_count_ = 0;
+
+        void addDirtyRegion(const Rect& area);
+};
+
+#endif
@@ -1,12 +1,46 @@
 #if (defined(SK_DISPLAY) && (SK_DISPLAY >0))
 #include "display_task.h"
+#include "heap_monitor.h"
+#include "latency_trace.h"
+#include "logger.h"
+#include "profiler.h"
 #include "semaphore_guard.h"
+#include "util.h"
 
 #include "font/roboto_light_60.h"
 
 static const uint8_t LEDC_CHANNEL_LCD_BACKLIGHT = 0;
 
-DisplayTask::DisplayTask(const uint8_t task_core) : Task{"Display", 4048, 1, task_core} {
+
+static const float FRAME_LATENCY_EWMA_ALPHA = 0.1;
+// Never extrapolate further than this past the last reported state (e.g. if the motor task stops publishing)
+static const uint32_t MAX_EXTRAPOLATION_MICROS = 50000;
+// Below this speed (in positions per second) the knob is considered to be settling rather than spinning
+static const float SETTLED_VELOCITY_UNIT = 0.5;
+// Fraction of the way to the reported sub-position the pointer eases in each SETTLE_PERIOD_MICROS, however many frames
+// that takes
+static const float SETTLE_ALPHA = 0.4;
+static const uint32_t SETTLE_PERIOD_MICROS = 20000;
+static const float SETTLE_EPSILON_UNIT = 0.005;
+
+#if SK_DISPLAY_COLOR_DEPTH == 4
+// Palette indices for the 4-bit framebuffer. Drawing calls take these in place of RGB565 colors, and the
+// palette is used to expand each pixel back to RGB565 when the sprite is pushed.
+enum PaletteIndex : uint8_t {
+  PALETTE_BLACK = 0,
+  PALETTE_WHITE,
+  PALETTE_DARKGREY,
+  PALETTE_FILL,
+  PALETTE_DOT,
+};
+#endif
+
+static const DisplayFonts FONTS = {
+  .value = &Roboto_Light_60,
+  .description = &DESCRIPTION_FONT,
+};
+
+DisplayTask::DisplayTask(const uint8_t task_core) : Task{"Display", task_core}, fill_layout_(FONTS), dial_layout_(FONTS) {
   knob_state_queue_ = xQueueCreate(1, sizeof(KnobState));
   assert(knob_state_queue_ != NULL);
 
@@ -86,110 +120,91 @@ void DisplayTask::run() {
     ledcAttachPin(PIN_LCD_BACKLIGHT, LEDC_CHANNEL_LCD_BACKLIGHT);
     ledcWrite(LEDC_CHANNEL_LCD_BACKLIGHT, UINT16_MAX);
 
-    spr_.setColorDepth(16);
+    spr_.setColorDepth(SK_DISPLAY_COLOR_DEPTH);
 
     if (spr_.createSprite(TFT_WIDTH, TFT_HEIGHT) == nullptr) {
-      Serial.println("ERROR: sprite allocation failed!");
+      LOG_ERROR("Sprite allocation failed!");
       tft_.fillScreen(TFT_RED);
     } else {
-      Serial.println("Sprite created!");
+      // Compare render and push times across color depths with the profile report (skctl profile)
+      LOG_INFO("Sprite created: %d-bit, %u bytes", SK_DISPLAY_COLOR_DEPTH, (unsigned)(TFT_WIDTH * TFT_HEIGHT * SK_DISPLAY_COLOR_DEPTH / 8));
       tft_.fillScreen(TFT_PURPLE);
     }
-    spr_.setTextColor(0xFFFF, TFT_BLACK);
-    
-    KnobState state;
 
-    const int RADIUS = TFT_WIDTH / 2;
-    const uint16_t FILL_COLOR = spr_.color565(90, 18, 151);
-    const uint16_t DOT_COLOR = spr_.color565(80, 100, 200);
+    #if SK_DISPLAY_COLOR_DEPTH == 4
+      uint16_t palette[16] = {};
+      palette[PALETTE_BLACK] = TFT_BLACK;
+      palette[PALETTE_WHITE] = TFT_WHITE;
+      palette[PALETTE_DARKGREY] = TFT_DARKGREY;
+      palette[PALETTE_FILL] = tft_.color565(90, 18, 151);
+      palette[PALETTE_DOT] = tft_.color565(80, 100, 200);
+      spr_.createPalette(palette, 16);
+
+      const uint16_t BACKGROUND_COLOR = PALETTE_BLACK;
+      const uint16_t TEXT_COLOR = PALETTE_WHITE;
+      const uint16_t ARC_COLOR = PALETTE_DARKGREY;
+      const uint16_t FILL_COLOR = PALETTE_FILL;
+      const uint16_t DOT_COLOR = PALETTE_DOT;
+    #else
+      const uint16_t BACKGROUND_COLOR = TFT_BLACK;
+      const uint16_t TEXT_COLOR = TFT_WHITE;
+      const uint16_t ARC_COLOR = TFT_DARKGREY;
+      const uint16_t FILL_COLOR = spr_.color565(90, 18, 151);
+      const uint16_t DOT_COLOR = spr_.color565(80, 100, 200);
+    #endif
+    spr_.setTextColor(TEXT_COLOR, BACKGROUND_COLOR);
 
-    int32_t pointer_center_x = TFT_WIDTH / 2;
-    int32_t pointer_center_y = TFT_HEIGHT / 2;
-    int32_t pointer_length_short = 10;
-    int32_t pointer_length_long = TFT_WIDTH / 2 - 5;
+    const DisplayColors colors = {
+      .background = BACKGROUND_COLOR,
+      .text = TEXT_COLOR,
+      .arc = ARC_COLOR,
+      .fill = FILL_COLOR,
+      .dot = DOT_COLOR,
+    };
+
+    KnobState state;
 
     spr_.setTextDatum(CC_DATUM);
-    spr_.setTextColor(TFT_WHITE);
+    HeapMonitor::seal();
     while(1) {
-        if (xQueueReceive(knob_state_queue_, &state, portMAX_DELAY) == pdFALSE) {
+        // While the pointer is still easing onto its final position keep drawing frames, even without new state
+        if (xQueueReceive(knob_state_queue_, &state, settling_ ? 0 : portMAX_DELAY) == pdFALSE && !settling_) {
           continue;
         }
 
-        spr_.fillSprite(TFT_BLACK);
-        if (state.config.num_positions > 1) {
-          int32_t height = state.current_position * TFT_HEIGHT / (state.config.num_positions - 1);
-          spr_.fillRect(0, TFT_HEIGHT - height, TFT_WIDTH, height, FILL_COLOR);
+        ProfileScope frame_scope(ProfileSection::DISPLAY_FRAME);
+        ProfileScope render_scope(ProfileSection::RENDER);
+        uint32_t render_start = micros();
+        // Only the first frame showing a state counts towards its latency; settling frames redraw old ones
+        bool traced = state.sequence != traced_sequence_;
+        if (traced) {
+          traced_sequence_ = state.sequence;
+          LatencyTrace::record(LatencyPath::SENSOR_TO_RENDER, state.sensor_micros);
         }
+        KnobState predicted = predictState(state, render_start, render_start + (uint32_t)frame_latency_micros_);
+        renderer_.setLayout(getLayout(predicted.config.display_layout));
+        renderer_.update(predicted);
+        uint8_t dirty_regions = renderer_.render(spr_, colors);
+        render_scope.stop();
 
-        spr_.setFreeFont(&Roboto_Light_60);
-        spr_.drawString(String() + state.current_position, TFT_WIDTH / 2, TFT_HEIGHT / 2 - VALUE_OFFSET, 1);
-        
-        spr_.setFreeFont(&DESCRIPTION_FONT);
-        int32_t line_y = TFT_HEIGHT / 2 + DESCRIPTION_Y_OFFSET;
-        char* start = state.config.descriptor;
-        char* end = start + strlen(state.config.descriptor);
-        while (start < end) {
-          char* newline = strchr(start, '\n');
-          if (newline == nullptr) {
-            newline = end;
+        if (dirty_regions > 0) {
+          ProfileScope push_scope(ProfileSection::PUSH);
+          for (uint8_t i = 0; i < dirty_regions; i++) {
+            const Rect& region = renderer_.getDirtyRegion(i);
+            spr_.pushSprite(region.x, region.y, region.x, region.y, region.w, region.h);
           }
-          
-          char buf[sizeof(state.config.descriptor)] = {};
-          strncat(buf, start, min(sizeof(buf) - 1, (size_t)(newline - start)));
-          spr_.drawString(String(buf), TFT_WIDTH / 2, line_y, 1);
-          start = newline + 1;
-          line_y += spr_.fontHeight(1);
-        }
-
-        float left_bound = PI / 2;
-
-        if (state.config.num_positions > 0) {
-          float range_radians = (state.config.num_positions - 1) * state.config.position_width_radians;
-          left_bound = PI / 2 + range_radians / 2;
-          float right_bound = PI / 2 - range_radians / 2;
-          spr_.drawLine(TFT_WIDTH/2 + RADIUS * cosf(left_bound), TFT_HEIGHT/2 - RADIUS * sinf(left_bound), TFT_WIDTH/2 + (RADIUS - 10) * cosf(left_bound), TFT_HEIGHT/2 - (RADIUS - 10) * sinf(left_bound), TFT_WHITE);
-          spr_.drawLine(TFT_WIDTH/2 + RADIUS * cosf(right_bound), TFT_HEIGHT/2 - RADIUS * sinf(right_bound), TFT_WIDTH/2 + (RADIUS - 10) * cosf(right_bound), TFT_HEIGHT/2 - (RADIUS - 10) * sinf(right_bound), TFT_WHITE);
-        }
-        if (DRAW_ARC) {
-          spr_.drawCircle(TFT_WIDTH/2, TFT_HEIGHT/2, RADIUS, TFT_DARKGREY);
-        }
-
-        float adjusted_sub_position = state.sub_position_unit * state.config.position_width_radians;
-        if (state.config.num_positions > 0) {
-          if (state.current_position == 0 && state.sub_position_unit < 0) {
-            adjusted_sub_position = -logf(1 - state.sub_position_unit  * state.config.position_width_radians / 5 / PI * 180) * 5 * PI / 180;
-          } else if (state.current_position == state.config.num_positions - 1 && state.sub_position_unit > 0) {
-            adjusted_sub_position = logf(1 + state.sub_position_unit  * state.config.position_width_radians / 5 / PI * 180)  * 5 * PI / 180;
+          uint32_t push_end = micros();
+          frame_latency_micros_ = (push_end - render_start) * FRAME_LATENCY_EWMA_ALPHA + frame_latency_micros_ * (1 - FRAME_LATENCY_EWMA_ALPHA);
+          if (traced) {
+            LatencyTrace::record(LatencyPath::SENSOR_TO_PIXELS, state.sensor_micros);
           }
         }
 
-        float raw_angle = left_bound - state.current_position * state.config.position_width_radians;
-        float adjusted_angle = raw_angle - adjusted_sub_position;
-
-        if (state.config.num_positions > 0 && ((state.current_position == 0 && state.sub_position_unit < 0) || (state.current_position == state.config.num_positions - 1 && state.sub_position_unit > 0))) {
-
-          spr_.fillCircle(TFT_WIDTH/2 + (RADIUS - 10) * cosf(raw_angle), TFT_HEIGHT/2 - (RADIUS - 10) * sinf(raw_angle), 5, DOT_COLOR);
-          if (raw_angle < adjusted_angle) {
-            for (float r = raw_angle; r <= adjusted_angle; r += 2 * PI / 180) {
-              spr_.fillCircle(TFT_WIDTH/2 + (RADIUS - 10) * cosf(r), TFT_HEIGHT/2 - (RADIUS - 10) * sinf(r), 2, DOT_COLOR);
-            }
-            spr_.fillCircle(TFT_WIDTH/2 + (RADIUS - 10) * cosf(adjusted_angle), TFT_HEIGHT/2 - (RADIUS - 10) * sinf(adjusted_angle), 2, DOT_COLOR);
-          } else {
-            for (float r = raw_angle; r >= adjusted_angle; r -= 2 * PI / 180) {
-              spr_.fillCircle(TFT_WIDTH/2 + (RADIUS - 10) * cosf(r), TFT_HEIGHT/2 - (RADIUS - 10) * sinf(r), 2, DOT_COLOR);
-            }
-            spr_.fillCircle(TFT_WIDTH/2 + (RADIUS - 10) * cosf(adjusted_angle), TFT_HEIGHT/2 - (RADIUS - 10) * sinf(adjusted_angle), 2, DOT_COLOR);
-          }
-        } else {
-          spr_.fillCircle(TFT_WIDTH/2 + (RADIUS - 10) * cosf(adjusted_angle), TFT_HEIGHT/2 - (RADIUS - 10) * sinf(adjusted_angle), 5, DOT_COLOR);
-        }
-
-        spr_.pushSprite(0, 0);
-
         {
           SemaphoreGuard lock(mutex_);
           ledcWrite(LEDC_CHANNEL_LCD_BACKLIGHT, brightness_);
         }
+        frame_scope.stop();
         delay(2);
     }
 }
@@ -198,6 +213,56 @@ QueueHandle_t DisplayTask::getKnobStateQueue() {
   return knob_state_queue_;
 }
 
+Layout* DisplayTask::getLayout(DisplayLayout layout) {
+  switch (layout) {
+    case DisplayLayout::DIAL:
+      return &dial_layout_;
+    case DisplayLayout::FILL:
+    default:
+      return &fill_layout_;
+  }
+}
+
+// Returns a copy of state with the sub-position extrapolated (using the reported velocity) to the time the frame is
+// expected to become visible. Extrapolation stops at the snap point towards a neighbouring position, since only the
+// motor task decides when the position actually changes; past an endstop there's no such limit. Once the knob slows
+// down, the pointer eases onto the reported sub-position instead.
+KnobState DisplayTask::predictState(const KnobState& state, uint32_t frame_micros, uint32_t photon_micros) {
+  int32_t extrapolation_micros = CLAMP((int32_t)(photon_micros - state.timestamp_micros), (int32_t)0, (int32_t)MAX_EXTRAPOLATION_MICROS);
+  uint32_t frame_interval_micros = frame_micros - last_frame_micros_;
+  last_frame_micros_ = frame_micros;
+
+  float target = state.sub_position_unit;
+  if (state.current_position != displayed_position_) {
+    displayed_position_ = state.current_position;
+    displayed_sub_position_unit_ = target;
+  }
+
+  if (fabsf(state.sub_position_velocity_unit) > SETTLED_VELOCITY_UNIT) {
+    target = state.sub_position_unit + state.sub_position_velocity_unit * extrapolation_micros / 1000000;
+    bool bounded = state.config.num_positions > 0;
+    if (!bounded || state.current_position > 0) {
+      target = fmaxf(target, -state.config.snap_point);
+    }
+    if (!bounded || state.current_position < state.config.num_positions - 1) {
+      target = fminf(target, state.config.snap_point);
+    }
+    displayed_sub_position_unit_ = target;
+  } else {
+    // Frames come as fast as they render, so the easing goes by the time since the last one
+    float alpha = 1 - powf(1 - SETTLE_ALPHA, (float)frame_interval_micros / SETTLE_PERIOD_MICROS);
+    displayed_sub_position_unit_ += (target - displayed_sub_position_unit_) * alpha;
+    if (fabsf(target - displayed_sub_position_unit_) < SETTLE_EPSILON_UNIT) {
+      displayed_sub_position_unit_ = target;
+    }
+  }
+  settling_ = displayed_sub_position_unit_ != target;
+
+  KnobState predicted = state;
+  predicted.sub_position_unit = displayed_sub_position_unit_;
+  return predicted;
+}
+
 void DisplayTask::setBrightness(uint16_t brightness) {
   SemaphoreGuard lock(mutex_);
   brightness_ = brightness;
@@ -5,11 +5,23 @@
 #include <Arduino.h>
 #include <TFT_eSPI.h>
 
+#include "display_layouts.h"
+#include "display_renderer.h"
 #include "knob_data.h"
 #include "task.h"
+#include "task_config.h"
 
-class DisplayTask : public Task<DisplayTask> {
-    friend class Task<DisplayTask>; // Allow base Task to invoke protected run()
+// Framebuffer color depth. 16 stores full RGB565 pixels; 4 stores palette indices (expanded to RGB565 while
+// pushing to the display), which cuts the framebuffer to a quarter of the size at the cost of slower pushes.
+// host/tools/render.cpp compares the two; on the device, the profile report times rendering and pushing.
+#ifndef SK_DISPLAY_COLOR_DEPTH
+#define SK_DISPLAY_COLOR_DEPTH 16
+#endif
+
+static const uint32_t DISPLAY_TASK_STACK_SIZE = 4048;
+
+class DisplayTask : public Task<DisplayTask, DISPLAY_TASK_STACK_SIZE, DISPLAY_TASK_PRIORITY> {
+    template<class, uint32_t, UBaseType_t> friend class Task; // Allow base Task to invoke protected run()
 
     public:
         DisplayTask(const uint8_t task_core);
@@ -28,6 +40,10 @@ class DisplayTask : public Task<DisplayTask> {
         /** Full-size sprite used as a framebuffer */
         TFT_eSprite spr_ = TFT_eSprite(&tft_);
 
+        FillLayout fill_layout_;
+        DialLayout dial_layout_;
+        DisplayRenderer renderer_;
+
         QueueHandle_t knob_state_queue_;
 
         KnobState state_;
@@ -35,6 +51,20 @@ class DisplayTask : public Task<DisplayTask> {
         SemaphoreHandle_t mutex_;
 
         uint16_t brightness_;
+
+        // Pointer latency compensation: the pointer is extrapolated to where the knob is expected to be when
+        // the frame actually reaches the panel, and eased onto the reported position once the knob settles.
+        float frame_latency_micros_ = 0;
+        int32_t displayed_position_ = 0;
+        float displayed_sub_position_unit_ = 0;
+        bool settling_ = false;
+        uint32_t last_frame_micros_ = 0;
+
+        // KnobState::sequence of the last state whose latency was recorded
+        uint32_t traced_sequence_ = 0;
+
+        Layout* getLayout(DisplayLayout layout);
+        KnobState predictState(const KnobState& state, uint32_t frame_micros, uint32_t photon_micros);
 };
 
 #else
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A region of NOR flash: erase sets whole sectors to 0xFF, and writes can only clear bits. Implemented on top of
+// an ESP32 data partition on the device (PartitionFlashRegion), and in RAM for host-side tools.
+class FlashRegion {
+    public:
+        static const size_t SECTOR_SIZE = 4096;
+
+        virtual ~FlashRegion() {}
+
+        virtual size_t getSize() = 0;
+        // offset and length must be sector aligned
+        virtual bool erase(size_t offset, size_t length) = 0;
+        virtual bool write(size_t offset, const uint8_t* data, size_t length) = 0;
+        virtual bool read(size_t offset, uint8_t* data, size_t length) = 0;
+
+        // Returns the whole region mapped into the address space, or nullptr if unavailable. The mapping may be
+        // stale after erase()/write() until map() is called again.
+        virtual const uint8_t* map() = 0;
+};
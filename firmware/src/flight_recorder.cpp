@@ -0,0 +1,154 @@
+#include <atomic>
+
+#include "flight_recorder.h"
+#include "logger.h"
+#include "util.h"
+
+static const uint32_t CAPTURE_MAGIC = 0x464c5452;
+static const uint32_t POST_FREEZE_RECORDS = SK_FLIGHT_RECORDER_RECORDS / 4;
+
+struct Capture {
+    uint32_t magic;
+    // Records written since the capture started; the newest is at (head - 1) % SK_FLIGHT_RECORDER_RECORDS
+    std::atomic<uint32_t> head;
+    // Set by the motor task once it has seen the freeze; recording then stops when head reaches stop_head
+    uint32_t stopping;
+    uint32_t stop_head;
+    std::atomic<uint32_t> reason;
+    uint32_t freeze_millis;
+    FlightRecord records[SK_FLIGHT_RECORDER_RECORDS];
+};
+static_assert(sizeof(Capture) <= 6 * 1024, "Flight recorder doesn't leave enough RTC slow memory");
+
+// Not zeroed at boot, so a capture survives software resets
+static RTC_NOINIT_ATTR Capture capture;
+
+static std::atomic<bool> clear_requested;
+static uint32_t decimation_count = 0;
+// Latest sample, whose motion fields events reuse
+static FlightRecord last_sample = {};
+
+static void reset() {
+    capture.head.store(0, std::memory_order_relaxed);
+    capture.stopping = 0;
+    capture.stop_head = 0;
+    capture.reason.store((uint32_t)FlightFreezeReason::NONE, std::memory_order_relaxed);
+    capture.freeze_millis = 0;
+    capture.magic = CAPTURE_MAGIC;
+}
+
+static int16_t toFixed(float value, float scale) {
+    return (int16_t)CLAMP(value * scale, -32767.f, 32767.f);
+}
+
+// Motor task only: handles clear and freeze requests, and says whether to record
+static bool recording() {
+    if (clear_requested.load(std::memory_order_relaxed) && clear_requested.exchange(false, std::memory_order_relaxed)) {
+        reset();
+    }
+    if (capture.reason.load(std::memory_order_acquire) == (uint32_t)FlightFreezeReason::NONE) {
+        return true;
+    }
+    uint32_t head = capture.head.load(std::memory_order_relaxed);
+    if (!capture.stopping) {
+        capture.stopping = 1;
+        capture.stop_head = head + POST_FREEZE_RECORDS;
+    }
+    return head != capture.stop_head;
+}
+
+static void append(const FlightRecord& record) {
+    uint32_t head = capture.head.load(std::memory_order_relaxed);
+    capture.records[head % SK_FLIGHT_RECORDER_RECORDS] = record;
+    capture.head.store(head + 1, std::memory_order_release);
+}
+
+void FlightRecorder::begin() {
+    uint32_t head = capture.head.load(std::memory_order_relaxed);
+    uint32_t reason = capture.reason.load(std::memory_order_relaxed);
+    if (capture.magic != CAPTURE_MAGIC || reason > (uint32_t)FlightFreezeReason::CRASH || capture.stopping > 1) {
+        reset();
+        return;
+    }
+
+    if (reason == (uint32_t)FlightFreezeReason::NONE) {
+        switch (esp_reset_reason()) {
+            case ESP_RST_PANIC:
+            case ESP_RST_INT_WDT:
+            case ESP_RST_TASK_WDT:
+            case ESP_RST_WDT:
+            case ESP_RST_BROWNOUT:
+                if (head == 0) {
+                    reset();
+                    return;
+                }
+                capture.reason.store((uint32_t)FlightFreezeReason::CRASH, std::memory_order_relaxed);
+                capture.freeze_millis = capture.records[(head - 1) % SK_FLIGHT_RECORDER_RECORDS].millis;
+                break;
+            default:
+                reset();
+                return;
+        }
+    }
+    // Whatever was still to be recorded after the freeze is lost with the reset
+    capture.stopping = 1;
+    capture.stop_head = head;
+    LOG_WARNING("Flight recorder kept a capture from before reset (%s, %u records); download it with GET_RECORDING",
+        flightFreezeReasonName((FlightFreezeReason)capture.reason.load(std::memory_order_relaxed)),
+        min(head, (uint32_t)SK_FLIGHT_RECORDER_RECORDS));
+}
+
+void FlightRecorder::sample(float angle_radians, float velocity, float torque_volts, int32_t position, uint8_t fault) {
+    if (++decimation_count < SK_FLIGHT_RECORDER_DECIMATION) {
+        return;
+    }
+    decimation_count = 0;
+    if (!recording()) {
+        return;
+    }
+    last_sample = {
+        .millis = millis(),
+        .angle_radians = angle_radians,
+        .velocity_centiradians = toFixed(velocity, 100),
+        .torque_centivolts = toFixed(torque_volts, 100),
+        .position = (int16_t)CLAMP(position, (int32_t)INT16_MIN, (int32_t)INT16_MAX),
+        .type = FlightRecordType::SAMPLE,
+        .detail = fault,
+    };
+    append(last_sample);
+}
+
+void FlightRecorder::event(FlightRecordType type, uint8_t detail) {
+    if (!recording()) {
+        return;
+    }
+    FlightRecord record = last_sample;
+    record.millis = millis();
+    record.type = type;
+    record.detail = detail;
+    append(record);
+}
+
+void FlightRecorder::freeze(FlightFreezeReason reason) {
+    uint32_t expected = (uint32_t)FlightFreezeReason::NONE;
+    if (capture.reason.compare_exchange_strong(expected, (uint32_t)reason)) {
+        capture.freeze_millis = millis();
+    }
+}
+
+void FlightRecorder::clear() {
+    clear_requested.store(true, std::memory_order_relaxed);
+}
+
+void FlightRecorder::read(uint16_t first, RecordingMessage& message) {
+    uint32_t head = capture.head.load(std::memory_order_acquire);
+    uint32_t total = min(head, (uint32_t)SK_FLIGHT_RECORDER_RECORDS);
+    message.reason = (FlightFreezeReason)capture.reason.load(std::memory_order_relaxed);
+    message.freeze_millis = capture.freeze_millis;
+    message.total = total;
+    message.first = first;
+    message.count = 0;
+    for (uint32_t i = first; i < total && message.count < RECORDING_RECORDS_PER_MESSAGE; i++) {
+        message.records[message.count++] = capture.records[(head - total + i) % SK_FLIGHT_RECORDER_RECORDS];
+    }
+}
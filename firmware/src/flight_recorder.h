@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "protocol.h"
+
+// Capacity, in 16 byte records. The capture lives in RTC slow memory (8 KB, shared with anything else kept across
+// deep sleep), so it survives software resets; the default holds about 2.5 s of state.
+#ifndef SK_FLIGHT_RECORDER_RECORDS
+#define SK_FLIGHT_RECORDER_RECORDS 256
+#endif
+
+// One sample is kept per this many motor loop iterations (so 100 Hz at the 1 kHz loop rate)
+#ifndef SK_FLIGHT_RECORDER_DECIMATION
+#define SK_FLIGHT_RECORDER_DECIMATION 10
+#endif
+
+// Flight recorder: a ring of decimated motor loop state, interleaved with the commands the loop acted on and sensor
+// errors, for working out after the fact why a knob buzzed or ran away. Always on; a sample costs a counter check,
+// plus a 16 byte copy every SK_FLIGHT_RECORDER_DECIMATION iterations.
+//
+// freeze() (on a motor fault, or on request) keeps recording for another quarter of the ring, so the capture shows
+// both the lead-up and the aftermath, then stops until the capture is cleared. It's downloaded with GET_RECORDING.
+//
+// Records are only written by the motor task (sensor errors are reported from reads in its loop), so the ring needs
+// no locking; the other calls are safe from any task.
+class FlightRecorder {
+    public:
+        // Call once at boot, before the motor task starts. Keeps a capture that survived the reset if it had been
+        // frozen, or if the reset was a crash (panic, watchdog or brownout); otherwise starts empty.
+        static void begin();
+
+        // Motor task only. Records every SK_FLIGHT_RECORDER_DECIMATION-th call.
+        static void sample(float angle_radians, float velocity, float torque_volts, int32_t position, uint8_t fault);
+        // Motor task only. Events carry the latest sample's motion and position.
+        static void event(FlightRecordType type, uint8_t detail);
+
+        // Only the first reason is kept until the capture is cleared
+        static void freeze(FlightFreezeReason reason);
+        // Discards the capture and resumes recording, from the motor task's next record
+        static void clear();
+
+        // Fills message with the capture's state and up to RECORDING_RECORDS_PER_MESSAGE records from index first
+        // (oldest first). Records may still change until the capture is frozen.
+        static void read(uint16_t first, RecordingMessage& message);
+};
@@ -196,4 +196,4 @@ const GFXglyph Roboto_Light_60Glyphs[] PROGMEM = {
 	  { 11737,  19,  59,  21,    0,  -47 } // '}'
 };
 const GFXfont Roboto_Light_60 PROGMEM = {
-(uint8_t  *)Roboto_Light_60Bitmaps,(GFXglyph *)Roboto_Light_60Glyphs,0x20, 0x7E, 71};
\ No newline at end of file
+(uint8_t  *)Roboto_Light_60Bitmaps,(GFXglyph *)Roboto_Light_60Glyphs,0x20, 0x7D, 71};
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include <atomic>
+
+#include "heap_monitor.h"
+#include "logger.h"
+
+#if SK_HEAP_MONITOR
+
+static const uint8_t MAX_HEAP_TASKS = 12;
+static const uint8_t HEAP_TASK_NAME_LENGTH = 16;
+
+struct HeapTaskStats {
+    std::atomic<TaskHandle_t> owner;
+    // Copied when claimed, since the task (and its name) may be deleted before the report
+    char name[HEAP_TASK_NAME_LENGTH];
+    std::atomic<bool> sealed;
+    std::atomic<uint32_t> allocations;
+    std::atomic<uint32_t> bytes;
+    std::atomic<uint32_t> late_allocations;
+};
+
+static HeapTaskStats task_stats[MAX_HEAP_TASKS];
+// Allocations from ISRs, from before the scheduler started, and from tasks beyond MAX_HEAP_TASKS
+static HeapTaskStats other_stats;
+static std::atomic<uint32_t> frees;
+
+static HeapTaskStats* getStats() {
+    if (xPortInIsrContext()) {
+        return &other_stats;
+    }
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    if (task == nullptr) {
+        return &other_stats;
+    }
+    for (uint8_t i = 0; i < MAX_HEAP_TASKS; i++) {
+        if (task_stats[i].owner.load(std::memory_order_relaxed) == task) {
+            return &task_stats[i];
+        }
+    }
+    // First allocation by this task: claim a free slot
+    for (uint8_t i = 0; i < MAX_HEAP_TASKS; i++) {
+        TaskHandle_t expected = nullptr;
+        if (task_stats[i].owner.compare_exchange_strong(expected, task)) {
+            strncpy(task_stats[i].name, pcTaskGetTaskName(nullptr), HEAP_TASK_NAME_LENGTH - 1);
+            return &task_stats[i];
+        }
+    }
+    return &other_stats;
+}
+
+static void record(size_t size) {
+    HeapTaskStats* stats = getStats();
+    stats->allocations.fetch_add(1, std::memory_order_relaxed);
+    stats->bytes.fetch_add(size, std::memory_order_relaxed);
+    if (stats->sealed.load(std::memory_order_relaxed)) {
+        stats->late_allocations.fetch_add(1, std::memory_order_relaxed);
+        #if SK_HEAP_TRAP
+            // Straight to the UART: the logger is asynchronous, and we're about to abort
+            ets_printf("Heap: %u byte allocation by %s after setup\n", (unsigned int)size, stats->name);
+            abort();
+        #endif
+    }
+}
+
+extern "C" {
+    void* __real_malloc(size_t size);
+    void* __real_calloc(size_t count, size_t size);
+    void* __real_realloc(void* ptr, size_t size);
+    void __real_free(void* ptr);
+
+    void* __wrap_malloc(size_t size) {
+        record(size);
+        return __real_malloc(size);
+    }
+
+    void* __wrap_calloc(size_t count, size_t size) {
+        record(count * size);
+        return __real_calloc(count, size);
+    }
+
+    void* __wrap_realloc(void* ptr, size_t size) {
+        record(size);
+        return __real_realloc(ptr, size);
+    }
+
+    void __wrap_free(void* ptr) {
+        if (ptr != nullptr) {
+            frees.fetch_add(1, std::memory_order_relaxed);
+        }
+        __real_free(ptr);
+    }
+}
+
+void HeapMonitor::seal() {
+    getStats()->sealed.store(true, std::memory_order_relaxed);
+}
+
+#else
+
+void HeapMonitor::seal() {}
+
+#endif
+
+void HeapMonitor::log() {
+    uint32_t size = ESP.getHeapSize();
+    uint32_t free_bytes = ESP.getFreeHeap();
+    uint32_t largest_free_block = ESP.getMaxAllocHeap();
+    // Share of the free memory that can't be had in one allocation
+    uint32_t fragmentation_percent = free_bytes > 0 ? 100 - (uint64_t)largest_free_block * 100 / free_bytes : 0;
+    LOG_INFO("Heap: %u of %u bytes used, peak %u, largest free block %u (%u%% fragmented)",
+        size - free_bytes, size, size - ESP.getMinFreeHeap(), largest_free_block, fragmentation_percent);
+
+    #if SK_HEAP_MONITOR
+        for (uint8_t i = 0; i < MAX_HEAP_TASKS; i++) {
+            const HeapTaskStats& stats = task_stats[i];
+            if (stats.owner.load(std::memory_order_relaxed) != nullptr) {
+                LOG_INFO("Heap %s: %u allocations (%u bytes), %u after setup%s", stats.name,
+                    stats.allocations.load(std::memory_order_relaxed), stats.bytes.load(std::memory_order_relaxed),
+                    stats.late_allocations.load(std::memory_order_relaxed),
+                    stats.sealed.load(std::memory_order_relaxed) ? "" : " (never sealed)");
+            }
+        }
+        LOG_INFO("Heap (other): %u allocations (%u bytes)", other_stats.allocations.load(std::memory_order_relaxed),
+            other_stats.bytes.load(std::memory_order_relaxed));
+        LOG_INFO("Heap: %u frees", frees.load(std::memory_order_relaxed));
+    #endif
+}
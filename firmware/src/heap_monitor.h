@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Counts heap allocations per task. Needs the allocator wrapped at link time
+// (-Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc -Wl,--wrap=free, see the view_heap env in platformio.ini).
+#ifndef SK_HEAP_MONITOR
+#define SK_HEAP_MONITOR 0
+#endif
+
+// With the monitor on, abort on any allocation by a task that has finished its setup (see HeapMonitor::seal())
+#ifndef SK_HEAP_TRAP
+#define SK_HEAP_TRAP 0
+#endif
+
+// The firmware allocates only while starting up (display sprite, FreeRTOS objects, library setup); once a task is in
+// its steady-state loop it shouldn't touch the heap at all. This checks that. FreeRTOS objects are allocated straight
+// from ESP-IDF's heap_caps allocator, bypassing malloc, so they only show up in the heap totals.
+class HeapMonitor {
+    public:
+        // Marks the calling task's setup as done: any allocation it makes from now on is counted as a late one (and
+        // traps with SK_HEAP_TRAP). Compiles to nothing without SK_HEAP_MONITOR.
+        static void seal();
+
+        // Logs heap size, peak use and fragmentation, plus each task's allocation counts with SK_HEAP_MONITOR
+        static void log();
+};
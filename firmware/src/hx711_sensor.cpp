@@ -0,0 +1,83 @@
+#include "hx711_sensor.h"
+
+// Number of extra clock pulses after the 24 data bits, which selects the next conversion's channel and gain
+// (1 = channel A, gain 128)
+static const uint8_t GAIN_PULSES = 1;
+
+HX711Sensor::HX711Sensor(uint8_t data_pin, uint8_t clock_pin) : data_pin_(data_pin), clock_pin_(clock_pin) {}
+
+void HX711Sensor::begin(TaskHandle_t notify_task, uint32_t notify_bits) {
+    notify_task_ = notify_task;
+    notify_bits_ = notify_bits;
+    pinMode(clock_pin_, OUTPUT);
+    digitalWrite(clock_pin_, LOW);
+    pinMode(data_pin_, INPUT);
+    attachInterruptArg(digitalPinToInterrupt(data_pin_), onDataReady, this, FALLING);
+}
+
+bool HX711Sensor::read(StrainSample& sample) {
+    uint32_t tail = tail_;
+    if (tail == head_) {
+        return false;
+    }
+    sample = samples_[tail % BUFFER_SIZE];
+    tail_ = tail + 1;
+    return true;
+}
+
+uint32_t HX711Sensor::getLastSampleMicros() {
+    return last_sample_micros_;
+}
+
+uint32_t HX711Sensor::getOverflowCount() {
+    return overflow_count_;
+}
+
+void IRAM_ATTR HX711Sensor::onDataReady(void* arg) {
+    static_cast<HX711Sensor*>(arg)->readSample();
+}
+
+void IRAM_ATTR HX711Sensor::readSample() {
+    // Clocking out the data toggles DOUT, which re-triggers this interrupt once we return. DOUT is high again
+    // after a complete readout, so those spurious triggers are ignored here.
+    if (digitalRead(data_pin_) != LOW) {
+        return;
+    }
+    uint32_t now = micros();
+
+    // The clock must not stay high for more than 60us (or the HX711 powers down), which is guaranteed here since
+    // nothing else can run on this core while the ISR clocks out the data.
+    uint32_t raw = 0;
+    for (uint8_t i = 0; i < 24 + GAIN_PULSES; i++) {
+        digitalWrite(clock_pin_, HIGH);
+        ets_delay_us(1);
+        if (i < 24) {
+            raw = (raw << 1) | (digitalRead(data_pin_) == HIGH ? 1 : 0);
+        }
+        digitalWrite(clock_pin_, LOW);
+        ets_delay_us(1);
+    }
+
+    // Sign-extend 24-bit two's complement
+    int32_t value = (int32_t)(raw << 8) >> 8;
+
+    uint32_t head = head_;
+    if (head - tail_ >= BUFFER_SIZE) {
+        overflow_count_++;
+        return;
+    }
+    samples_[head % BUFFER_SIZE] = {
+        .value = value,
+        .timestamp_micros = now,
+    };
+    head_ = head + 1;
+    last_sample_micros_ = now;
+
+    if (notify_task_ != nullptr) {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(notify_task_, notify_bits_, eSetBits, &woken);
+        if (woken == pdTRUE) {
+            portYIELD_FROM_ISR();
+        }
+    }
+}
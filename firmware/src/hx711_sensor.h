@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+
+struct StrainSample {
+    int32_t value;
+    // When the HX711 signaled data ready (micros() timebase)
+    uint32_t timestamp_micros;
+};
+
+// Interrupt-driven HX711 reader. The data-ready falling edge on DOUT triggers an ISR that clocks out the 24-bit
+// sample (a bounded ~60us routine) and pushes it, timestamped, into a small ring buffer. The consumer task drains
+// the buffer with read() and never blocks waiting for the chip.
+class HX711Sensor {
+    public:
+        HX711Sensor(uint8_t data_pin, uint8_t clock_pin);
+
+        // Optionally notifies a task (setting notify_bits in its notification value) whenever a sample is ready
+        void begin(TaskHandle_t notify_task = nullptr, uint32_t notify_bits = 0);
+
+        // Pops the oldest unread sample. Returns false if there is none. Must only be called from one task.
+        bool read(StrainSample& sample);
+
+        // micros() timestamp of the most recent sample, or 0 if no sample has been received yet
+        uint32_t getLastSampleMicros();
+
+        // Number of samples dropped because the consumer didn't keep up
+        uint32_t getOverflowCount();
+
+    private:
+        static const uint8_t BUFFER_SIZE = 16;
+
+        const uint8_t data_pin_;
+        const uint8_t clock_pin_;
+        TaskHandle_t notify_task_ = nullptr;
+        uint32_t notify_bits_ = 0;
+
+        StrainSample samples_[BUFFER_SIZE] = {};
+        volatile uint32_t head_ = 0;
+        volatile uint32_t tail_ = 0;
+        volatile uint32_t last_sample_micros_ = 0;
+        volatile uint32_t overflow_count_ = 0;
+
+        static void IRAM_ATTR onDataReady(void* arg);
+        void IRAM_ATTR readSample();
+};
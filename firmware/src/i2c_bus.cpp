@@ -0,0 +1,135 @@
+#include "i2c_bus.h"
+#include "logger.h"
+
+// Upper bound on a single Wire operation, so a missing or stuck device can't hold the bus for long (the core's
+// default is 50ms)
+static const uint16_t WIRE_TIMEOUT_MILLIS = 5;
+
+// How long a high priority transaction waits for the bus before giving up
+static const TickType_t HIGH_PRIORITY_MAX_WAIT_TICKS = pdMS_TO_TICKS(1);
+
+I2CBus::I2CBus(TwoWire& wire) : wire_(wire) {
+    for (uint8_t i = 0; i < 2; i++) {
+        grant_[i] = xSemaphoreCreateCounting(MAX_DEVICES, 0);
+        assert(grant_[i] != NULL);
+    }
+}
+
+I2CBus::~I2CBus() {
+    for (uint8_t i = 0; i < 2; i++) {
+        vSemaphoreDelete(grant_[i]);
+    }
+}
+
+void I2CBus::begin(int sda, int scl, uint32_t frequency) {
+    wire_.begin(sda, scl);
+    wire_.setClock(frequency);
+    wire_.setTimeOut(WIRE_TIMEOUT_MILLIS);
+}
+
+uint8_t I2CBus::registerDevice(const char* name, I2CPriority priority) {
+    portENTER_CRITICAL(&mux_);
+    assert(device_count_ < MAX_DEVICES);
+    uint8_t device = device_count_++;
+    devices_[device].name = name;
+    devices_[device].priority = priority;
+    portEXIT_CRITICAL(&mux_);
+    return device;
+}
+
+TwoWire& I2CBus::getWire() {
+    return wire_;
+}
+
+I2CDeviceStats I2CBus::getStats(uint8_t device) {
+    portENTER_CRITICAL(&mux_);
+    I2CDeviceStats stats = devices_[device].stats;
+    portEXIT_CRITICAL(&mux_);
+    return stats;
+}
+
+void I2CBus::logStats() {
+    for (uint8_t i = 0; i < device_count_; i++) {
+        I2CDeviceStats stats = getStats(i);
+        LOG_INFO("I2C %s: %u transactions, %u errors, %u timeouts, wait max %u us, duration avg %u us / max %u us",
+            devices_[i].name, stats.transactions, stats.errors, stats.timeouts, stats.max_wait_micros,
+            stats.transactions == 0 ? 0 : stats.total_duration_micros / stats.transactions, stats.max_duration_micros);
+    }
+}
+
+bool I2CBus::acquire(uint8_t device) {
+    uint8_t p = (uint8_t)devices_[device].priority;
+
+    portENTER_CRITICAL(&mux_);
+    if (!busy_) {
+        busy_ = true;
+        portEXIT_CRITICAL(&mux_);
+        return true;
+    }
+    waiting_[p]++;
+    portEXIT_CRITICAL(&mux_);
+
+    TickType_t max_wait = devices_[device].priority == I2CPriority::HIGH_PRIORITY ? HIGH_PRIORITY_MAX_WAIT_TICKS : portMAX_DELAY;
+    if (xSemaphoreTake(grant_[p], max_wait) == pdTRUE) {
+        return true;
+    }
+
+    portENTER_CRITICAL(&mux_);
+    if (waiting_[p] > 0) {
+        // Not granted; withdraw
+        waiting_[p]--;
+        devices_[device].stats.timeouts++;
+        portEXIT_CRITICAL(&mux_);
+        return false;
+    }
+    portEXIT_CRITICAL(&mux_);
+
+    // The bus was handed over as the wait timed out; the grant is already (or about to be) given
+    xSemaphoreTake(grant_[p], portMAX_DELAY);
+    return true;
+}
+
+void I2CBus::release(uint8_t device, uint32_t wait_micros, uint32_t duration_micros, bool error) {
+    int8_t next = -1;
+
+    portENTER_CRITICAL(&mux_);
+    I2CDeviceStats& stats = devices_[device].stats;
+    stats.transactions++;
+    if (error) {
+        stats.errors++;
+    }
+    stats.max_wait_micros = max(stats.max_wait_micros, wait_micros);
+    stats.max_duration_micros = max(stats.max_duration_micros, duration_micros);
+    stats.total_duration_micros += duration_micros;
+
+    // Hand the bus over without releasing it, so it can't be taken out of priority order in between
+    for (uint8_t p = 0; p < 2; p++) {
+        if (waiting_[p] > 0) {
+            waiting_[p]--;
+            next = p;
+            break;
+        }
+    }
+    if (next < 0) {
+        busy_ = false;
+    }
+    portEXIT_CRITICAL(&mux_);
+
+    if (next >= 0) {
+        xSemaphoreGive(grant_[next]);
+    }
+}
+
+
+I2CTransaction::I2CTransaction(I2CBus& bus, uint8_t device) : bus_(bus), device_(device) {
+    uint32_t start = micros();
+    acquired_ = bus_.acquire(device_);
+    start_micros_ = micros();
+    wait_micros_ = start_micros_ - start;
+}
+
+I2CTransaction::~I2CTransaction() {
+    if (acquired_) {
+        bus_.release(device_, wait_micros_, micros() - start_micros_, error_);
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+enum class I2CPriority : uint8_t {
+    // Sensors read from the motor loop; waits are bounded and skipped if the bus can't be had in time
+    HIGH_PRIORITY = 0,
+    LOW_PRIORITY,
+};
+
+struct I2CDeviceStats {
+    uint32_t transactions;
+    uint32_t errors;
+    // Transactions given up on because the bus wasn't granted in time (high priority only)
+    uint32_t timeouts;
+    uint32_t max_wait_micros;
+    uint32_t max_duration_micros;
+    uint32_t total_duration_micros;
+};
+
+// Arbitrates a shared TwoWire bus between tasks on both cores. Devices register once with a priority, and each
+// group of bus operations runs inside an I2CTransaction. Transactions never overlap; when the bus is released it
+// is handed directly to the oldest waiting high priority transaction, then to low priority ones, so a high
+// priority device waits for at most one transaction that's already in progress (which the Wire timeout bounds).
+class I2CBus {
+    public:
+        static const uint8_t MAX_DEVICES = 4;
+
+        I2CBus(TwoWire& wire);
+        ~I2CBus();
+
+        void begin(int sda, int scl, uint32_t frequency);
+
+        // Returns the id to open transactions with
+        uint8_t registerDevice(const char* name, I2CPriority priority);
+
+        TwoWire& getWire();
+        I2CDeviceStats getStats(uint8_t device);
+        void logStats();
+
+    private:
+        friend class I2CTransaction;
+
+        struct Device {
+            const char* name;
+            I2CPriority priority;
+            I2CDeviceStats stats;
+        };
+
+        TwoWire& wire_;
+
+        portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+        bool busy_ = false;
+        // Waiters not yet granted the bus, and the semaphores they're granted through, per priority
+        uint8_t waiting_[2] = {};
+        SemaphoreHandle_t grant_[2];
+
+        Device devices_[MAX_DEVICES] = {};
+        uint8_t device_count_ = 0;
+
+        bool acquire(uint8_t device);
+        void release(uint8_t device, uint32_t wait_micros, uint32_t duration_micros, bool error);
+};
+
+// Holds the bus for the lifetime of the object. Check isAcquired() before touching the bus, and report failed
+// operations through setError() so they show up in the device's stats.
+class I2CTransaction {
+    public:
+        I2CTransaction(I2CBus& bus, uint8_t device);
+        ~I2CTransaction();
+        I2CTransaction(I2CTransaction const&)=delete;
+        I2CTransaction& operator=(I2CTransaction const&)=delete;
+
+        bool isAcquired() const { return acquired_; }
+        TwoWire& getWire() { return bus_.getWire(); }
+        void setError() { error_ = true; }
+
+    private:
+        I2CBus& bus_;
+        const uint8_t device_;
+        bool acquired_;
+        bool error_ = false;
+        uint32_t wait_micros_;
+        uint32_t start_micros_;
+};
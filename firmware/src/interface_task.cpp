@@ -1,308 +1,602 @@
-#include <AceButton.h>
-
-
-#if PIN_SDA >= 0 && PIN_SCL >= 0
-#include <Arduino.h>
-#include <Wire.h>
-#endif
-#if (defined(SK_LEDS) && (SK_LEDS >0))
-#include <FastLED.h>
-#endif
-
-#if (defined(SK_STRAIN) && (SK_STRAIN > 0))
-#include <HX711.h>
-#endif
-
-#if (defined(SK_ALS) && (SK_ALS >0))
-#include <Adafruit_VEML7700.h>
-#endif
-
+#include "builtin_configs.h"
+#include "button.h"
+#include "config_library.h"
+#include "flight_recorder.h"
+#include "heap_monitor.h"
+#include "hx711_sensor.h"
 #include "interface_task.h"
+#include "latency_trace.h"
+#include "logger.h"
+#include "profiler.h"
+#include "press_detector.h"
+#include "uart_serial.h"
 #include "util.h"
+#include "veml7700_sensor.h"
+
+// Task notification bits, set from interrupts and the UART's event task
+static const uint32_t EVENT_BUTTON_NEXT = 1 << 0;
+static const uint32_t EVENT_BUTTON_PREV = 1 << 1;
+static const uint32_t EVENT_STRAIN_SAMPLE = 1 << 2;
+static const uint32_t EVENT_SERIAL = 1 << 3;
 
-using namespace ace_button;
+static const uint32_t I2C_STATS_MILLIS = 10000;
 
-#define COUNT_OF(A) (sizeof(A) / sizeof(A[0]))
+// See partitions.csv
+static const char* CONFIG_PARTITION_LABEL = "knobcfg";
+static const uint8_t CONFIG_PARTITION_SUBTYPE = 0x40;
+static const char* POSITION_PARTITION_LABEL = "knobpos";
+static const uint8_t POSITION_PARTITION_SUBTYPE = 0x41;
 
-#if (defined(SK_LEDS) && (SK_LEDS >0))
-CRGB leds[NUM_LEDS];
+static const uint32_t POSITION_CHECK_MILLIS = 250;
+// Positions are only written once the knob has rested this long, so turning it doesn't wear the flash
+static const uint32_t POSITION_IDLE_MILLIS = 3000;
+
+#if PIN_BUTTON_NEXT > -1
+Button button_next = Button(PIN_BUTTON_NEXT, EVENT_BUTTON_NEXT);
+#endif
+#if PIN_BUTTON_PREV > -1
+Button button_prev = Button(PIN_BUTTON_PREV, EVENT_BUTTON_PREV);
 #endif
 
 #if (defined(SK_STRAIN) && (SK_STRAIN > 0))
-HX711 scale;
+HX711Sensor strain = HX711Sensor(PIN_STRAIN_DO, PIN_STRAIN_SCK);
+PressDetector press_detector = PressDetector();
+
+// If no sample arrives for this long, the HX711 is considered missing
+static const uint32_t STRAIN_TIMEOUT_MICROS = 500000;
+static const uint32_t STRAIN_CHECK_MILLIS = 100;
 #endif
 
 #if (defined(SK_ALS) && (SK_ALS >0))
-Adafruit_VEML7700 veml = Adafruit_VEML7700();
+VEML7700Sensor als = VEML7700Sensor();
 #endif
 
-static KnobConfig configs[] = {
-    // int32_t num_positions;
-    // int32_t position;
-    // float position_width_radians;
-    // float detent_strength_unit;
-    // float endstop_strength_unit;
-    // float snap_point;
-    // char descriptor[50];
-
-    {
-        0,
-        0,
-        10 * PI / 180,
-        0,
-        1,
-        1.1,
-        "Unbounded\nNo detents",
-    },
-    {
-        11,
-        0,
-        10 * PI / 180,
-        0,
-        1,
-        1.1,
-        "Bounded 0-10\nNo detents",
-    },
-    {
-        73,
-        0,
-        10 * PI / 180,
-        0,
-        1,
-        1.1,
-        "Multi-rev\nNo detents",
-    },
-    {
-        2,
-        0,
-        60 * PI / 180,
-        1,
-        1,
-        0.55, // Note the snap point is slightly past the midpoint (0.5); compare to normal detents which use a snap point *past* the next value (i.e. > 1)
-        "On/off\nStrong detent",
-    },
-    {
-        1,
-        0,
-        60 * PI / 180,
-        0.01,
-        0.6,
-        1.1,
-        "Return-to-center",
-    },
-    {
-        256,
-        127,
-        1 * PI / 180,
-        0,
-        1,
-        1.1,
-        "Fine values\nNo detents",
-    },
-    {
-        256,
-        127,
-        1 * PI / 180,
-        1,
-        10,
-        1.1,
-        "Fine values\nWith detents",
-    },
-    {
-        32,
-        0,
-        8.225806452 * PI / 180,
-        2,
-        10,
-        1.1,
-        "Coarse values\nStrong detents",
-    },
-    {
-        32,
-        0,
-        8.225806452 * PI / 180,
-        0.2,
-        10,
-        1.1,
-        "Coarse values\nWeak detents",
-    },
-};
-
-InterfaceTask::InterfaceTask(const uint8_t task_core, MotorTask& motor_task, DisplayTask* display_task) : Task("Interface", 4048, 1, task_core), motor_task_(motor_task), display_task_(display_task) {
+// Erasing or writing flash stalls the motor loop too, which mustn't count as a fault
+static void excuseFlashStall(void* arg, bool stalling) {
+    MotorTask* motor_task = static_cast<MotorTask*>(arg);
+    if (stalling) {
+        motor_task->suspendWatchdog();
+    } else {
+        motor_task->resumeWatchdog();
+    }
+}
+
+InterfaceTask::InterfaceTask(const uint8_t task_core, MotorTask& motor_task, DisplayTask* display_task, LedTask* led_task, I2CBus& i2c_bus) : Task("Interface", task_core), motor_task_(motor_task), display_task_(display_task), led_task_(led_task), i2c_bus_(i2c_bus), protocol_(uart_serial), config_flash_(CONFIG_PARTITION_LABEL, CONFIG_PARTITION_SUBTYPE), config_store_(config_flash_), position_flash_(POSITION_PARTITION_LABEL, POSITION_PARTITION_SUBTYPE), position_log_(position_flash_) {
+    knob_state_queue_ = xQueueCreate(1, sizeof(KnobState));
+    assert(knob_state_queue_ != NULL);
+
     #if (defined(SK_DISPLAY) && (SK_DISPLAY >0))
         assert(display_task != nullptr);
     #endif
+    #if (defined(SK_LEDS) && (SK_LEDS >0))
+        assert(led_task != nullptr);
+    #endif
+}
+
+InterfaceTask::~InterfaceTask() {
+    vQueueDelete(knob_state_queue_);
 }
 
-InterfaceTask::~InterfaceTask() {}
+QueueHandle_t InterfaceTask::getKnobStateQueue() {
+    return knob_state_queue_;
+}
 
 void InterfaceTask::run() {
-    #if PIN_BUTTON_NEXT >= 34
-        pinMode(PIN_BUTTON_NEXT, INPUT);
-    #else
-        pinMode(PIN_BUTTON_NEXT, INPUT_PULLUP);
+    #if PIN_BUTTON_NEXT > -1
+        button_next.begin(xTaskGetCurrentTaskHandle());
     #endif
-    AceButton button_next((uint8_t) PIN_BUTTON_NEXT);
-    button_next.getButtonConfig()->setIEventHandler(this);
-
     #if PIN_BUTTON_PREV > -1
-        #if PIN_BUTTON_PREV >= 34
-            pinMode(PIN_BUTTON_PREV, INPUT);
-        #else
-            pinMode(PIN_BUTTON_PREV, INPUT_PULLUP);
-        #endif
-        AceButton button_prev((uint8_t) PIN_BUTTON_PREV);
-        button_prev.getButtonConfig()->setIEventHandler(this);
-    #endif
-    
-    #if (defined(SK_LEDS) && (SK_LEDS >0))
-        FastLED.addLeds<SK6812, PIN_LED_DATA, GRB>(leds, NUM_LEDS);
+        button_prev.begin(xTaskGetCurrentTaskHandle());
     #endif
+    button_recheck_job_ = scheduler_.add([](void* arg) { static_cast<InterfaceTask*>(arg)->handleButtons(); }, this, 0);
 
-    #if PIN_SDA >= 0 && PIN_SCL >= 0
-        Wire.begin(PIN_SDA, PIN_SCL);
-        Wire.setClock(400000);
-    #endif
     #if (defined(SK_STRAIN) && (SK_STRAIN > 0))
-        scale.begin(38, 2);
+        strain.begin(xTaskGetCurrentTaskHandle(), EVENT_STRAIN_SAMPLE);
+        uint8_t strain_job = scheduler_.add([](void* arg) { static_cast<InterfaceTask*>(arg)->checkStrain(); }, this, STRAIN_CHECK_MILLIS);
+        scheduler_.schedule(strain_job, millis() + STRAIN_CHECK_MILLIS);
     #endif
 
     #if (defined(SK_ALS) && (SK_ALS >0))
-        if (veml.begin()) {
-            veml.setGain(VEML7700_GAIN_2);
-            veml.setIntegrationTime(VEML7700_IT_400MS);
+        if (als.begin(i2c_bus_)) {
+            als_job_ = scheduler_.add([](void* arg) { static_cast<InterfaceTask*>(arg)->updateAls(); }, this, 0);
+            scheduler_.schedule(als_job_, als.getNextReadMillis());
         } else {
-            Serial.println("ALS sensor not found!");
+            LOG_WARNING("ALS sensor not found!");
         }
     #endif
 
-    motor_task_.setConfig(configs[0]);
+    #if PIN_SDA >= 0 && PIN_SCL >= 0
+        uint8_t i2c_stats_job = scheduler_.add([](void* arg) { static_cast<InterfaceTask*>(arg)->i2c_bus_.logStats(); }, this, I2C_STATS_MILLIS);
+        scheduler_.schedule(i2c_stats_job, millis() + I2C_STATS_MILLIS);
+    #endif
 
-    // How far button is pressed, in range [0, 1]
-    float press_value_unit = 0;
+    uart_serial.notifyOnReceive(xTaskGetCurrentTaskHandle(), EVENT_SERIAL);
+    state_stream_job_ = scheduler_.add([](void* arg) { static_cast<InterfaceTask*>(arg)->streamState(); }, this, 0);
+    telemetry_stream_job_ = scheduler_.add([](void* arg) { static_cast<InterfaceTask*>(arg)->streamTelemetry(); }, this, 0);
 
-    // Interface loop:
+    config_flash_.setStallFunction(excuseFlashStall, &motor_task_);
+    position_flash_.setStallFunction(excuseFlashStall, &motor_task_);
+    if (!config_flash_.begin()) {
+        LOG_WARNING("Config library partition not found, using built-in configs");
+    } else if (config_store_.begin()) {
+        LOG_INFO("Loaded %u configs from flash", config_store_.getLibrary().getCount());
+    }
+    if (!position_flash_.begin()) {
+        LOG_WARNING("Position partition not found, positions won't be saved");
+    } else if (!position_log_.begin()) {
+        LOG_ERROR("Failed to restore positions");
+    }
+    selectConfig(0);
+    uint8_t position_job = scheduler_.add([](void* arg) { static_cast<InterfaceTask*>(arg)->checkPosition(); }, this, POSITION_CHECK_MILLIS);
+    scheduler_.schedule(position_job, millis() + POSITION_CHECK_MILLIS);
+    updateBrightness(UINT16_MAX);
+
+    HeapMonitor::seal();
+
+    // Interface loop: sleep until an interrupt, serial input or the next scheduled job
+    TickType_t wait = 0;
     while (1) {
-        button_next.check();
-        #if PIN_BUTTON_PREV > -1
-            button_prev.check();
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, wait);
+        ProfileScope scope(ProfileSection::INTERFACE);
+
+        if (events & (EVENT_BUTTON_NEXT | EVENT_BUTTON_PREV)) {
+            handleButtons();
+        }
+        #if (defined(SK_STRAIN) && (SK_STRAIN > 0))
+            if (events & EVENT_STRAIN_SAMPLE) {
+                handleStrainSamples();
+            }
         #endif
-        if (Serial.available()) {
-            int v = Serial.read();
-            if (v == ' ') {
-                changeConfig(true);
+        if (events & EVENT_SERIAL) {
+            handleSerial();
+        }
+
+        wait = scheduler_.run(millis());
+    }
+}
+
+void InterfaceTask::handleButtons() {
+    uint32_t now = millis();
+    bool needs_recheck = false;
+    uint32_t recheck_millis = 0;
+
+    #if PIN_BUTTON_NEXT > -1
+        if (button_next.update(now) == ButtonEvent::PRESSED) {
+            changeConfig(true);
+        }
+        if (button_next.needsRecheck()) {
+            needs_recheck = true;
+            recheck_millis = button_next.getRecheckMillis();
+        }
+    #endif
+    #if PIN_BUTTON_PREV > -1
+        if (button_prev.update(now) == ButtonEvent::PRESSED) {
+            changeConfig(false);
+        }
+        if (button_prev.needsRecheck() && (!needs_recheck || (int32_t)(button_prev.getRecheckMillis() - recheck_millis) < 0)) {
+            needs_recheck = true;
+            recheck_millis = button_prev.getRecheckMillis();
+        }
+    #endif
+
+    if (needs_recheck) {
+        scheduler_.schedule(button_recheck_job_, recheck_millis);
+    }
+}
+
+void InterfaceTask::handleStrainSamples() {
+    #if (defined(SK_STRAIN) && (SK_STRAIN > 0))
+        StrainSample sample;
+        bool received = false;
+        while (strain.read(sample)) {
+            static uint32_t last_reading_display;
+            if (millis() - last_reading_display > 1000) {
+                LOG_DEBUG("HX711 reading: %d (baseline %d)", sample.value, (int32_t)press_detector.getBaseline());
+                last_reading_display = millis();
+            }
+
+            if (press_detector.update(sample.value, sample.timestamp_micros)) {
+                handlePressLevel(press_detector.getLevel(), sample.timestamp_micros);
             }
+            received = true;
         }
 
-        #if (defined(SK_ALS) && (SK_ALS >0))
-            const float LUX_ALPHA = 0.005;
-            static float lux_avg;
-            float lux = veml.readLux();
-            lux_avg = lux * LUX_ALPHA + lux_avg * (1 - LUX_ALPHA);
-            static uint32_t last_als;
-            if (millis() - last_als > 1000) {
-                Serial.print("millilux: "); Serial.println(lux*1000);
-                last_als = millis();
+        #if (defined(SK_LEDS) && (SK_LEDS >0))
+            if (received) {
+                led_task_->setPress((uint8_t)(press_detector.getValueUnit() * 255));
             }
         #endif
+    #endif
+}
 
-        #if (defined(SK_STRAIN) && (SK_STRAIN > 0))
-            // TODO: calibrate and track (long term moving average) zero point (lower); allow calibration of set point offset
-            const int32_t lower = 950000;
-            const int32_t upper = 1800000;
-            if (scale.wait_ready_timeout(100)) {
-                int32_t reading = scale.read();
-
-                // Ignore readings that are way out of expected bounds
-                if (reading >= lower - (upper - lower) && reading < upper + (upper - lower)*2) {
-                    static uint32_t last_reading_display;
-                    if (millis() - last_reading_display > 1000) {
-                        Serial.print("HX711 reading: ");
-                        Serial.println(reading);
-                        last_reading_display = millis();
-                    }
-                    long value = CLAMP(reading, lower, upper);
-                    press_value_unit = 1. * (value - lower) / (upper - lower);
-
-                    static bool pressed;
-                    if (!pressed && press_value_unit > 0.75) {
-                        motor_task_.playHaptic(true);
-                        pressed = true;
-                        changeConfig(true);
-                    } else if (pressed && press_value_unit < 0.25) {
-                        motor_task_.playHaptic(false);
-                        pressed = false;
-                    }
-                }
-            } else {
-                Serial.println("HX711 not found.");
-
-                #if (defined(SK_LEDS) && (SK_LEDS >0))
-                    for (uint8_t i = 0; i < NUM_LEDS; i++) {
-                        leds[i] = CRGB::Red;
-                    }
-                    FastLED.show();
-                #endif
+void InterfaceTask::checkStrain() {
+    #if (defined(SK_STRAIN) && (SK_STRAIN > 0))
+        uint32_t last_sample = strain.getLastSampleMicros();
+        bool strain_missing = last_sample == 0 || micros() - last_sample > STRAIN_TIMEOUT_MICROS;
+        if (strain_missing) {
+            static uint32_t last_missing_display;
+            if (millis() - last_missing_display > 1000) {
+                LOG_WARNING("HX711 not found.");
+                last_missing_display = millis();
             }
+        }
+        #if (defined(SK_LEDS) && (SK_LEDS >0))
+            led_task_->setFault(strain_missing);
         #endif
+    #endif
+}
 
-        uint16_t brightness = UINT16_MAX;
-        // TODO: brightness scale factor should be configurable (depends on reflectivity of surface)
-        #if (defined(SK_ALS) && (SK_ALS >0))
-            brightness = (uint16_t)CLAMP(lux_avg * 13000, (float)1280, (float)UINT16_MAX);
-        #endif
+void InterfaceTask::updateAls() {
+    #if (defined(SK_ALS) && (SK_ALS >0))
+        if (als.update()) {
+            static uint32_t last_als;
+            if (millis() - last_als > 1000) {
+                LOG_DEBUG("millilux: %.1f (%u reads)", als.getLux() * 1000, als.getReadCount());
+                last_als = millis();
+            }
 
-        #if (defined(SK_DISPLAY) && (SK_DISPLAY >0))
-            display_task_->setBrightness(brightness); // TODO: apply gamma correction
-        #endif
+            // TODO: brightness scale factor should be configurable (depends on reflectivity of surface)
+            updateBrightness((uint16_t)CLAMP(als.getLux() * 13000, (float)1280, (float)UINT16_MAX));
+        }
+        scheduler_.schedule(als_job_, als.getNextReadMillis());
+    #endif
+}
 
-        #if (defined(SK_LEDS) && (SK_LEDS >0))
-            for (uint8_t i = 0; i < NUM_LEDS; i++) {
-                leds[i].setHSV(200 * press_value_unit, 255, brightness >> 8);
+void InterfaceTask::handleSerial() {
+    while (protocol_.receive()) {
+        handleMessage(protocol_.getMessage());
+    }
+}
 
-                // Gamma adjustment
-                leds[i].r = dim8_video(leds[i].r);
-                leds[i].g = dim8_video(leds[i].g);
-                leds[i].b = dim8_video(leds[i].b);
+void InterfaceTask::handleMessage(const FrameDecoder& message) {
+    AckStatus status = AckStatus::OK;
+    switch (message.getId()) {
+        case MessageId::PING:
+            break;
+        case MessageId::SET_CONFIG: {
+            KnobConfig config = {};
+            if (!decodeConfig(message.getBody(), message.getBodyLength(), config)) {
+                status = AckStatus::INVALID;
+                break;
             }
-            FastLED.show();
-        #endif
+            deferPosition();
+            custom_config_ = true;
+            // Custom configs have no id; trackPosition() ignores their states anyway
+            motor_task_.setConfig(config, 0);
+            break;
+        }
+        case MessageId::COMMAND: {
+            PayloadReader reader(message.getBody(), message.getBodyLength());
+            CommandId command = (CommandId)reader.u8();
+            if (!reader.ok()) {
+                status = AckStatus::INVALID;
+                break;
+            }
+            switch (command) {
+                case CommandId::NEXT_CONFIG:
+                    changeConfig(true);
+                    break;
+                case CommandId::PREVIOUS_CONFIG:
+                    changeConfig(false);
+                    break;
+                case CommandId::HAPTIC_PRESS:
+                    motor_task_.playHaptic(true);
+                    break;
+                case CommandId::HAPTIC_RELEASE:
+                    motor_task_.playHaptic(false);
+                    break;
+                case CommandId::LOG_STACKS:
+                    logTaskStacks();
+                    break;
+                case CommandId::LOG_PROFILE:
+                    Profiler::log();
+                    break;
+                case CommandId::LOG_HEAP:
+                    HeapMonitor::log();
+                    break;
+                case CommandId::FREEZE_RECORDING:
+                    FlightRecorder::freeze(FlightFreezeReason::REQUESTED);
+                    break;
+                default:
+                    status = AckStatus::UNSUPPORTED;
+                    break;
+            }
+            break;
+        }
+        case MessageId::LIBRARY_BEGIN: {
+            PayloadReader reader(message.getBody(), message.getBodyLength());
+            uint32_t size = reader.u32();
+            bool had_library = config_store_.getLibrary().isLoaded();
+            if (!reader.ok() || !config_store_.beginUpload(size)) {
+                status = AckStatus::INVALID;
+            }
+            // Once the upload has started (or failed erasing), the flash library is gone until the upload is committed
+            if (had_library && !config_store_.getLibrary().isLoaded()) {
+                selectConfig(0);
+            }
+            break;
+        }
+        case MessageId::LIBRARY_WRITE: {
+            PayloadReader reader(message.getBody(), message.getBodyLength());
+            uint32_t offset = reader.u32();
+            if (!reader.ok(false) || !config_store_.writeUpload(offset, message.getBody() + 4, message.getBodyLength() - 4)) {
+                status = AckStatus::INVALID;
+            }
+            break;
+        }
+        case MessageId::LIBRARY_COMMIT:
+            if (!config_store_.commitUpload()) {
+                status = AckStatus::INVALID;
+            }
+            LOG_INFO("Config library upload %s, %u configs", status == AckStatus::OK ? "committed" : "failed", getConfigCount());
+            selectConfig(0);
+            break;
+        case MessageId::SELECT_CONFIG: {
+            PayloadReader reader(message.getBody(), message.getBodyLength());
+            int32_t index = findConfig(reader.u32());
+            if (!reader.ok() || index < 0) {
+                status = AckStatus::INVALID;
+                break;
+            }
+            selectConfig(index);
+            break;
+        }
+        case MessageId::GET_LATENCY: {
+            PayloadReader reader(message.getBody(), message.getBodyLength());
+            bool reset = reader.u8() != 0;
+            if (!reader.ok()) {
+                status = AckStatus::INVALID;
+                break;
+            }
+            for (uint8_t i = 0; i < (uint8_t)LatencyPath::COUNT; i++) {
+                LatencyMessage latency;
+                LatencyTrace::read((LatencyPath)i, latency);
+                protocol_.sendLatency(latency);
+            }
+            if (reset) {
+                LatencyTrace::reset();
+            }
+            break;
+        }
+        case MessageId::GET_RECORDING: {
+            PayloadReader reader(message.getBody(), message.getBodyLength());
+            bool clear = reader.u8() != 0;
+            if (!reader.ok()) {
+                status = AckStatus::INVALID;
+                break;
+            }
+            // At least one message, so an empty capture still reports its state
+            RecordingMessage recording;
+            uint16_t first = 0;
+            do {
+                FlightRecorder::read(first, recording);
+                protocol_.sendRecording(recording);
+                first += recording.count;
+            } while (recording.count > 0 && first < recording.total);
+            if (clear) {
+                FlightRecorder::clear();
+            }
+            break;
+        }
+        case MessageId::SET_STREAM:
+            if (!decodeStream(message.getBody(), message.getBodyLength(), stream_)) {
+                stream_ = {};
+                status = AckStatus::INVALID;
+            }
+            if (stream_.state_interval_millis > 0) {
+                scheduler_.schedule(state_stream_job_, millis());
+            } else {
+                scheduler_.cancel(state_stream_job_);
+            }
+            if (stream_.telemetry_interval_millis > 0) {
+                scheduler_.schedule(telemetry_stream_job_, millis());
+            } else {
+                scheduler_.cancel(telemetry_stream_job_);
+            }
+            break;
+        default:
+            status = AckStatus::UNSUPPORTED;
+            break;
+    }
+    protocol_.sendAck(message.getSequence(), status);
+}
 
-        delay(10);
+void InterfaceTask::streamState() {
+    // Only send states the host hasn't seen yet
+    KnobState state;
+    if (xQueueReceive(knob_state_queue_, &state, 0) == pdTRUE) {
+        trackPosition(state);
+        protocol_.sendState({
+            .current_position = state.current_position,
+            .sub_position_unit = state.sub_position_unit,
+            .sub_position_velocity_unit = state.sub_position_velocity_unit,
+            .timestamp_micros = state.timestamp_micros,
+            .num_positions = state.config.num_positions,
+            .config_index = (uint8_t)(custom_config_ ? UINT8_MAX : current_config_),
+        });
     }
+    scheduler_.schedule(state_stream_job_, millis() + stream_.state_interval_millis);
+}
+
+void InterfaceTask::streamTelemetry() {
+    TelemetryMessage telemetry = {
+        .uptime_millis = millis(),
+        .press_level = (uint8_t)press_level_,
+        .press_value_unit = 0,
+        .lux = 0,
+        .free_heap = ESP.getFreeHeap(),
+    };
+    #if (defined(SK_STRAIN) && (SK_STRAIN > 0))
+        telemetry.press_value_unit = press_detector.getValueUnit();
+    #endif
+    #if (defined(SK_ALS) && (SK_ALS >0))
+        telemetry.lux = als.getLux();
+    #endif
+    protocol_.sendTelemetry(telemetry);
+    scheduler_.schedule(telemetry_stream_job_, millis() + stream_.telemetry_interval_millis);
+}
+
+void InterfaceTask::updateBrightness(uint16_t brightness) {
+    #if (defined(SK_DISPLAY) && (SK_DISPLAY >0))
+        display_task_->setBrightness(brightness); // TODO: apply gamma correction
+    #endif
+    #if (defined(SK_LEDS) && (SK_LEDS >0))
+        led_task_->setBrightness(brightness);
+    #endif
 }
 
-void InterfaceTask::handleEvent(AceButton* button, uint8_t event_type, uint8_t button_state) {
-    switch (event_type) {
-        case AceButton::kEventPressed:
-            if (button->getPin() == PIN_BUTTON_NEXT) {
+void InterfaceTask::handlePressLevel(PressLevel level, uint32_t sample_micros) {
+    switch (level) {
+        case PressLevel::PRESS:
+        case PressLevel::HARD_PRESS:
+            if (press_level_ < PressLevel::PRESS) {
+                motor_task_.playHaptic(true);
                 changeConfig(true);
+            } else if (level == PressLevel::HARD_PRESS) {
+                // Second click when pushing further into a hard press
+                motor_task_.playHaptic(true);
             }
-            #if PIN_BUTTON_PREV > -1
-                if (button->getPin() == PIN_BUTTON_PREV) {
-                    changeConfig(false);
-                }
-            #endif
             break;
-        case AceButton::kEventReleased:
+        case PressLevel::NONE:
+        case PressLevel::LIGHT_TOUCH:
+            if (press_level_ >= PressLevel::PRESS) {
+                motor_task_.playHaptic(false);
+            }
             break;
     }
+
+    // Time from the HX711 signaling the sample to the new level being acted on
+    uint32_t latency = micros() - sample_micros;
+    max_press_latency_micros_ = max(max_press_latency_micros_, latency);
+    LOG_INFO("Press level %d -> %d, latency %u us (max %u us)", (int)press_level_, (int)level, latency, max_press_latency_micros_);
+
+    press_level_ = level;
+}
+
+uint32_t InterfaceTask::getConfigCount() {
+    const ConfigLibrary& library = config_store_.getLibrary();
+    return library.isLoaded() ? library.getCount() : BUILTIN_CONFIG_COUNT;
+}
+
+const KnobConfig& InterfaceTask::getConfig(uint32_t index) {
+    const ConfigLibrary& library = config_store_.getLibrary();
+    return library.isLoaded() ? library.get(index).config : BUILTIN_CONFIGS[index];
+}
+
+uint32_t InterfaceTask::getConfigId(uint32_t index) {
+    const ConfigLibrary& library = config_store_.getLibrary();
+    return library.isLoaded() ? library.get(index).id : index + 1;
+}
+
+int32_t InterfaceTask::findConfig(uint32_t id) {
+    const ConfigLibrary& library = config_store_.getLibrary();
+    if (library.isLoaded()) {
+        return library.find(id);
+    }
+    // Built-in configs are numbered from 1
+    return id >= 1 && id <= BUILTIN_CONFIG_COUNT ? id - 1 : -1;
 }
 
 void InterfaceTask::changeConfig(bool next) {
+    uint32_t count = getConfigCount();
     if (next) {
-        current_config_ = (current_config_ + 1) % COUNT_OF(configs);
+        selectConfig((current_config_ + 1) % count);
     } else {
-        if (current_config_ == 0) {
-            current_config_ = COUNT_OF(configs) - 1;
-        } else {
-            current_config_ --;
+        selectConfig(current_config_ == 0 ? count - 1 : current_config_ - 1);
+    }
+}
+
+void InterfaceTask::selectConfig(uint32_t index) {
+    // Switching configs doesn't write flash itself (or switching back and forth would wear it): a position that
+    // hasn't been saved yet waits for the knob to rest
+    deferPosition();
+
+    current_config_ = index;
+    current_config_id_ = getConfigId(index);
+    active_config_ = getConfig(index);
+    int32_t position;
+    if (position_log_.get(current_config_id_, position)) {
+        active_config_.position = position;
+    }
+    saved_position_ = active_config_.position;
+    // One left unsaved when this config was last switched away from is newer than the log's
+    if (takeUnsavedPosition(current_config_id_, position)) {
+        active_config_.position = position;
+    }
+    if (active_config_.num_positions > 0) {
+        active_config_.position = CLAMP(active_config_.position, (int32_t)0, active_config_.num_positions - 1);
+    }
+
+    // Not the descriptor: the logger formats later, by which time active_config_ may hold the next config
+    LOG_INFO("Changing config to %u (id %u)", current_config_, current_config_id_);
+    custom_config_ = false;
+    motor_task_.setConfig(active_config_, current_config_id_);
+}
+
+void InterfaceTask::checkPosition() {
+    KnobState state;
+    if (xQueuePeek(knob_state_queue_, &state, 0) == pdTRUE) {
+        trackPosition(state);
+    }
+    if (millis() - position_changed_millis_ >= POSITION_IDLE_MILLIS) {
+        savePositions();
+    }
+}
+
+void InterfaceTask::trackPosition(const KnobState& state) {
+    // Ignore states from a config the motor task hasn't switched away from yet
+    if (custom_config_ || state.config_id != current_config_id_) {
+        return;
+    }
+    if (state.current_position != active_config_.position) {
+        active_config_.position = state.current_position;
+        position_changed_millis_ = millis();
+    }
+}
+
+void InterfaceTask::deferPosition() {
+    // Switching counts as activity, so flicking through configs writes nothing until the knob rests
+    position_changed_millis_ = millis();
+    if (custom_config_ || active_config_.position == saved_position_) {
+        return;
+    }
+    if (unsaved_position_count_ == MAX_UNSAVED_POSITIONS) {
+        // Only after switching through that many turned configs without a rest: make room by writing the oldest
+        writePosition(unsaved_positions_[0].config_id, unsaved_positions_[0].position);
+        memmove(unsaved_positions_, unsaved_positions_ + 1, (MAX_UNSAVED_POSITIONS - 1) * sizeof(UnsavedPosition));
+        unsaved_position_count_--;
+    }
+    unsaved_positions_[unsaved_position_count_++] = {current_config_id_, active_config_.position};
+    saved_position_ = active_config_.position;
+}
+
+bool InterfaceTask::takeUnsavedPosition(uint32_t config_id, int32_t& position) {
+    for (uint8_t i = 0; i < unsaved_position_count_; i++) {
+        if (unsaved_positions_[i].config_id == config_id) {
+            position = unsaved_positions_[i].position;
+            memmove(unsaved_positions_ + i, unsaved_positions_ + i + 1, (unsaved_position_count_ - i - 1) * sizeof(UnsavedPosition));
+            unsaved_position_count_--;
+            return true;
         }
     }
-    
-    Serial.print("Changing config to ");
-    Serial.print(current_config_);
-    Serial.print(" -- ");
-    Serial.println(configs[current_config_].descriptor);
-    motor_task_.setConfig(configs[current_config_]);
+    return false;
+}
+
+void InterfaceTask::savePositions() {
+    for (uint8_t i = 0; i < unsaved_position_count_; i++) {
+        writePosition(unsaved_positions_[i].config_id, unsaved_positions_[i].position);
+    }
+    unsaved_position_count_ = 0;
+    if (!custom_config_ && active_config_.position != saved_position_) {
+        writePosition(current_config_id_, active_config_.position);
+        // Not retried on failure, so a broken partition doesn't turn into a write every check
+        saved_position_ = active_config_.position;
+    }
+}
+
+void InterfaceTask::writePosition(uint32_t config_id, int32_t position) {
+    if (!position_log_.write(config_id, position)) {
+        LOG_ERROR("Failed to save position");
+    }
 }
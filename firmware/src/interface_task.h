@@ -1,20 +1,35 @@
 #pragma once
 
-#include <AceButton.h>
 #include <Arduino.h>
 
+#include "config_library.h"
 #include "display_task.h"
+#include "i2c_bus.h"
+#include "led_task.h"
 #include "motor_task.h"
+#include "partition_flash_region.h"
+#include "position_log.h"
+#include "press_detector.h"
+#include "scheduler.h"
+#include "serial_protocol.h"
 #include "task.h"
+#include "task_config.h"
 
-class InterfaceTask : public Task<InterfaceTask>, public ace_button::IEventHandler {
-    friend class Task<InterfaceTask>; // Allow base Task to invoke protected run()
+static const uint32_t INTERFACE_TASK_STACK_SIZE = 4048;
+// Configs switched away from whose positions can wait for the knob to rest before they're saved
+static const uint8_t MAX_UNSAVED_POSITIONS = 4;
+
+// Event-driven: sleeps on its task notification until a button or sensor interrupt fires, serial input arrives or a
+// scheduled job is due. Runs above the display and LED tasks so it can react to interrupts right away.
+class InterfaceTask : public Task<InterfaceTask, INTERFACE_TASK_STACK_SIZE, INTERFACE_TASK_PRIORITY> {
+    template<class, uint32_t, UBaseType_t> friend class Task; // Allow base Task to invoke protected run()
 
     public:
-        InterfaceTask(const uint8_t task_core, MotorTask& motor_task, DisplayTask* display_task);
+        InterfaceTask(const uint8_t task_core, MotorTask& motor_task, DisplayTask* display_task, LedTask* led_task, I2CBus& i2c_bus);
         ~InterfaceTask();
 
-        void handleEvent(ace_button::AceButton* button, uint8_t event_type, uint8_t button_state) override;
+        // Knob state feed, streamed to the host when requested
+        QueueHandle_t getKnobStateQueue();
 
     protected:
         void run();
@@ -22,8 +37,67 @@ class InterfaceTask : public Task<InterfaceTask>, public ace_button::IEventHandl
     private:
         MotorTask& motor_task_;
         DisplayTask* display_task_;
+        LedTask* led_task_;
+        I2CBus& i2c_bus_;
+
+        QueueHandle_t knob_state_queue_;
+        SerialProtocol protocol_;
+
+        Scheduler scheduler_;
+        uint8_t button_recheck_job_;
+        uint8_t als_job_;
+        uint8_t state_stream_job_;
+        uint8_t telemetry_stream_job_;
+        StreamMessage stream_ = {};
+
+        PartitionFlashRegion config_flash_;
+        ConfigLibraryStore config_store_;
+
+        PartitionFlashRegion position_flash_;
+        PositionLog position_log_;
+
+        uint32_t current_config_ = 0;
+        uint32_t current_config_id_ = 0;
+        // The selected config, with its position kept up to date from the knob state
+        KnobConfig active_config_ = {};
+        int32_t saved_position_ = 0;
+        uint32_t position_changed_millis_ = 0;
+        struct UnsavedPosition {
+            uint32_t config_id;
+            int32_t position;
+        };
+        // Positions of configs switched away from before they were saved, oldest first
+        UnsavedPosition unsaved_positions_[MAX_UNSAVED_POSITIONS] = {};
+        uint8_t unsaved_position_count_ = 0;
+        // Set while running a config uploaded by the host rather than one from configs[]
+        bool custom_config_ = false;
 
-        int current_config_ = 0;
+        PressLevel press_level_ = PressLevel::NONE;
+        uint32_t max_press_latency_micros_ = 0;
 
+        void handleButtons();
+        void handleStrainSamples();
+        void checkStrain();
+        void updateAls();
+        void handleSerial();
+        void handleMessage(const FrameDecoder& message);
+        void streamState();
+        void streamTelemetry();
+        void updateBrightness(uint16_t brightness);
+        void handlePressLevel(PressLevel level, uint32_t sample_micros);
+        uint32_t getConfigCount();
+        const KnobConfig& getConfig(uint32_t index);
+        uint32_t getConfigId(uint32_t index);
+        // Returns the index of the config with the given id, or -1
+        int32_t findConfig(uint32_t id);
         void changeConfig(bool next);
+        void selectConfig(uint32_t index);
+        void checkPosition();
+        void trackPosition(const KnobState& state);
+        // Sets the selected config's position aside, when unsaved, for savePositions() to write later
+        void deferPosition();
+        // Removes and returns the position set aside for a config, if any
+        bool takeUnsavedPosition(uint32_t config_id, int32_t& position);
+        void savePositions();
+        void writePosition(uint32_t config_id, int32_t position);
 };
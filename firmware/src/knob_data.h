@@ -1,6 +1,21 @@
 #pragma once
 
-#include <Arduino.h>
+#include <stdint.h>
+
+// Selects the set of widgets the display uses for a config
+enum class DisplayLayout : uint8_t {
+    FILL = 0,
+    DIAL,
+};
+
+// Selects what the LED ring shows for a config
+enum class LedEffect : uint8_t {
+    // Whole ring colored by how hard the knob is pressed
+    PRESS_HUE = 0,
+    // Pointer at the knob's angle over a glow that follows the press, flashing when pushed past an endstop
+    POSITION,
+    OFF,
+};
 
 struct KnobConfig {
     int32_t num_positions;
@@ -10,10 +25,24 @@ struct KnobConfig {
     float endstop_strength_unit;
     float snap_point;
     char descriptor[50];
+    DisplayLayout display_layout;
+    LedEffect led_effect;
 };
 
 struct KnobState {
     int32_t current_position;
     float sub_position_unit;
     KnobConfig config;
+    // As given to MotorTask::setConfig()
+    uint32_t config_id;
+
+    // When the angle behind sub_position_unit was sampled (micros() timebase)
+    uint32_t timestamp_micros;
+    // Rate of change of sub_position_unit, in units per second
+    float sub_position_velocity_unit;
+
+    // Motor loop iteration that produced this state, and when the sensor sample it's based on was taken (see
+    // LatencyTrace)
+    uint32_t sequence;
+    uint32_t sensor_micros;
 };
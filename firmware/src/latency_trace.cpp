@@ -0,0 +1,50 @@
+#include "latency_trace.h"
+
+LatencyTrace::Path LatencyTrace::paths_[(uint8_t)LatencyPath::COUNT];
+std::atomic<uint32_t> LatencyTrace::epoch_;
+
+void LatencyTrace::record(LatencyPath path, uint32_t sensor_micros) {
+    uint32_t latency = micros() - sensor_micros;
+
+    Path& p = paths_[(uint8_t)path];
+    uint32_t sequence = p.sequence.load(std::memory_order_relaxed);
+    p.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint32_t epoch = epoch_.load(std::memory_order_relaxed);
+    if (p.epoch != epoch) {
+        p.epoch = epoch;
+        p.max_micros = 0;
+        memset(p.buckets, 0, sizeof(p.buckets));
+    }
+    p.buckets[latencyBucket(latency)]++;
+    if (latency > p.max_micros) {
+        p.max_micros = latency;
+    }
+
+    p.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void LatencyTrace::read(LatencyPath path, LatencyMessage& message) {
+    Path& p = paths_[(uint8_t)path];
+    uint32_t epoch = epoch_.load(std::memory_order_relaxed);
+    bool current;
+    uint32_t sequence;
+    do {
+        sequence = p.sequence.load(std::memory_order_acquire);
+        current = p.epoch == epoch;
+        message.max_micros = p.max_micros;
+        memcpy(message.buckets, p.buckets, sizeof(message.buckets));
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) != 0 || sequence != p.sequence.load(std::memory_order_relaxed));
+
+    message.path = path;
+    if (!current) {
+        message.max_micros = 0;
+        memset(message.buckets, 0, sizeof(message.buckets));
+    }
+}
+
+void LatencyTrace::reset() {
+    epoch_.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+#include "protocol.h"
+
+// Latency histograms for the paths from a sensor sample to torque and to pixels (see LatencyPath). The sample's time
+// and the motor loop iteration that used it travel with the KnobState, so each stage can tell how old the data it's
+// acting on is. Each path is recorded by a single task, lock-free, with the sequence counter and epoch scheme
+// Profiler uses; a record costs a few dozen cycles.
+class LatencyTrace {
+    public:
+        // Records the time from sensor_micros until now
+        static void record(LatencyPath path, uint32_t sensor_micros);
+
+        // Copies the path's histogram since the last reset
+        static void read(LatencyPath path, LatencyMessage& message);
+
+        // Starts a new window; every path starts over on its next record
+        static void reset();
+
+    private:
+        struct Path {
+            // Odd while the recording task is updating the fields below
+            std::atomic<uint32_t> sequence;
+            uint32_t epoch;
+            uint32_t max_micros;
+            uint32_t buckets[LATENCY_BUCKETS];
+        };
+
+        static Path paths_[(uint8_t)LatencyPath::COUNT];
+        static std::atomic<uint32_t> epoch_;
+};
@@ -0,0 +1,182 @@
+#if (defined(SK_LEDS) && (SK_LEDS >0))
+#include "heap_monitor.h"
+#include "led_task.h"
+#include "profiler.h"
+#include "semaphore_guard.h"
+
+// Re-render at least this often while nothing is published, so timed effects (endstop flash) keep animating
+static const TickType_t FRAME_PERIOD_TICKS = pdMS_TO_TICKS(16);
+
+// Angles below are in 1/65536ths of a turn, in the display's convention (16384 is the top, increasing
+// counter-clockwise). Where the first LED sits depends on the board; override with -DSK_LED_0_ANGLE=...
+#ifndef SK_LED_0_ANGLE
+#define SK_LED_0_ANGLE 49152
+#endif
+static const uint16_t LED_0_ANGLE = SK_LED_0_ANGLE;
+static const uint16_t LED_SPACING = 65536 / NUM_LEDS;
+
+static const uint8_t PRESS_HUE_MAX = 200;
+static const uint8_t POINTER_HUE = 160;
+// Press glow brightness at a full press, relative to the pointer
+static const uint8_t PRESS_GLOW_VALUE = 128;
+
+static const uint32_t ENDSTOP_FLASH_MILLIS = 300;
+// How far past an endstop (in detents) the knob has to be pushed to flash, and how far back it has to come before it
+// can flash again. A knob resting against the endstop dithers around it, which would otherwise keep re-triggering.
+static const float ENDSTOP_ENTER_UNIT = 0.2;
+static const float ENDSTOP_EXIT_UNIT = 0.1;
+
+LedTask::LedTask(const uint8_t task_core) : Task{"LED", task_core} {
+    knob_state_queue_ = xQueueCreate(1, sizeof(KnobState));
+    assert(knob_state_queue_ != NULL);
+
+    mutex_ = xSemaphoreCreateMutex();
+    assert(mutex_ != NULL);
+}
+
+LedTask::~LedTask() {
+    vQueueDelete(knob_state_queue_);
+    vSemaphoreDelete(mutex_);
+}
+
+void LedTask::run() {
+    FastLED.addLeds<SK6812, PIN_LED_DATA, GRB>(leds_, NUM_LEDS);
+    bool first_frame = true;
+    HeapMonitor::seal();
+
+    while (1) {
+        xQueueReceive(knob_state_queue_, &state_, FRAME_PERIOD_TICKS);
+        ProfileScope frame_scope(ProfileSection::LED_FRAME);
+
+        uint16_t brightness;
+        uint8_t press_value;
+        bool fault;
+        {
+            SemaphoreGuard lock(mutex_);
+            brightness = brightness_;
+            press_value = press_value_;
+            fault = fault_;
+        }
+
+        uint32_t now = millis();
+        if (fault) {
+            for (uint8_t i = 0; i < NUM_LEDS; i++) {
+                frame_[i] = CRGB::Red;
+            }
+        } else {
+            render(now, brightness >> 8, press_value);
+        }
+
+        bool changed = first_frame;
+        for (uint8_t i = 0; i < NUM_LEDS; i++) {
+            if (frame_[i] != leds_[i]) {
+                leds_[i] = frame_[i];
+                changed = true;
+            }
+        }
+        if (changed) {
+            ProfileScope show_scope(ProfileSection::LED_SHOW);
+            FastLED.show();
+            first_frame = false;
+        }
+    }
+}
+
+QueueHandle_t LedTask::getKnobStateQueue() {
+    return knob_state_queue_;
+}
+
+void LedTask::setBrightness(uint16_t brightness) {
+    SemaphoreGuard lock(mutex_);
+    brightness_ = brightness;
+}
+
+void LedTask::setPress(uint8_t press_value) {
+    SemaphoreGuard lock(mutex_);
+    press_value_ = press_value;
+}
+
+void LedTask::setFault(bool fault) {
+    SemaphoreGuard lock(mutex_);
+    fault_ = fault;
+}
+
+void LedTask::render(uint32_t now, uint8_t brightness, uint8_t press_value) {
+    switch (state_.config.led_effect) {
+        case LedEffect::POSITION:
+            renderPosition(press_value);
+            break;
+        case LedEffect::OFF:
+            for (uint8_t i = 0; i < NUM_LEDS; i++) {
+                frame_[i] = CRGB::Black;
+            }
+            break;
+        case LedEffect::PRESS_HUE:
+        default:
+            for (uint8_t i = 0; i < NUM_LEDS; i++) {
+                frame_[i] = CHSV(scale8(press_value, PRESS_HUE_MAX), 255, 255);
+            }
+            break;
+    }
+
+    uint8_t flash = endstopFlash(now);
+    for (uint8_t i = 0; i < NUM_LEDS; i++) {
+        frame_[i] += CRGB(flash, flash >> 2, flash >> 2);
+
+        // Ambient brightness, then gamma adjustment
+        frame_[i].nscale8_video(brightness);
+        frame_[i].r = dim8_video(frame_[i].r);
+        frame_[i].g = dim8_video(frame_[i].g);
+        frame_[i].b = dim8_video(frame_[i].b);
+    }
+}
+
+// Pointer at the knob's angle, anti-aliased across the two nearest LEDs, over a glow that follows the press
+void LedTask::renderPosition(uint8_t press_value) {
+    const KnobConfig& config = state_.config;
+    float left_bound = config.num_positions > 0 ? PI / 2 + (config.num_positions - 1) * config.position_width_radians / 2 : PI / 2;
+    float angle = left_bound - (state_.current_position + state_.sub_position_unit) * config.position_width_radians;
+    // Within one turn before converting, since an unbounded config's angle can grow past what fits an int32_t
+    uint16_t pointer = (uint16_t)(int32_t)(fmodf(angle, 2 * PI) * (65536 / (2 * PI)));
+
+    CRGB glow = CHSV(scale8(press_value, PRESS_HUE_MAX), 255, scale8(press_value, PRESS_GLOW_VALUE));
+    for (uint8_t i = 0; i < NUM_LEDS; i++) {
+        uint16_t led_angle = LED_0_ANGLE - i * LED_SPACING;
+        int32_t distance = abs((int16_t)(uint16_t)(led_angle - pointer));
+        uint8_t value = distance < LED_SPACING ? 255 - distance * 255 / LED_SPACING : 0;
+        frame_[i] = glow;
+        if (value > 0) {
+            frame_[i] += CHSV(POINTER_HUE, 255, value);
+        }
+    }
+}
+
+// Returns the flash intensity for pushing past an endstop, decaying from full when the knob first goes out of
+// bounds
+uint8_t LedTask::endstopFlash(uint32_t now) {
+    const KnobConfig& config = state_.config;
+    // How far past either endstop the knob is (a config with one position has both on it)
+    float past_endstop = 0;
+    if (config.num_positions > 0 && state_.current_position == 0) {
+        past_endstop = fmaxf(past_endstop, -state_.sub_position_unit);
+    }
+    if (config.num_positions > 0 && state_.current_position == config.num_positions - 1) {
+        past_endstop = fmaxf(past_endstop, state_.sub_position_unit);
+    }
+    bool out_of_bounds = past_endstop > (out_of_bounds_ ? ENDSTOP_EXIT_UNIT : ENDSTOP_ENTER_UNIT);
+    if (out_of_bounds && !out_of_bounds_) {
+        flash_start_millis_ = now;
+    }
+    out_of_bounds_ = out_of_bounds;
+
+    if (config.led_effect != LedEffect::POSITION) {
+        return 0;
+    }
+    uint32_t elapsed = now - flash_start_millis_;
+    if (flash_start_millis_ == 0 || elapsed >= ENDSTOP_FLASH_MILLIS) {
+        return 0;
+    }
+    return 255 - elapsed * 255 / ENDSTOP_FLASH_MILLIS;
+}
+
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#if (defined(SK_LEDS) && (SK_LEDS >0))
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include "knob_data.h"
+#include "task.h"
+#include "task_config.h"
+
+static const uint32_t LED_TASK_STACK_SIZE = 2048;
+
+// Renders the LED ring from the knob state plus inputs from the interface task. Colors are mixed with FastLED's 8-bit
+// integer math; only placing the pointer and detecting the endstops read the knob state's float angles. Frames are
+// only sent to the strip when they differ from the last one shown. FastLED drives the strip from the RMT peripheral,
+// but FastLED.show() still waits (on a semaphore, leaving the CPU to other tasks) until the frame has been clocked
+// out, about 0.3 ms for 8 LEDs. That wait happens on this task, so whoever updates the inputs never waits on it.
+class LedTask : public Task<LedTask, LED_TASK_STACK_SIZE, LED_TASK_PRIORITY> {
+    template<class, uint32_t, UBaseType_t> friend class Task; // Allow base Task to invoke protected run()
+
+    public:
+        LedTask(const uint8_t task_core);
+        ~LedTask();
+
+        QueueHandle_t getKnobStateQueue();
+
+        void setBrightness(uint16_t brightness);
+        // How far the knob is pressed, 0-255
+        void setPress(uint8_t press_value);
+        // Shows solid red (e.g. a sensor is missing) until cleared
+        void setFault(bool fault);
+
+    protected:
+        void run();
+
+    private:
+        QueueHandle_t knob_state_queue_;
+
+        SemaphoreHandle_t mutex_;
+        uint16_t brightness_ = UINT16_MAX;
+        uint8_t press_value_ = 0;
+        bool fault_ = false;
+
+        KnobState state_ = {};
+        bool out_of_bounds_ = false;
+        uint32_t flash_start_millis_ = 0;
+
+        // Buffer handed to FastLED; holds the last frame shown
+        CRGB leds_[NUM_LEDS];
+        CRGB frame_[NUM_LEDS];
+
+        void render(uint32_t now, uint8_t brightness, uint8_t press_value);
+        void renderPosition(uint8_t press_value);
+        uint8_t endstopFlash(uint32_t now);
+};
+
+#else
+
+class LedTask {};
+
+#endif
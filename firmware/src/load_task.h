@@ -0,0 +1,52 @@
+#pragma once
+
+#if (defined(SK_JITTER_LOAD) && (SK_JITTER_LOAD >0))
+
+#include <Arduino.h>
+
+#include "task.h"
+#include "uart_serial.h"
+
+static const uint32_t LOAD_TASK_STACK_SIZE = 2048;
+
+// Synthetic load for the motor loop jitter benchmark (enabled with SK_JITTER_LOAD). Every period it busy-waits for
+// a while, the way a display frame keeps the CPU while rendering into the framebuffer, then writes a burst of filler
+// text to uart_serial, which keeps the UART driver's lock and interrupt busy. Run one at the priority of each task it
+// stands in for, on the motor's core (priorities only decide anything between tasks sharing a core), and compare
+// the "motor period" line of the profile across scheduling schemes.
+template<UBaseType_t PRIORITY>
+class LoadTask : public Task<LoadTask<PRIORITY>, LOAD_TASK_STACK_SIZE, PRIORITY> {
+    template<class, uint32_t, UBaseType_t> friend class Task; // Allow base Task to invoke protected run()
+
+    public:
+        LoadTask(const char* name, const uint8_t task_core, uint32_t period_millis, uint32_t busy_micros, uint32_t serial_bytes) :
+                Task<LoadTask<PRIORITY>, LOAD_TASK_STACK_SIZE, PRIORITY>(name, task_core),
+                period_millis_(period_millis),
+                busy_micros_(busy_micros),
+                serial_bytes_(serial_bytes) {}
+
+    protected:
+        void run() {
+            static const char FILLER[] = "................................................................\n";
+            TickType_t last_wake = xTaskGetTickCount();
+            while (1) {
+                // Spins, like a plain busy-wait, so the scheduler can preempt it
+                ets_delay_us(busy_micros_);
+
+                for (uint32_t remaining = serial_bytes_; remaining > 0; ) {
+                    size_t length = min(remaining, (uint32_t)(sizeof(FILLER) - 1));
+                    uart_serial.write((const uint8_t*)FILLER + sizeof(FILLER) - 1 - length, length);
+                    remaining -= length;
+                }
+
+                vTaskDelayUntil(&last_wake, period_millis_ / portTICK_PERIOD_MS);
+            }
+        }
+
+    private:
+        const uint32_t period_millis_;
+        const uint32_t busy_micros_;
+        const uint32_t serial_bytes_;
+};
+
+#endif
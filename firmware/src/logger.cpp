@@ -0,0 +1,179 @@
+#include "heap_monitor.h"
+#include "logger.h"
+#include "uart_serial.h"
+
+static const uint32_t LOG_DRAIN_MILLIS = 20;
+static const size_t LOG_LINE_SIZE = 256;
+
+static const char LEVEL_NAMES[] = {'D', 'I', 'W', 'E'};
+
+Logger::Ring Logger::rings_[Logger::MAX_TASKS];
+std::atomic<uint32_t> Logger::unowned_dropped_;
+
+Logger::Logger(const uint8_t task_core) : Task("Logger", task_core) {}
+
+Logger::~Logger() {}
+
+void Logger::run() {
+    HeapMonitor::seal();
+    while (1) {
+        drain();
+        delay(LOG_DRAIN_MILLIS);
+    }
+}
+
+void Logger::write(LogLevel level, const char* format, const uintptr_t* args, uint8_t arg_count) {
+    Ring* ring = xPortInIsrContext() ? nullptr : getRing();
+    if (ring == nullptr) {
+        unowned_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= RING_SIZE) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    LogEntry& entry = ring->entries[head % RING_SIZE];
+    entry.format = format;
+    entry.millis = millis();
+    entry.level = level;
+    entry.arg_count = arg_count;
+    memcpy(entry.args, args, arg_count * sizeof(uintptr_t));
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+Logger::Ring* Logger::getRing() {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (uint8_t i = 0; i < MAX_TASKS; i++) {
+        if (rings_[i].owner.load(std::memory_order_relaxed) == task) {
+            return &rings_[i];
+        }
+    }
+    // First message from this task: claim a free ring
+    for (uint8_t i = 0; i < MAX_TASKS; i++) {
+        TaskHandle_t expected = nullptr;
+        if (rings_[i].owner.compare_exchange_strong(expected, task)) {
+            return &rings_[i];
+        }
+    }
+    return nullptr;
+}
+
+void Logger::drain() {
+    char line[LOG_LINE_SIZE];
+
+    uint32_t dropped = unowned_dropped_.exchange(0, std::memory_order_relaxed);
+    for (uint8_t i = 0; i < MAX_TASKS; i++) {
+        dropped += rings_[i].dropped.exchange(0, std::memory_order_relaxed);
+    }
+    if (dropped > 0) {
+        uart_serial.printf("(%u log messages dropped)\n", dropped);
+    }
+
+    // Merge the rings in timestamp order
+    while (1) {
+        Ring* oldest = nullptr;
+        for (uint8_t i = 0; i < MAX_TASKS; i++) {
+            Ring& ring = rings_[i];
+            uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+            if (ring.head.load(std::memory_order_acquire) == tail) {
+                continue;
+            }
+            if (oldest == nullptr || (int32_t)(ring.entries[tail % RING_SIZE].millis
+                    - oldest->entries[oldest->tail.load(std::memory_order_relaxed) % RING_SIZE].millis) < 0) {
+                oldest = &ring;
+            }
+        }
+        if (oldest == nullptr) {
+            break;
+        }
+
+        uint32_t tail = oldest->tail.load(std::memory_order_relaxed);
+        LogEntry entry = oldest->entries[tail % RING_SIZE];
+        // The slot can be reused as soon as it's been copied
+        oldest->tail.store(tail + 1, std::memory_order_release);
+
+        size_t length = snprintf(line, sizeof(line), "[%u.%03u] %c ", entry.millis / 1000, entry.millis % 1000,
+            LEVEL_NAMES[(uint8_t)entry.level]);
+        length += format(entry, line + length, sizeof(line) - length - 1);
+        line[length++] = '\n';
+        uart_serial.write((const uint8_t*)line, length);
+    }
+}
+
+size_t Logger::format(const LogEntry& entry, char* out, size_t out_size) {
+    size_t length = 0;
+    uint8_t arg = 0;
+    const char* p = entry.format;
+    while (*p != '\0' && length < out_size - 1) {
+        if (*p != '%') {
+            out[length++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[length++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // Keep flags, width and precision; drop length modifiers, since arguments were widened when logged
+        char spec[16];
+        size_t spec_length = 0;
+        spec[spec_length++] = *p++;
+        while (*p != '\0' && strchr("-+ #0123456789.", *p) != nullptr && spec_length < sizeof(spec) - 2) {
+            spec[spec_length++] = *p++;
+        }
+        while (*p != '\0' && strchr("hlzjt", *p) != nullptr) {
+            p++;
+        }
+        char conversion = *p;
+        if (conversion == '\0') {
+            break;
+        }
+        p++;
+        spec[spec_length++] = conversion;
+        spec[spec_length] = '\0';
+
+        uintptr_t value = arg < entry.arg_count ? entry.args[arg++] : 0;
+        int written = 0;
+        switch (conversion) {
+            case 'd':
+            case 'i':
+                written = snprintf(out + length, out_size - length, spec, (int)value);
+                break;
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+            case 'c':
+                written = snprintf(out + length, out_size - length, spec, (unsigned int)value);
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G': {
+                float f;
+                uint32_t bits = value;
+                memcpy(&f, &bits, sizeof(f));
+                written = snprintf(out + length, out_size - length, spec, (double)f);
+                break;
+            }
+            case 's':
+                written = snprintf(out + length, out_size - length, spec, value == 0 ? "(null)" : (const char*)value);
+                break;
+            case 'p':
+                written = snprintf(out + length, out_size - length, spec, (void*)value);
+                break;
+            default:
+                break;
+        }
+        if (written > 0) {
+            length += min((size_t)written, out_size - 1 - length);
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
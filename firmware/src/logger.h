@@ -1,7 +1,109 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+
+#include "task.h"
+#include "task_config.h"
+
+#define SK_LOG_LEVEL_DEBUG 0
+#define SK_LOG_LEVEL_INFO 1
+#define SK_LOG_LEVEL_WARNING 2
+#define SK_LOG_LEVEL_ERROR 3
+#define SK_LOG_LEVEL_NONE 4
+
+// Messages below this level compile to nothing
+#ifndef SK_LOG_LEVEL
+#define SK_LOG_LEVEL SK_LOG_LEVEL_INFO
+#endif
+
+// printf-style format and arguments, without a trailing newline. Formatting is deferred to the logger task, so %s
+// arguments must point to memory that stays valid and unchanged (string literals, or buffers written once and kept
+// for the life of the program). Never pass a member or buffer that gets reused, such as a config's descriptor.
+#define LOG_DEBUG(...) do { if (SK_LOG_LEVEL <= SK_LOG_LEVEL_DEBUG) Logger::log(LogLevel::DEBUG, __VA_ARGS__); } while (0)
+#define LOG_INFO(...) do { if (SK_LOG_LEVEL <= SK_LOG_LEVEL_INFO) Logger::log(LogLevel::INFO, __VA_ARGS__); } while (0)
+#define LOG_WARNING(...) do { if (SK_LOG_LEVEL <= SK_LOG_LEVEL_WARNING) Logger::log(LogLevel::WARNING, __VA_ARGS__); } while (0)
+#define LOG_ERROR(...) do { if (SK_LOG_LEVEL <= SK_LOG_LEVEL_ERROR) Logger::log(LogLevel::ERROR, __VA_ARGS__); } while (0)
+
+enum class LogLevel : uint8_t {
+    DEBUG = SK_LOG_LEVEL_DEBUG,
+    INFO = SK_LOG_LEVEL_INFO,
+    WARNING = SK_LOG_LEVEL_WARNING,
+    ERROR = SK_LOG_LEVEL_ERROR,
+};
+
+static const uint8_t LOG_MAX_ARGS = 8;
+
+struct LogEntry {
+    // Points at the format string literal, so nothing is copied or formatted when logging
+    const char* format;
+    uint32_t millis;
+    LogLevel level;
+    uint8_t arg_count;
+    // Raw argument bits; the format's conversions say how to read them back (floats are stored as float bits)
+    uintptr_t args[LOG_MAX_ARGS];
+};
+
+namespace log_args {
+    inline uintptr_t pack(int value) { return (uintptr_t)value; }
+    inline uintptr_t pack(unsigned int value) { return value; }
+    inline uintptr_t pack(long value) { return (uintptr_t)value; }
+    inline uintptr_t pack(unsigned long value) { return value; }
+    inline uintptr_t pack(const char* value) { return (uintptr_t)value; }
+    inline uintptr_t pack(const void* value) { return (uintptr_t)value; }
+    inline uintptr_t pack(double value) {
+        float f = value;
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+}
+
+static const uint32_t LOGGER_TASK_STACK_SIZE = 3072;
+
+// Asynchronous logger. Each task logging gets its own single-producer ring of entries, so log() is lock-free, never
+// blocks and costs a bounded number of cycles (a short scan for the task's ring and copying the arguments). The
+// Logger task drains the rings at low priority, formats the entries in timestamp order and writes them to the serial
+// port. Entries are dropped (and counted) when a ring is full, or when logging from an ISR.
+class Logger : public Task<Logger, LOGGER_TASK_STACK_SIZE, LOGGER_TASK_PRIORITY> {
+    template<class, uint32_t, UBaseType_t> friend class Task; // Allow base Task to invoke protected run()
 
-class Logger {
     public:
-        Logger() {};
-        virtual ~Logger() {};
-    
+        static const uint8_t MAX_TASKS = 8;
+        static const uint8_t RING_SIZE = 16;
+
+        Logger(const uint8_t task_core);
+        ~Logger();
+
+        template<typename... Args>
+        static void log(LogLevel level, const char* format, Args... args) {
+            static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+            // One extra element so there's no zero-length array
+            uintptr_t packed[sizeof...(Args) + 1] = {log_args::pack(args)...};
+            write(level, format, packed, sizeof...(Args));
+        }
+
+    protected:
+        void run();
+
+    private:
+        struct Ring {
+            std::atomic<TaskHandle_t> owner;
+            // head is only written by the owner, tail only by the logger task
+            std::atomic<uint32_t> head;
+            std::atomic<uint32_t> tail;
+            std::atomic<uint32_t> dropped;
+            LogEntry entries[RING_SIZE];
+        };
+
+        static Ring rings_[MAX_TASKS];
+        static std::atomic<uint32_t> unowned_dropped_;
+
+        static void write(LogLevel level, const char* format, const uintptr_t* args, uint8_t arg_count);
+        static Ring* getRing();
+
+        void drain();
+        // Returns the length written to out (truncated to out_size - 1)
+        static size_t format(const LogEntry& entry, char* out, size_t out_size);
 };
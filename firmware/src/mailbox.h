@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Lock-free channels for handing data from exactly one producer task to exactly one consumer task. Neither side ever
+// blocks or enters a critical section, and checking an empty channel is just an atomic load or two, so the consumer can
+// poll them from a real-time loop.
+
+// Latest-value-wins mailbox (a triple buffer): post() replaces any value the consumer hasn't taken yet, so a slow
+// consumer only ever sees the newest value and the producer never waits for it.
+template<typename T>
+class Mailbox {
+    public:
+        Mailbox() : middle_(1), back_(0), front_(2) {}
+
+        // Producer only
+        void post(const T& value) {
+            slots_[back_] = value;
+            back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+
+        // Consumer only. Returns false if nothing new was posted since the last take().
+        bool take(T& value) {
+            if ((middle_.load(std::memory_order_relaxed) & FRESH) == 0) {
+                return false;
+            }
+            front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+            value = slots_[front_];
+            return true;
+        }
+
+    private:
+        static const uint32_t INDEX_MASK = 0x3;
+        static const uint32_t FRESH = 0x4;
+
+        T slots_[3];
+        // Index of the slot between the producer and the consumer, plus FRESH if it holds a value not yet taken
+        std::atomic<uint32_t> middle_;
+        // Slot only the producer touches
+        uint32_t back_;
+        // Slot only the consumer touches
+        uint32_t front_;
+};
+
+// Bounded FIFO. push() fails instead of waiting when the ring is full.
+template<typename T, uint32_t SIZE>
+class SpscRing {
+    public:
+        SpscRing() : head_(0), tail_(0) {}
+
+        // Producer only
+        bool push(const T& value) {
+            uint32_t head = head_.load(std::memory_order_relaxed);
+            if (head - tail_.load(std::memory_order_acquire) >= SIZE) {
+                return false;
+            }
+            entries_[head % SIZE] = value;
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only
+        bool pop(T& value) {
+            uint32_t tail = tail_.load(std::memory_order_relaxed);
+            if (head_.load(std::memory_order_acquire) == tail) {
+                return false;
+            }
+            value = entries_[tail % SIZE];
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        T entries_[SIZE];
+        // head is only written by the producer, tail only by the consumer
+        std::atomic<uint32_t> head_;
+        std::atomic<uint32_t> tail_;
+};
@@ -2,24 +2,61 @@
 #include <SimpleFOC.h>
 
 #include "display_task.h"
+#include "flight_recorder.h"
+#include "i2c_bus.h"
 #include "interface_task.h"
+#include "led_task.h"
+#include "load_task.h"
+#include "logger.h"
 #include "motor_task.h"
+#include "task_config.h"
+#include "uart_serial.h"
 
 #if (defined(SK_DISPLAY) && (SK_DISPLAY >0))
-static DisplayTask display_task = DisplayTask(0);
+static DisplayTask display_task = DisplayTask(DISPLAY_TASK_CORE);
 static DisplayTask* display_task_p = &display_task;
 #else
 static DisplayTask* display_task_p = nullptr;
 #endif
-static MotorTask motor_task = MotorTask(1);
+#if (defined(SK_LEDS) && (SK_LEDS >0))
+static LedTask led_task = LedTask(LED_TASK_CORE);
+static LedTask* led_task_p = &led_task;
+#else
+static LedTask* led_task_p = nullptr;
+#endif
+
+// Drains log messages from all tasks to serial
+static Logger logger = Logger(LOGGER_TASK_CORE);
+
+// Shared by the I2C sensors on both cores; see I2CBus
+static I2CBus i2c_bus = I2CBus(Wire);
 
+// Constructed in place: the supervisor's atomics make it non-copyable
+static MotorTask motor_task(MOTOR_TASK_CORE, i2c_bus);
 
-InterfaceTask interface_task = InterfaceTask(0, motor_task, display_task_p);
+
+InterfaceTask interface_task = InterfaceTask(INTERFACE_TASK_CORE, motor_task, display_task_p, led_task_p, i2c_bus);
+
+#if (defined(SK_JITTER_LOAD) && (SK_JITTER_LOAD >0))
+// Stand-ins for a display rendering flat out (15 ms of CPU per 20 ms frame) and a chatty serial link (48 bytes every
+// 5 ms, over 80% of what the UART can send at 115200 baud), at the priorities of the real tasks but on the motor's
+// core, so they compete with the motor loop for the CPU
+static LoadTask<DISPLAY_TASK_PRIORITY> display_load = LoadTask<DISPLAY_TASK_PRIORITY>("DisplayLoad", MOTOR_TASK_CORE, 20, 15000, 0);
+static LoadTask<INTERFACE_TASK_PRIORITY> serial_load = LoadTask<INTERFACE_TASK_PRIORITY>("SerialLoad", MOTOR_TASK_CORE, 5, 200, 48);
+#endif
 
 static QueueHandle_t knob_state_debug_queue;
 
 void setup() {
-  Serial.begin(115200);
+  uart_serial.begin(115200);
+  logger.begin();
+  // Before the motor task starts recording over a capture kept from before the reset
+  FlightRecorder::begin();
+
+  // Bring up the bus before any task that uses it
+  #if PIN_SDA >= 0 && PIN_SCL >= 0
+  i2c_bus.begin(PIN_SDA, PIN_SCL, 400000);
+  #endif
 
   motor_task.begin();
   interface_task.begin();
@@ -31,12 +68,27 @@ void setup() {
   motor_task.addListener(display_task.getKnobStateQueue());
   #endif
 
+  #if (defined(SK_LEDS) && (SK_LEDS >0))
+  led_task.begin();
+
+  // Connect LEDs to motor_task's knob state feed
+  motor_task.addListener(led_task.getKnobStateQueue());
+  #endif
+
+  // Stream knob state to the host on request
+  motor_task.addListener(interface_task.getKnobStateQueue());
+
   // Create a queue and register it with motor_task to print knob state to serial (see loop() below)
   knob_state_debug_queue = xQueueCreate(1, sizeof(KnobState));
   assert(knob_state_debug_queue != NULL);
 
   motor_task.addListener(knob_state_debug_queue);
 
+  #if (defined(SK_JITTER_LOAD) && (SK_JITTER_LOAD >0))
+  display_load.begin();
+  serial_load.begin();
+  #endif
+
   // Free up the loop task
   vTaskDelete(NULL);
 }
@@ -48,19 +100,7 @@ uint32_t last_debug;
 void loop() {
   // Print any new state, at most 5 times per second
   if (millis() - last_debug > 200 && xQueueReceive(knob_state_debug_queue, &state, portMAX_DELAY) == pdTRUE) {
-    Serial.println(state.current_position);
+    LOG_DEBUG("%d", state.current_position);
     last_debug = millis();
   }
-
-  static uint32_t last_stack_debug;
-  if (millis() - last_stack_debug > 1000) {
-    Serial.println("Stack high water:");
-    Serial.printf("main: %d\n", uxTaskGetStackHighWaterMark(NULL));
-    #if (defined(SK_DISPLAY) && (SK_DISPLAY >0))
-      Serial.printf("display: %d\n", uxTaskGetStackHighWaterMark(display_task.getHandle()));
-    #endif
-    Serial.printf("motor: %d\n", uxTaskGetStackHighWaterMark(motor_task.getHandle()));
-    Serial.printf("interface: %d\n", uxTaskGetStackHighWaterMark(interface_task.getHandle()));
-    last_stack_debug = millis();
-  }
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "logger.h"
+#include "motor_supervisor.h"
+
+const char* motorFaultName(MotorFault fault) {
+    switch (fault) {
+        case MotorFault::NONE: return "none";
+        case MotorFault::LOOP_DEADLINE: return "loop deadline missed";
+        case MotorFault::LOOP_STALLED: return "loop stalled";
+        case MotorFault::SENSOR_STALE: return "sensor stale";
+        case MotorFault::OVER_VELOCITY: return "over velocity";
+    }
+    return "unknown";
+}
+
+MotorSupervisor::MotorSupervisor(SafeStateFunction safe_state, void* arg) :
+        safe_state_(safe_state), safe_state_arg_(arg), fault_(MotorFault::NONE), armed_(false), last_beat_micros_(0),
+        suspensions_(0), grace_checks_(0) {}
+
+void MotorSupervisor::arm(uint32_t now_micros) {
+    last_check_micros_ = now_micros;
+    heartbeat(now_micros);
+    armed_.store(true);
+}
+
+void MotorSupervisor::checkHeartbeat(uint32_t now_micros) {
+    if (!armed_.load() || fault_.load(std::memory_order_relaxed) != MotorFault::NONE || isExcused(false)) {
+        return;
+    }
+    // Signed, since the motor loop may check in between this task reading the clock and the heartbeat
+    int32_t age_micros = now_micros - last_beat_micros_.load(std::memory_order_relaxed);
+    if (age_micros > (int32_t)MAX_LOOP_INTERVAL_MICROS) {
+        trip(MotorFault::LOOP_STALLED, age_micros);
+    }
+}
+
+void MotorSupervisor::suspend() {
+    suspensions_.fetch_add(1);
+}
+
+void MotorSupervisor::resume(uint32_t now_micros) {
+    // Grace before dropping the suspension, so the loop is never left unexcused in between
+    heartbeat(now_micros);
+    grace_checks_.store(2);
+    suspensions_.fetch_sub(1);
+}
+
+void MotorSupervisor::trip(MotorFault fault, float value) {
+    // The motor loop and the heartbeat check can race to trip; only the first reason is kept
+    MotorFault expected = MotorFault::NONE;
+    if (!fault_.compare_exchange_strong(expected, fault)) {
+        return;
+    }
+    safe_state_(safe_state_arg_);
+    LOG_ERROR("Motor fault: %s (%.1f), output disabled until reboot", motorFaultName(fault), value);
+}
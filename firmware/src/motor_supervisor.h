@@ -0,0 +1,146 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+enum class MotorFault : uint8_t {
+    NONE = 0,
+    // An iteration of the motor loop started too long after the previous one, i.e. the loop stalled while the last
+    // torque it commanded was still being applied
+    LOOP_DEADLINE,
+    // The motor loop stopped checking in altogether (noticed from another task)
+    LOOP_STALLED,
+    // No valid reading from the angle sensor for too long; torque would be commutated blind
+    SENSOR_STALE,
+    // Spinning above the velocity limit for too long, e.g. a runaway from a wrong sensor direction or offset
+    OVER_VELOCITY,
+};
+
+const char* motorFaultName(MotorFault fault);
+
+// Above this speed the motor loop applies no torque, and staying above it for long trips OVER_VELOCITY
+static const float MAX_VELOCITY_RAD_PER_SEC = 60;
+static const float MAX_OVER_VELOCITY_SECONDS = 1;
+// Ten loop periods: far beyond normal jitter (haptic pulses, which take a few periods, heartbeat as they go)
+static const uint32_t MAX_LOOP_INTERVAL_MICROS = 10000;
+// The sensors are read every iteration, so this allows for a few missed (or bad) readings in a row
+static const uint32_t MAX_SENSOR_AGE_MICROS = 5000;
+// Voltage that can be applied indefinitely, and the heat budget above it: 10 seconds at the full 5V
+static const float FULL_VOLTAGE = 5;
+static const float CONTINUOUS_VOLTAGE = 2.5;
+static const float MAX_HEAT = (FULL_VOLTAGE * FULL_VOLTAGE - CONTINUOUS_VOLTAGE * CONTINUOUS_VOLTAGE) * 10;
+// Past this much heat (8 seconds at 5V) the voltage is scaled down, reaching the continuous rating at MAX_HEAT
+static const float DERATE_HEAT = MAX_HEAT * 0.8f;
+
+// Safety checks on the motor loop. The loop calls check() once per iteration with what it's about to command; the
+// checks there are a few compares and multiplies, so they cost next to nothing next to the FOC update. A stalled
+// loop can't notice its own stall, so a timer also calls checkHeartbeat() periodically.
+//
+// Some stalls are expected: erasing or writing flash stops both cores for up to tens of milliseconds. Whoever does
+// that brackets it with suspend() and resume(), which excuse the loop's timing (but not its velocity or torque) until
+// it has run normally again.
+//
+// The first violation latches a fault until reboot: the reason is logged, the safe state function (which should cut
+// the driver's output) is called from whichever task noticed, and check() returns false from then on so the loop
+// commands zero torque. The knob keeps working as an input, just without haptics.
+//
+// Heat isn't a fault, since leaning on an endstop for a while is ordinary use. Once the heat budget is mostly spent,
+// check() scales the voltage down instead, to no more than the continuous rating when it's all spent, so the haptics
+// get weaker until the motor has cooled off.
+class MotorSupervisor {
+    public:
+        typedef void (*SafeStateFunction)(void* arg);
+
+        MotorSupervisor(SafeStateFunction safe_state, void* arg);
+
+        // Starts supervising, once the motor loop is about to start
+        void arm(uint32_t now_micros);
+
+        // From the motor loop, once per iteration, before applying the voltage. sensor_micros is when the angle
+        // sensor last produced a valid reading. Scales voltage down to what the heat budget allows, and returns
+        // whether it may be applied.
+        bool check(uint32_t now_micros, uint32_t sensor_micros, float velocity, float& voltage) {
+            uint32_t interval_micros = now_micros - last_check_micros_;
+            last_check_micros_ = now_micros;
+            heartbeat(now_micros);
+            if (fault_.load(std::memory_order_relaxed) != MotorFault::NONE) {
+                return false;
+            }
+
+            // The interval (and how old the sensor reading is) may include an excused stall
+            bool excused = isExcused(true);
+            if (excused) {
+                interval_micros = 0;
+            }
+
+            float dt = interval_micros * 1e-6f;
+            over_velocity_seconds_ = fabsf(velocity) > MAX_VELOCITY_RAD_PER_SEC
+                ? over_velocity_seconds_ + dt
+                : fmaxf(0, over_velocity_seconds_ - dt);
+            float derating = fminf(1, fmaxf(0, (heat_ - DERATE_HEAT) / (MAX_HEAT - DERATE_HEAT)));
+            float voltage_limit = FULL_VOLTAGE - (FULL_VOLTAGE - CONTINUOUS_VOLTAGE) * derating;
+            voltage = fmaxf(-voltage_limit, fminf(voltage, voltage_limit));
+            heat_ = fmaxf(0, heat_ + (voltage * voltage - CONTINUOUS_VOLTAGE * CONTINUOUS_VOLTAGE) * dt);
+
+            if (interval_micros > MAX_LOOP_INTERVAL_MICROS) {
+                trip(MotorFault::LOOP_DEADLINE, interval_micros);
+            } else if (!excused && (int32_t)(now_micros - sensor_micros) > (int32_t)MAX_SENSOR_AGE_MICROS) {
+                trip(MotorFault::SENSOR_STALE, now_micros - sensor_micros);
+            } else if (over_velocity_seconds_ > MAX_OVER_VELOCITY_SECONDS) {
+                trip(MotorFault::OVER_VELOCITY, fabsf(velocity));
+            } else {
+                return true;
+            }
+            return false;
+        }
+
+        // For parts of the motor loop that run the FOC update themselves for a while (e.g. haptic pulses)
+        void heartbeat(uint32_t now_micros) {
+            last_beat_micros_.store(now_micros, std::memory_order_relaxed);
+        }
+
+        // From outside the motor loop, every few milliseconds: trips if the motor loop hasn't checked in recently
+        void checkHeartbeat(uint32_t now_micros);
+
+        // From any task, around something that stalls the motor loop (see above). Suspensions may nest.
+        void suspend();
+        void resume(uint32_t now_micros);
+
+        MotorFault getFault() const { return fault_.load(std::memory_order_relaxed); }
+
+    private:
+        const SafeStateFunction safe_state_;
+        void* const safe_state_arg_;
+
+        std::atomic<MotorFault> fault_;
+        std::atomic<bool> armed_;
+        std::atomic<uint32_t> last_beat_micros_;
+        std::atomic<uint8_t> suspensions_;
+        // Loop checks still excused after the last resume(): the first may have read the clock before the stall
+        // ended, which leaves the second measuring its interval from before the stall
+        std::atomic<uint8_t> grace_checks_;
+
+        // Only touched by the motor loop
+        uint32_t last_check_micros_ = 0;
+        float over_velocity_seconds_ = 0;
+        // Integral of the commanded voltage squared (proportional to I^2 R heating) above the continuous rating
+        float heat_ = 0;
+
+        // from_loop consumes one of the grace checks
+        bool isExcused(bool from_loop) {
+            if (suspensions_.load(std::memory_order_relaxed) > 0) {
+                return true;
+            }
+            uint8_t grace = grace_checks_.load(std::memory_order_relaxed);
+            if (grace == 0) {
+                return false;
+            }
+            // If resume() raced this, the grace it set is kept
+            if (from_loop) {
+                grace_checks_.compare_exchange_strong(grace, grace - 1, std::memory_order_relaxed);
+            }
+            return true;
+        }
+
+        void trip(MotorFault fault, float value);
+};
@@ -1,27 +1,31 @@
 #include <SimpleFOC.h>
+#include <esp_timer.h>
 #include <sensors/MagneticSensorI2C.h>
 
+#include "detent_math.h"
+#include "flight_recorder.h"
+#include "heap_monitor.h"
+#include "latency_trace.h"
+#include "logger.h"
 #include "motor_task.h"
 #if (defined(SENSOR_MT6701) && (SENSOR_MT6701 >0))
 #include "mt6701_sensor.h"
 #endif
+#include "profiler.h"
 #include "tlv_sensor.h"
+#include "uart_serial.h"
 #include "util.h"
 
-static const float DEAD_ZONE_DETENT_PERCENT = 0.2;
-static const float DEAD_ZONE_RAD = 1 * _PI / 180;
-
 static const float IDLE_VELOCITY_EWMA_ALPHA = 0.001;
 static const float IDLE_VELOCITY_RAD_PER_SEC = 0.05;
 static const uint32_t IDLE_CORRECTION_DELAY_MILLIS = 500;
-static const float IDLE_CORRECTION_MAX_ANGLE_RAD = 5 * PI / 180;
-static const float IDLE_CORRECTION_RATE_ALPHA = 0.0005;
+// Half the motor loop's deadline, so a stall is caught within 1.5 deadlines (see MotorSupervisor)
+static const uint64_t MOTOR_WATCHDOG_MICROS = 5000;
 
+static void enterSafeState(void* arg);
 
-MotorTask::MotorTask(const uint8_t task_core) : Task("Motor", 2048, 1, task_core) {
-    queue_ = xQueueCreate(5, sizeof(Command));
-    assert(queue_ != NULL);
-}
+
+MotorTask::MotorTask(const uint8_t task_core, I2CBus& i2c_bus) : Task("Motor", task_core), i2c_bus_(i2c_bus), supervisor_(enterSafeState, nullptr), listener_count_(0) {}
 
 MotorTask::~MotorTask() {}
 
@@ -41,8 +45,36 @@ BLDCDriver6PWM driver = BLDCDriver6PWM(PIN_UH, PIN_UL, PIN_VH, PIN_VL, PIN_WH, P
 #endif
 
 
-Commander command = Commander(Serial);
+Commander command = Commander(uart_serial);
 
+// Called by the supervisor on a fault, possibly from another task while the motor loop is stalled mid-iteration, so
+// this only cuts the driver's output; the loop itself commands zero torque from then on
+static void enterSafeState(void* arg) {
+    driver.disable();
+    FlightRecorder::freeze(FlightFreezeReason::MOTOR_FAULT);
+}
+
+// When the sensor last gave a reading it trusted, for the supervisor's staleness check and the latency traces. The
+// MT6701 and TLV drivers skip bad readings and keep track of this; SimpleFOC's PWM driver for the AS5048A has no
+// check, so there it's the update loopFOC() just did.
+static uint32_t lastValidSensorMicros() {
+    #if (defined(SENSOR_AS5048A) && (SENSOR_AS5048A > 0))
+        return micros();
+    #else
+        return encoder.getLastValidMicros();
+    #endif
+}
+
+// The shaft angle (as of the sensor's last update), negated if the knob's rotation is inverted. Built from the sensor's
+// turns and angle within the turn rather than motor.shaft_angle, whose float loses precision as the turns add up.
+static KnobAngle knobAngle() {
+    KnobAngle angle = makeKnobAngle(encoder.getFullRotations(), encoder.getMechanicalAngle());
+    bool negate = motor.sensor_direction == Direction::CCW;
+    #if SK_INVERT_ROTATION
+        negate = !negate;
+    #endif
+    return negate ? negateKnobAngle(angle) : angle;
+}
 
 void doMotor(char* cmd) { command.motor(&motor, cmd); }
 
@@ -68,7 +100,7 @@ void MotorTask::run() {
     driver.init();
 
    #if (defined(SENSOR_TLV) && (SENSOR_TLV > 0))
-    encoder.init(Wire, false);
+    encoder.init(&i2c_bus_, false);
     #endif
 
     #if (defined(SENSOR_MT6701) && (SENSOR_MT6701 > 0))
@@ -93,7 +125,7 @@ void MotorTask::run() {
     motor.PID_velocity.limit = 10;
 
 
-    // motor.useMonitoring(Serial);
+    // motor.useMonitoring(uart_serial);
 
     motor.init();
 
@@ -104,10 +136,10 @@ void MotorTask::run() {
 
     bool calibrate = false;
 
-    Serial.println("Press Y to run calibration");
+    uart_serial.println("Press Y to run calibration");
     uint32_t t = millis();
     while (millis() - t < 3000) {
-        if (Serial.read() == 'Y') {
+        if (uart_serial.read() == 'Y') {
             calibrate = true;
             break;
         }
@@ -143,42 +175,42 @@ void MotorTask::run() {
 
         motor.voltage_limit = 0;
         motor.move(a);
-         Serial.println("Did motor turn counterclockwise? Press Y to continue, otherwise change motor wiring and restart");
-         while (Serial.read() != 'Y') {
+         uart_serial.println("Did motor turn counterclockwise? Press Y to continue, otherwise change motor wiring and restart");
+         while (uart_serial.read() != 'Y') {
              delay(10);
          }
 
-        Serial.println();
+        uart_serial.println();
 
         // TODO: check for no motor movement!
 
-        Serial.print("Sensor measures positive for positive motor rotation: ");
+        uart_serial.print("Sensor measures positive for positive motor rotation: ");
         if (end_sensor > start_sensor) {
-            Serial.println("YES, Direction=CW");
+            uart_serial.println("YES, Direction=CW");
             motor.initFOC(0, Direction::CW);
         } else {
-            Serial.println("NO, Direction=CCW");
+            uart_serial.println("NO, Direction=CCW");
             motor.initFOC(0, Direction::CCW);
         }
 
         // Rotate many electrical revolutions and measure mechanical angle traveled, to calculate pole-pairs
         uint8_t electrical_revolutions = 20;
-        Serial.printf("Going to measure %d electrical revolutions...\n", electrical_revolutions);
+        uart_serial.printf("Going to measure %d electrical revolutions...\n", electrical_revolutions);
         motor.voltage_limit = 5;
         motor.move(a);
-        Serial.println("Going to electrical zero...");
+        uart_serial.println("Going to electrical zero...");
         float destination = a + _2PI;
         for (; a < destination; a += 0.03) {
             encoder.update();
             motor.move(a);
             delay(1);
         }
-        Serial.println("pause...");
+        uart_serial.println("pause...");
         for (uint16_t i = 0; i < 1000; i++) {
             encoder.update();
             delay(1);
         }
-        Serial.println("Measuring...");
+        uart_serial.println("Measuring...");
 
         start_sensor = motor.sensor_direction * encoder.getAngle();
         destination = a + electrical_revolutions * _2PI;
@@ -197,16 +229,16 @@ void MotorTask::run() {
         motor.move(a);
 
         if (fabsf(motor.shaft_angle - motor.target) > 1 * PI / 180) {
-            Serial.println("ERROR: motor did not reach target!");
+            uart_serial.println("ERROR: motor did not reach target!");
             while(1) {}
         }
 
         float electrical_per_mechanical = electrical_revolutions * _2PI / (end_sensor - start_sensor);
-        Serial.print("Electrical angle / mechanical angle (i.e. pole pairs) = ");
-        Serial.println(electrical_per_mechanical);
+        uart_serial.print("Electrical angle / mechanical angle (i.e. pole pairs) = ");
+        uart_serial.println(electrical_per_mechanical);
 
         int measured_pole_pairs = (int)round(electrical_per_mechanical);
-        Serial.printf("Pole pairs set to %d\n", measured_pole_pairs);
+        uart_serial.printf("Pole pairs set to %d\n", measured_pole_pairs);
 
         delay(1000);
 
@@ -233,11 +265,11 @@ void MotorTask::run() {
             offset_x += cosf(offset_angle);
             offset_y += sinf(offset_angle);
 
-            Serial.print(degrees(real_electrical_angle));
-            Serial.print(", ");
-            Serial.print(degrees(measured_electrical_angle));
-            Serial.print(", ");
-            Serial.println(degrees(_normalizeAngle(offset_angle)));
+            uart_serial.print(degrees(real_electrical_angle));
+            uart_serial.print(", ");
+            uart_serial.print(degrees(measured_electrical_angle));
+            uart_serial.print(", ");
+            uart_serial.println(degrees(_normalizeAngle(offset_angle)));
         }
         for (; a > destination2; a -= 0.4) {
             motor.move(a);
@@ -253,11 +285,11 @@ void MotorTask::run() {
             offset_x += cosf(offset_angle);
             offset_y += sinf(offset_angle);
 
-            Serial.print(degrees(real_electrical_angle));
-            Serial.print(", ");
-            Serial.print(degrees(measured_electrical_angle));
-            Serial.print(", ");
-            Serial.println(degrees(_normalizeAngle(offset_angle)));
+            uart_serial.print(degrees(real_electrical_angle));
+            uart_serial.print(", ");
+            uart_serial.print(degrees(measured_electrical_angle));
+            uart_serial.print(", ");
+            uart_serial.println(degrees(_normalizeAngle(offset_angle)));
         }
         motor.voltage_limit = 0;
         motor.move(a);
@@ -270,19 +302,19 @@ void MotorTask::run() {
         motor.voltage_limit = 5;
         motor.controller = MotionControlType::torque;
 
-        Serial.print("\n\nRESULTS:\n  zero electric angle: ");
-        Serial.println(motor.zero_electric_angle);
-        Serial.print("  direction: ");
+        uart_serial.print("\n\nRESULTS:\n  zero electric angle: ");
+        uart_serial.println(motor.zero_electric_angle);
+        uart_serial.print("  direction: ");
         if (motor.sensor_direction == Direction::CW) {
-            Serial.println("CW");
+            uart_serial.println("CW");
         } else {
-            Serial.println("CCW");
+            uart_serial.println("CCW");
         }
-        Serial.printf("  pole pairs: %d\n", motor.pole_pairs);
+        uart_serial.printf("  pole pairs: %d\n", motor.pole_pairs);
         delay(2000);
     }
 
-    Serial.println(motor.zero_electric_angle);
+    uart_serial.println(motor.zero_electric_angle);
 
     command.add('M', &doMotor, "foo");
     // command.add('D', &doDetents, "Detents");
@@ -290,73 +322,105 @@ void MotorTask::run() {
 
     // disableCore0WDT();
 
-    float current_detent_center = motor.shaft_angle;
     KnobConfig config = {
         .num_positions = 2,
         .position = 0,
         .position_width_radians = 60 * _PI / 180,
         .detent_strength_unit = 0,
     };
+    uint32_t config_id = 0;
+    Detents detents;
+    detents.configure(config, knobAngle());
 
     float idle_check_velocity_ewma = 0;
     uint32_t last_idle_start = 0;
     uint32_t last_debug = 0;
 
     uint32_t last_publish = 0;
+    uint32_t sequence = 0;
+
+    // The heartbeat check runs off a timer, so it's done from the esp_timer task, which keeps running on the other
+    // core when this loop stalls, and doesn't wake any of the application's tasks to do it
+    esp_timer_create_args_t watchdog_args = {};
+    watchdog_args.callback = [](void* arg) { static_cast<MotorSupervisor*>(arg)->checkHeartbeat(micros()); };
+    watchdog_args.arg = &supervisor_;
+    watchdog_args.name = "MotorWatchdog";
+    esp_timer_handle_t watchdog_timer;
+    esp_err_t result = esp_timer_create(&watchdog_args, &watchdog_timer);
+    assert("Failed to create motor watchdog timer" && result == ESP_OK);
+
+    TickType_t last_wake = xTaskGetTickCount();
+    supervisor_.arm(micros());
+    esp_timer_start_periodic(watchdog_timer, MOTOR_WATCHDOG_MICROS);
+    HeapMonitor::seal();
+    #if SK_PROFILE
+    uint32_t last_loop_start = Profiler::cycles();
+    #endif
 
     while (1) {
-        motor.loopFOC();
+        #if SK_PROFILE
+        uint32_t loop_start = Profiler::cycles();
+        Profiler::record(ProfileSection::MOTOR_PERIOD, loop_start - last_loop_start);
+        last_loop_start = loop_start;
+        #endif
 
-        Command command;
-        if (xQueueReceive(queue_, &command, 0) == pdTRUE) {
-            switch (command.command_type) {
-                case CommandType::CONFIG: {
-                    config = command.data.config;
-                    Serial.println("Got new config");
-                    current_detent_center = motor.shaft_angle;
-                    #if SK_INVERT_ROTATION
-                        current_detent_center = -motor.shaft_angle;
-                    #endif
-
-                    // Update derivative factor of torque controller based on detent width.
-                    // If the D factor is large on coarse detents, the motor ends up making noise because the P&D factors amplify the noise from the sensor.
-                    // This is a piecewise linear function so that fine detents (small width) get a higher D factor and coarse detents get a small D factor.
-                    // Fine detents need a nonzero D factor to artificially create "clicks" each time a new value is reached (the P factor is small
-                    // for fine detents due to the smaller angular errors, and the existing P factor doesn't work well for very small angle changes (easy to
-                    // get runaway due to sensor noise & lag)).
-                    // TODO: consider eliminating this D factor entirely and just "play" a hardcoded haptic "click" (e.g. a quick burst of torque in each
-                    // direction) whenever the position changes when the detent width is too small for the P factor to work well.
-                    const float derivative_lower_strength = config.detent_strength_unit * 0.08;
-                    const float derivative_upper_strength = config.detent_strength_unit * 0.02;
-                    const float derivative_position_width_lower = radians(3);
-                    const float derivative_position_width_upper = radians(8);
-                    const float raw = derivative_lower_strength + (derivative_upper_strength - derivative_lower_strength)/(derivative_position_width_upper - derivative_position_width_lower)*(config.position_width_radians - derivative_position_width_lower);
-                    motor.PID_velocity.D = CLAMP(
-                        raw,
-                        min(derivative_lower_strength, derivative_upper_strength),
-                        max(derivative_lower_strength, derivative_upper_strength)
-                    );
-                    break;
+        ProfileScope loop_scope(ProfileSection::MOTOR_LOOP);
+        ProfileScope foc_scope(ProfileSection::LOOP_FOC);
+        motor.loopFOC();
+        foc_scope.stop();
+        sequence++;
+        uint32_t sensor_micros = lastValidSensorMicros();
+
+        // Haptics first, so a press click plays before the config change it triggers
+        HapticData haptic;
+        ConfigUpdate update;
+        if (haptic_ring_.pop(haptic)) {
+            FlightRecorder::event(FlightRecordType::HAPTIC, haptic.press);
+            float strength = haptic.press ? 5 : 1.5;
+            if (supervisor_.getFault() == MotorFault::NONE) {
+                motor.move(strength);
+                for (uint8_t i = 0; i < 3; i++) {
+                    motor.loopFOC();
+                    supervisor_.heartbeat(micros());
+                    delay(1);
                 }
-                case CommandType::HAPTIC: {
-                    float strength = command.data.haptic.press ? 5 : 1.5;
-                    motor.move(strength);
-                    for (uint8_t i = 0; i < 3; i++) {
-                        motor.loopFOC();
-                        delay(1);
-                    }
-                    motor.move(-strength);
-                    for (uint8_t i = 0; i < 3; i++) {
-                        motor.loopFOC();
-                        delay(1);
-                    }
-                    motor.move(0);
+                motor.move(-strength);
+                for (uint8_t i = 0; i < 3; i++) {
                     motor.loopFOC();
-                    break;
+                    supervisor_.heartbeat(micros());
+                    delay(1);
                 }
+                motor.move(0);
+                motor.loopFOC();
             }
+        } else if (config_mailbox_.take(update)) {
+            config = update.config;
+            config_id = update.id;
+            LOG_INFO("Got new config");
+            FlightRecorder::event(FlightRecordType::CONFIG, (uint8_t)CLAMP(config.num_positions, 0, 255));
+            detents.configure(config, knobAngle());
+
+            // Update derivative factor of torque controller based on detent width.
+            // If the D factor is large on coarse detents, the motor ends up making noise because the P&D factors amplify the noise from the sensor.
+            // This is a piecewise linear function so that fine detents (small width) get a higher D factor and coarse detents get a small D factor.
+            // Fine detents need a nonzero D factor to artificially create "clicks" each time a new value is reached (the P factor is small
+            // for fine detents due to the smaller angular errors, and the existing P factor doesn't work well for very small angle changes (easy to
+            // get runaway due to sensor noise & lag)).
+            // TODO: consider eliminating this D factor entirely and just "play" a hardcoded haptic "click" (e.g. a quick burst of torque in each
+            // direction) whenever the position changes when the detent width is too small for the P factor to work well.
+            const float derivative_lower_strength = config.detent_strength_unit * 0.08;
+            const float derivative_upper_strength = config.detent_strength_unit * 0.02;
+            const float derivative_position_width_lower = radians(3);
+            const float derivative_position_width_upper = radians(8);
+            const float raw = derivative_lower_strength + (derivative_upper_strength - derivative_lower_strength)/(derivative_position_width_upper - derivative_position_width_lower)*(config.position_width_radians - derivative_position_width_lower);
+            motor.PID_velocity.D = CLAMP(
+                raw,
+                min(derivative_lower_strength, derivative_upper_strength),
+                max(derivative_lower_strength, derivative_upper_strength)
+            );
         }
 
+        ProfileScope detent_scope(ProfileSection::DETENT);
         idle_check_velocity_ewma = motor.shaft_velocity * IDLE_VELOCITY_EWMA_ALPHA + idle_check_velocity_ewma * (1 - IDLE_VELOCITY_EWMA_ALPHA);
         if (fabsf(idle_check_velocity_ewma) > IDLE_VELOCITY_RAD_PER_SEC) {
             last_idle_start = 0;
@@ -367,99 +431,112 @@ void MotorTask::run() {
         }
 
         // If we are not moving and we're close to the center (but not exactly there), slowly adjust the centerpoint to match the current position
-        if (last_idle_start > 0 && millis() - last_idle_start > IDLE_CORRECTION_DELAY_MILLIS && fabsf(motor.shaft_angle - current_detent_center) < IDLE_CORRECTION_MAX_ANGLE_RAD) {
-            current_detent_center = motor.shaft_angle * IDLE_CORRECTION_RATE_ALPHA + current_detent_center * (1 - IDLE_CORRECTION_RATE_ALPHA);
-            // if (millis() - last_debug > 100) {
-            //     last_debug = millis();
-            //     Serial.print("Moving detent center. ");
-            //     Serial.print(current_detent_center);
-            //     Serial.print(" ");
-            //     Serial.println(motor.shaft_angle);
-            // }
-        }
-
-        float angle_to_detent_center = motor.shaft_angle - current_detent_center;
-        #if SK_INVERT_ROTATION
-            angle_to_detent_center = -motor.shaft_angle - current_detent_center;
-        #endif
-        if (angle_to_detent_center > config.position_width_radians * config.snap_point && (config.num_positions <= 0 || config.position > 0)) {
-            current_detent_center += config.position_width_radians;
-            angle_to_detent_center -= config.position_width_radians;
-            config.position--;
-        } else if (angle_to_detent_center < -config.position_width_radians * config.snap_point && (config.num_positions <= 0 || config.position < config.num_positions - 1)) {
-            current_detent_center -= config.position_width_radians;
-            angle_to_detent_center += config.position_width_radians;
-            config.position++;
+        if (last_idle_start > 0 && millis() - last_idle_start > IDLE_CORRECTION_DELAY_MILLIS) {
+            detents.correctIdle(knobAngle());
         }
 
-        float dead_zone_adjustment = CLAMP(
-            angle_to_detent_center,
-            fmaxf(-config.position_width_radians*DEAD_ZONE_DETENT_PERCENT, -DEAD_ZONE_RAD),
-            fminf(config.position_width_radians*DEAD_ZONE_DETENT_PERCENT, DEAD_ZONE_RAD));
-
-        bool out_of_bounds = config.num_positions > 0 && ((angle_to_detent_center > 0 && config.position == 0) || (angle_to_detent_center < 0 && config.position == config.num_positions - 1));
+        // When the angle the detent error is computed from was sampled (later than sensor_micros after a haptic pulse)
+        uint32_t angle_micros = lastValidSensorMicros();
+        DetentError detent = detents.update(knobAngle(), config);
+        float angle_to_detent_center = detent.angle_to_center;
+        float dead_zone_adjustment = detent.dead_zone_adjustment;
+        bool out_of_bounds = detent.out_of_bounds;
         motor.PID_velocity.limit = 10; //out_of_bounds ? 10 : 3;
         motor.PID_velocity.P = out_of_bounds ? config.endstop_strength_unit * 4 : config.detent_strength_unit * 4;
 
 
 
-        if (fabsf(motor.shaft_velocity) > 60) {
-            // Don't apply torque if velocity is too high (helps avoid positive feedback loop/runaway)
-            motor.move(0);
-        } else {
-            float torque = motor.PID_velocity(-angle_to_detent_center + dead_zone_adjustment);
+        float torque = 0;
+        // Don't apply torque if velocity is too high (helps avoid positive feedback loop/runaway)
+        if (fabsf(motor.shaft_velocity) <= MAX_VELOCITY_RAD_PER_SEC) {
+            torque = motor.PID_velocity(-angle_to_detent_center + dead_zone_adjustment);
             #if SK_INVERT_ROTATION
                 torque = -torque;
             #endif
-            motor.move(torque);
         }
+        // move() would clamp it to the same limit; the supervisor's heat budget should see what's actually applied
+        torque = CLAMP(torque, -motor.voltage_limit, motor.voltage_limit);
+        // May scale the torque down, if the motor has been working hard for a while
+        if (!supervisor_.check(micros(), lastValidSensorMicros(), motor.shaft_velocity, torque)) {
+            torque = 0;
+        }
+        motor.move(torque);
+        LatencyTrace::record(LatencyPath::SENSOR_TO_TORQUE, sensor_micros);
+        FlightRecorder::sample(motor.shaft_angle, motor.shaft_velocity, torque, config.position, (uint8_t)supervisor_.getFault());
+        detent_scope.stop();
 
         if (millis() - last_publish > 10) {
+            ProfileScope publish_scope(ProfileSection::PUBLISH);
+            float sub_position_velocity_unit = -motor.shaft_velocity / config.position_width_radians;
+            #if SK_INVERT_ROTATION
+                sub_position_velocity_unit = -sub_position_velocity_unit;
+            #endif
             publish({
                 .current_position = config.position,
                 .sub_position_unit = -angle_to_detent_center / config.position_width_radians,
                 .config = config,
+                .config_id = config_id,
+                .timestamp_micros = angle_micros,
+                .sub_position_velocity_unit = sub_position_velocity_unit,
+                .sequence = sequence,
+                .sensor_micros = sensor_micros,
             });
+            LatencyTrace::record(LatencyPath::SENSOR_TO_PUBLISH, sensor_micros);
             last_publish = millis();
         }
 
         motor.monitor();
         // command.run();
 
-        delay(1);
+        loop_scope.stop();
+        // Wake on a fixed schedule rather than a fixed delay after this iteration's work, which would drift. After an
+        // overrun (e.g. a haptic pulse), skip the missed slots instead of running them back to back.
+        TickType_t now = xTaskGetTickCount();
+        if (now - last_wake >= MOTOR_LOOP_PERIOD_TICKS) {
+            last_wake = now;
+        }
+        vTaskDelayUntil(&last_wake, MOTOR_LOOP_PERIOD_TICKS);
     }
 }
 
-void MotorTask::setConfig(const KnobConfig& config) {
-    Command command = {
-        .command_type = CommandType::CONFIG,
-        .data = {
-            .config = config,
-        }
-    };
-    xQueueSend(queue_, &command, portMAX_DELAY);
+void MotorTask::setConfig(const KnobConfig& config, uint32_t config_id) {
+    ConfigUpdate update = {config, config_id};
+    config_mailbox_.post(update);
 }
 
 
 void MotorTask::playHaptic(bool press) {
-    Command command = {
-        .command_type = CommandType::HAPTIC,
-        .data = {
-            .haptic = {
-                .press = press,
-            },
-        }
+    HapticData haptic = {
+        .press = press,
     };
-    xQueueSend(queue_, &command, portMAX_DELAY);
+    if (!haptic_ring_.push(haptic)) {
+        LOG_WARNING("Haptic dropped, motor task busy");
+    }
+}
+
+
+void MotorTask::suspendWatchdog() {
+    supervisor_.suspend();
+}
+
+void MotorTask::resumeWatchdog() {
+    supervisor_.resume(micros());
 }
 
+MotorFault MotorTask::getFault() const {
+    return supervisor_.getFault();
+}
 
 void MotorTask::addListener(QueueHandle_t queue) {
-    listeners_.push_back(queue);
+    uint8_t count = listener_count_.load(std::memory_order_relaxed);
+    assert("Too many knob state listeners" && count < MAX_KNOB_STATE_LISTENERS);
+    listeners_[count] = queue;
+    listener_count_.store(count + 1, std::memory_order_release);
 }
 
 void MotorTask::publish(const KnobState& state) {
-    for (auto listener : listeners_) {
-        xQueueOverwrite(listener, &state);
+    uint8_t count = listener_count_.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < count; i++) {
+        xQueueOverwrite(listeners_[i], &state);
     }
 }
@@ -1,49 +1,61 @@
 #pragma once
 
 #include <Arduino.h>
-#include <vector>
+#include <atomic>
 
+#include "i2c_bus.h"
 #include "knob_data.h"
+#include "mailbox.h"
+#include "motor_supervisor.h"
 #include "task.h"
+#include "task_config.h"
 
 
-enum class CommandType {
-    CONFIG,
-    HAPTIC,
-};
-
 struct HapticData {
     bool press;
 };
 
-struct Command {
-    CommandType command_type;
-    union CommandData {
-        KnobConfig config;
-        HapticData haptic;
-    };
-    CommandData data;
-};
+static const uint32_t MOTOR_TASK_STACK_SIZE = 2048;
+static const uint8_t MAX_KNOB_STATE_LISTENERS = 4;
 
-class MotorTask : public Task<MotorTask> {
-    friend class Task<MotorTask>; // Allow base Task to invoke protected run()
+class MotorTask : public Task<MotorTask, MOTOR_TASK_STACK_SIZE, MOTOR_TASK_PRIORITY> {
+    template<class, uint32_t, UBaseType_t> friend class Task; // Allow base Task to invoke protected run()
 
     public:
-        MotorTask(const uint8_t task_core);
+        MotorTask(const uint8_t task_core, I2CBus& i2c_bus);
         ~MotorTask();
 
-        void setConfig(const KnobConfig& config);
+        // Only call these from a single task (the interface task); they never block. A config replaces any that the
+        // motor loop hasn't picked up yet, and a haptic is dropped if several are already pending. The config's id
+        // comes back in the knob states (as config_id), to tell which config they're for.
+        void setConfig(const KnobConfig& config, uint32_t config_id);
         void playHaptic(bool press);
 
         void addListener(QueueHandle_t queue);
 
+        // Around flash erases and writes, which stall the motor loop along with everything else
+        void suspendWatchdog();
+        void resumeWatchdog();
+        MotorFault getFault() const;
+
     protected:
         void run();
 
     private:
-        QueueHandle_t queue_;
-
-        std::vector<QueueHandle_t> listeners_;
+        struct ConfigUpdate {
+            KnobConfig config;
+            uint32_t id;
+        };
+
+        I2CBus& i2c_bus_;
+        Mailbox<ConfigUpdate> config_mailbox_;
+        SpscRing<HapticData, 4> haptic_ring_;
+        MotorSupervisor supervisor_;
+
+        // Fixed size, so adding a listener doesn't allocate. Listeners are added while the motor loop may already be
+        // publishing, so the count is only raised once the new entry is in place.
+        QueueHandle_t listeners_[MAX_KNOB_STATE_LISTENERS];
+        std::atomic<uint8_t> listener_count_;
 
         void publish(const KnobState& state);
 };
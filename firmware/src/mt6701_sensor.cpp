@@ -1,4 +1,7 @@
+#include "flight_recorder.h"
+#include "logger.h"
 #include "mt6701_sensor.h"
+#include "profiler.h"
 #include "driver/spi_master.h"
 
 static const float ALPHA = 0.4;
@@ -82,6 +85,7 @@ void MT6701Sensor::init() {
 }
 
 float MT6701Sensor::getSensorAngle() {
+    ProfileScope scope(ProfileSection::SENSOR_READ);
     uint32_t now = micros();
     if (now - last_update_ > 100) {
       
@@ -104,8 +108,10 @@ float MT6701Sensor::getSensorAngle() {
         float new_y = sinf(new_angle);
         x_ = new_x * ALPHA + x_ * (1-ALPHA);
         y_ = new_y * ALPHA + y_ * (1-ALPHA);
+        last_valid_micros_ = now;
       } else {
-        Serial.printf("Bad CRC. expected %d, actual %d\n", calculated_crc, received_crc);
+        LOG_WARNING("Bad CRC. expected %d, actual %d", calculated_crc, received_crc);
+        FlightRecorder::event(FlightRecordType::SENSOR_ERROR, (uint8_t)FlightSensorError::BAD_CRC);
       }
 
       last_update_ = now;
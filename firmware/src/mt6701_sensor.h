@@ -16,6 +16,9 @@ class MT6701Sensor : public Sensor {
         //    Calling this method directly does not update the base-class internal fields.
         //    Use update() when calling from outside code.
         float getSensorAngle();
+
+        // micros() of the last reading that passed its CRC
+        uint32_t getLastValidMicros() const { return last_valid_micros_; }
     private:
 
         spi_device_handle_t spi_device_;
@@ -24,4 +27,5 @@ class MT6701Sensor : public Sensor {
         float x_;
         float y_;
         uint32_t last_update_;
+        uint32_t last_valid_micros_ = 0;
 };
@@ -0,0 +1,70 @@
+#include "partition_flash_region.h"
+
+PartitionFlashRegion::PartitionFlashRegion(const char* label, uint8_t subtype) : label_(label), subtype_(subtype) {}
+
+PartitionFlashRegion::~PartitionFlashRegion() {
+    unmap();
+}
+
+bool PartitionFlashRegion::begin() {
+    partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)subtype_, label_);
+    return partition_ != nullptr;
+}
+
+void PartitionFlashRegion::setStallFunction(StallFunction stall, void* arg) {
+    stall_ = stall;
+    stall_arg_ = arg;
+}
+
+size_t PartitionFlashRegion::getSize() {
+    return partition_ == nullptr ? 0 : partition_->size;
+}
+
+bool PartitionFlashRegion::erase(size_t offset, size_t length) {
+    if (partition_ == nullptr) {
+        return false;
+    }
+    stall(true);
+    esp_err_t result = esp_partition_erase_range(partition_, offset, length);
+    stall(false);
+    return result == ESP_OK;
+}
+
+bool PartitionFlashRegion::write(size_t offset, const uint8_t* data, size_t length) {
+    if (partition_ == nullptr) {
+        return false;
+    }
+    stall(true);
+    esp_err_t result = esp_partition_write(partition_, offset, data, length);
+    stall(false);
+    return result == ESP_OK;
+}
+
+bool PartitionFlashRegion::read(size_t offset, uint8_t* data, size_t length) {
+    return partition_ != nullptr && esp_partition_read(partition_, offset, data, length) == ESP_OK;
+}
+
+const uint8_t* PartitionFlashRegion::map() {
+    if (partition_ == nullptr) {
+        return nullptr;
+    }
+    // Remap so the cache doesn't serve contents from before the last erase/write
+    unmap();
+    if (esp_partition_mmap(partition_, 0, partition_->size, SPI_FLASH_MMAP_DATA, &mapped_, &mmap_handle_) != ESP_OK) {
+        mapped_ = nullptr;
+    }
+    return (const uint8_t*)mapped_;
+}
+
+void PartitionFlashRegion::stall(bool stalling) {
+    if (stall_ != nullptr) {
+        stall_(stall_arg_, stalling);
+    }
+}
+
+void PartitionFlashRegion::unmap() {
+    if (mapped_ != nullptr) {
+        spi_flash_munmap(mmap_handle_);
+        mapped_ = nullptr;
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <esp_partition.h>
+#include <esp_spi_flash.h>
+
+#include "flash_region.h"
+
+// FlashRegion backed by a data partition from partitions.csv. Note that erasing and writing stalls both cores
+// (the flash cache is disabled meanwhile), so keep these off the hot path, and let anything that watches for stalls
+// know with setStallFunction().
+class PartitionFlashRegion : public FlashRegion {
+    public:
+        PartitionFlashRegion(const char* label, uint8_t subtype);
+        ~PartitionFlashRegion();
+
+        // Called with true before each erase and write, and with false after
+        typedef void (*StallFunction)(void* arg, bool stalling);
+
+        // Returns false if the partition doesn't exist in the flashed partition table
+        bool begin();
+        void setStallFunction(StallFunction stall, void* arg);
+
+        size_t getSize() override;
+        bool erase(size_t offset, size_t length) override;
+        bool write(size_t offset, const uint8_t* data, size_t length) override;
+        bool read(size_t offset, uint8_t* data, size_t length) override;
+        const uint8_t* map() override;
+
+    private:
+        const char* label_;
+        const uint8_t subtype_;
+        const esp_partition_t* partition_ = nullptr;
+        StallFunction stall_ = nullptr;
+        void* stall_arg_ = nullptr;
+
+        const void* mapped_ = nullptr;
+        spi_flash_mmap_handle_t mmap_handle_;
+
+        void unmap();
+        void stall(bool stalling);
+};
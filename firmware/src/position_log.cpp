@@ -0,0 +1,184 @@
+#include <string.h>
+
+#include "position_log.h"
+#include "protocol.h"
+
+static_assert(sizeof(PositionLogEntry) == 16, "PositionLogEntry layout is part of the flash format");
+
+PositionLog::PositionLog(FlashRegion& flash) : flash_(flash) {
+    // Copying the live entries forward has to fit in the sector being written
+    static_assert(MAX_IDS < ENTRIES_PER_SECTOR, "Too many ids to copy forward");
+}
+
+bool PositionLog::begin() {
+    slot_count_ = 0;
+    sector_ = 0;
+    next_entry_ = 0;
+    next_sequence_ = 1;
+    sector_count_ = flash_.getSize() / FlashRegion::SECTOR_SIZE;
+    const uint8_t* image = flash_.map();
+    if (image == nullptr || sector_count_ < 2) {
+        return false;
+    }
+
+    uint32_t max_sequence = 0;
+    bool blank = true;
+    for (uint16_t sector = 0; sector < sector_count_; sector++) {
+        for (size_t i = 0; i < ENTRIES_PER_SECTOR; i++) {
+            const uint8_t* data = image + sector * FlashRegion::SECTOR_SIZE + i * sizeof(PositionLogEntry);
+            if (isBlank(data, sizeof(PositionLogEntry))) {
+                continue;
+            }
+            blank = false;
+            PositionLogEntry entry;
+            memcpy(&entry, data, sizeof(entry));
+            if (entry.crc != entryCrc(entry) || entry.sequence == UINT32_MAX) {
+                continue;
+            }
+            update(entry.id, entry.position, entry.sequence, sector);
+            if (entry.sequence > max_sequence) {
+                max_sequence = entry.sequence;
+                sector_ = sector;
+            }
+        }
+    }
+
+    if (max_sequence == 0) {
+        // Nothing valid; start over if the region holds something else (e.g. a previous partition layout)
+        if (!blank) {
+            for (uint16_t sector = 0; sector < sector_count_; sector++) {
+                if (!eraseSector(sector)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Resume after the last entry that was (even partially) written
+    next_sequence_ = max_sequence + 1;
+    const uint8_t* current = image + sector_ * FlashRegion::SECTOR_SIZE;
+    for (next_entry_ = ENTRIES_PER_SECTOR; next_entry_ > 0; next_entry_--) {
+        if (!isBlank(current + (next_entry_ - 1) * sizeof(PositionLogEntry), sizeof(PositionLogEntry))) {
+            break;
+        }
+    }
+
+    uint16_t spare = (sector_ + 1) % sector_count_;
+    if (!isBlank(image + spare * FlashRegion::SECTOR_SIZE, FlashRegion::SECTOR_SIZE)) {
+        return prepareSpare();
+    }
+    return true;
+}
+
+bool PositionLog::get(uint32_t id, int32_t& position) const {
+    for (uint8_t i = 0; i < slot_count_; i++) {
+        if (slots_[i].id == id) {
+            position = slots_[i].position;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PositionLog::write(uint32_t id, int32_t position) {
+    if (sector_count_ < 2) {
+        return false;
+    }
+    if (next_entry_ == ENTRIES_PER_SECTOR && !advance()) {
+        return false;
+    }
+
+    PositionLogEntry entry = {
+        .sequence = next_sequence_++,
+        .id = id,
+        .position = position,
+        .crc = 0,
+    };
+    entry.crc = entryCrc(entry);
+    // The entry is consumed even if the write fails, since it may have been partially programmed
+    size_t offset = sector_ * FlashRegion::SECTOR_SIZE + next_entry_++ * sizeof(PositionLogEntry);
+    if (!flash_.write(offset, (const uint8_t*)&entry, sizeof(entry))) {
+        return false;
+    }
+    write_count_++;
+    update(id, position, entry.sequence, sector_);
+    return true;
+}
+
+PositionLog::Slot* PositionLog::findSlot(uint32_t id) {
+    for (uint8_t i = 0; i < slot_count_; i++) {
+        if (slots_[i].id == id) {
+            return &slots_[i];
+        }
+    }
+    return nullptr;
+}
+
+void PositionLog::update(uint32_t id, int32_t position, uint32_t sequence, uint16_t sector) {
+    Slot* slot = findSlot(id);
+    if (slot == nullptr) {
+        if (slot_count_ < MAX_IDS) {
+            slot = &slots_[slot_count_++];
+        } else {
+            slot = &slots_[0];
+            for (uint8_t i = 1; i < slot_count_; i++) {
+                if (slots_[i].sequence < slot->sequence) {
+                    slot = &slots_[i];
+                }
+            }
+            if (slot->sequence > sequence) {
+                return;
+            }
+        }
+        slot->id = id;
+        slot->sequence = 0;
+    }
+    if (sequence < slot->sequence) {
+        return;
+    }
+    slot->position = position;
+    slot->sequence = sequence;
+    slot->sector = sector;
+}
+
+bool PositionLog::advance() {
+    sector_ = (sector_ + 1) % sector_count_;
+    next_entry_ = 0;
+    return prepareSpare();
+}
+
+bool PositionLog::prepareSpare() {
+    uint16_t spare = (sector_ + 1) % sector_count_;
+    for (uint8_t i = 0; i < slot_count_; i++) {
+        if (slots_[i].sector != spare) {
+            continue;
+        }
+        // Can't run out of room given MAX_IDS < ENTRIES_PER_SECTOR, as this runs before anything else is written
+        if (next_entry_ == ENTRIES_PER_SECTOR || !write(slots_[i].id, slots_[i].position)) {
+            return false;
+        }
+    }
+    return eraseSector(spare);
+}
+
+bool PositionLog::eraseSector(uint16_t sector) {
+    if (!flash_.erase(sector * FlashRegion::SECTOR_SIZE, FlashRegion::SECTOR_SIZE)) {
+        return false;
+    }
+    erase_count_++;
+    return true;
+}
+
+bool PositionLog::isBlank(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t PositionLog::entryCrc(const PositionLogEntry& entry) {
+    return crc32((const uint8_t*)&entry, offsetof(PositionLogEntry, crc));
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flash_region.h"
+
+struct PositionLogEntry {
+    // Increases with every entry written; the newest entry for an id wins
+    uint32_t sequence;
+    uint32_t id;
+    int32_t position;
+    // CRC-32 of the fields above, so entries torn by a power loss are ignored
+    uint32_t crc;
+};
+
+// Append-only log of knob positions per config id, written round-robin through the sectors of a flash region to
+// spread wear. The latest position of each id is also kept in RAM, so reads never touch flash.
+//
+// One sector is always kept erased ahead of the one being written. Before moving on to it, the live entries in the
+// sector after it (the oldest) are copied forward and only then is that sector erased, so losing power at any point
+// loses at most the entry being written.
+class PositionLog {
+    public:
+        // Positions are kept for this many ids; beyond that the least recently written id is dropped
+        static const uint8_t MAX_IDS = 32;
+
+        PositionLog(FlashRegion& flash);
+
+        // Scans the region to restore the latest positions and finishes any copy/erase a power loss interrupted
+        bool begin();
+
+        bool get(uint32_t id, int32_t& position) const;
+        // Appends an entry; returns false if the flash couldn't be written
+        bool write(uint32_t id, int32_t position);
+
+        uint32_t getWriteCount() const { return write_count_; }
+        uint32_t getEraseCount() const { return erase_count_; }
+
+    private:
+        static const size_t ENTRIES_PER_SECTOR = FlashRegion::SECTOR_SIZE / sizeof(PositionLogEntry);
+
+        struct Slot {
+            uint32_t id;
+            int32_t position;
+            uint32_t sequence;
+            // Sector holding the entry this came from
+            uint16_t sector;
+        };
+
+        FlashRegion& flash_;
+        uint16_t sector_count_ = 0;
+
+        Slot slots_[MAX_IDS] = {};
+        uint8_t slot_count_ = 0;
+
+        uint16_t sector_ = 0;
+        size_t next_entry_ = 0;
+        uint32_t next_sequence_ = 1;
+
+        uint32_t write_count_ = 0;
+        uint32_t erase_count_ = 0;
+
+        Slot* findSlot(uint32_t id);
+        void update(uint32_t id, int32_t position, uint32_t sequence, uint16_t sector);
+        bool advance();
+        bool prepareSpare();
+        bool eraseSector(uint16_t sector);
+        static bool isBlank(const uint8_t* data, size_t length);
+        static uint32_t entryCrc(const PositionLogEntry& entry);
+};
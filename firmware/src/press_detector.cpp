@@ -0,0 +1,105 @@
+#include "press_detector.h"
+
+#include "util.h"
+
+// Based on the original fixed calibration (zero ~950000, full press ~1800000, press at 0.75 and release at 0.25)
+const PressDetectorConfig PressDetector::DEFAULT_CONFIG = {
+    .full_scale = 850000,
+    .thresholds = {
+        {0.1, 0.05},
+        {0.75, 0.25},
+        {1.25, 0.9},
+    },
+    .debounce_samples = 1,
+    .baseline_time_constant_seconds = 5,
+    .max_baseline_drift_unit_per_second = 0.02,
+    .release_time_constant_seconds = 1,
+    .min_valid_unit = -1,
+    .max_valid_unit = 3,
+    .reseed_discarded_samples = 20,
+};
+
+// Samples further apart than this are treated as a gap in the data rather than elapsed time to track drift over
+static const float MAX_SAMPLE_INTERVAL_SECONDS = 1;
+
+PressDetector::PressDetector(const PressDetectorConfig& config) : config_(config) {}
+
+bool PressDetector::update(int32_t reading, uint32_t timestamp_micros) {
+    if (!initialized_) {
+        // Assume the knob isn't being pressed at startup (if it is, the readings once it's let go are discarded, and
+        // then the baseline is seeded again)
+        baseline_ = reading;
+        last_timestamp_micros_ = timestamp_micros;
+        initialized_ = true;
+        return false;
+    }
+
+    float value_unit = (reading - baseline_) / config_.full_scale;
+    if (value_unit < config_.min_valid_unit || value_unit > config_.max_valid_unit) {
+        discarded_count_++;
+        if (++discarded_run_ < config_.reseed_discarded_samples) {
+            return false;
+        }
+        baseline_ = reading;
+        last_timestamp_micros_ = timestamp_micros;
+        value_unit = 0;
+        reseed_count_++;
+    }
+    discarded_run_ = 0;
+
+    float dt_seconds = (timestamp_micros - last_timestamp_micros_) / 1000000.f;
+    last_timestamp_micros_ = timestamp_micros;
+    value_unit_ = value_unit;
+
+    // A resting light touch is slowly absorbed into the baseline too, which also recovers from creep that leaves
+    // the reading slightly above the old zero point after a hard press
+    if (level_ <= PressLevel::LIGHT_TOUCH && candidate_count_ == 0) {
+        trackBaseline(reading, CLAMP(dt_seconds, 0.f, MAX_SAMPLE_INTERVAL_SECONDS));
+    }
+
+    PressLevel new_level = levelFor(value_unit_);
+    if (new_level == level_) {
+        candidate_count_ = 0;
+        return false;
+    }
+    if (new_level != candidate_level_) {
+        candidate_level_ = new_level;
+        candidate_count_ = 0;
+    }
+    candidate_count_++;
+    if (candidate_count_ < config_.debounce_samples) {
+        return false;
+    }
+    level_ = new_level;
+    candidate_count_ = 0;
+    return true;
+}
+
+float PressDetector::getValueUnit() const {
+    return CLAMP(value_unit_, 0.f, 1.f);
+}
+
+// Applies hysteresis: levels above the current one need their enter threshold, while the current level is kept
+// until the value drops below its exit threshold.
+PressLevel PressDetector::levelFor(float value_unit) const {
+    uint8_t current = static_cast<uint8_t>(level_);
+    uint8_t level = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+        const PressThreshold& threshold = config_.thresholds[i];
+        float limit = (i + 1 <= current) ? threshold.exit_unit : threshold.enter_unit;
+        if (value_unit > limit) {
+            level = i + 1;
+        }
+    }
+    return static_cast<PressLevel>(level);
+}
+
+void PressDetector::trackBaseline(float reading, float dt_seconds) {
+    if (reading < baseline_) {
+        baseline_ += (reading - baseline_) * CLAMP(dt_seconds / config_.release_time_constant_seconds, 0.f, 1.f);
+        return;
+    }
+    float alpha = CLAMP(dt_seconds / config_.baseline_time_constant_seconds, 0.f, 1.f);
+    float max_step = config_.max_baseline_drift_unit_per_second * config_.full_scale * dt_seconds;
+    baseline_ += CLAMP((reading - baseline_) * alpha, -max_step, max_step);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+enum class PressLevel : uint8_t {
+    NONE = 0,
+    LIGHT_TOUCH,
+    PRESS,
+    HARD_PRESS,
+};
+
+struct PressThreshold {
+    // Level is entered when the value rises above enter_unit and left when it falls below exit_unit
+    float enter_unit;
+    float exit_unit;
+};
+
+struct PressDetectorConfig {
+    // Reading change from the baseline (raw counts) that corresponds to a value of 1.0
+    int32_t full_scale;
+
+    // Thresholds for LIGHT_TOUCH, PRESS and HARD_PRESS, in units of full_scale
+    PressThreshold thresholds[3];
+
+    // Number of consecutive samples a new level must be seen for before it's reported. Each extra sample adds 100 ms
+    // at the HX711's 10 SPS, and the thresholds' hysteresis already keeps noise from toggling the level.
+    uint8_t debounce_samples;
+
+    // Time constant of the baseline tracking while the knob isn't being touched
+    float baseline_time_constant_seconds;
+    // Fastest change (in units of full_scale per second) that is tracked as temperature drift or creep; anything
+    // faster is assumed to be an actual press and doesn't move the baseline
+    float max_baseline_drift_unit_per_second;
+    // Time constant for readings below the baseline, which can't be a press: mostly the knob springing back from a
+    // light touch that was partly absorbed into the baseline, which would otherwise take a press's worth of force
+    // off the next press until the drift limit lets the baseline back down
+    float release_time_constant_seconds;
+
+    // Readings outside of this range (in units of full_scale, relative to the baseline) are discarded as glitches
+    float min_valid_unit;
+    float max_valid_unit;
+    // After this many discarded readings in a row, the reading has moved for good rather than glitched (say the knob
+    // was held down at startup and has since been let go), so the baseline starts over from the current reading
+    uint8_t reseed_discarded_samples;
+};
+
+// Turns raw strain gauge readings into a debounced press level. The zero point is tracked continuously while idle
+// so slow drift (temperature, mechanical creep) doesn't accumulate into false presses. This has no hardware
+// dependencies, so recorded traces can be replayed through it on a host.
+class PressDetector {
+    public:
+        static const PressDetectorConfig DEFAULT_CONFIG;
+
+        PressDetector(const PressDetectorConfig& config = DEFAULT_CONFIG);
+
+        // Feeds a new reading; returns true if the reported level changed
+        bool update(int32_t reading, uint32_t timestamp_micros);
+
+        PressLevel getLevel() const { return level_; }
+        // How far the knob is pressed, clamped to [0, 1]
+        float getValueUnit() const;
+        float getBaseline() const { return baseline_; }
+        uint32_t getDiscardedCount() const { return discarded_count_; }
+        uint32_t getReseedCount() const { return reseed_count_; }
+
+    private:
+        PressDetectorConfig config_;
+
+        bool initialized_ = false;
+        float baseline_ = 0;
+        float value_unit_ = 0;
+        uint32_t last_timestamp_micros_ = 0;
+
+        PressLevel level_ = PressLevel::NONE;
+        PressLevel candidate_level_ = PressLevel::NONE;
+        uint8_t candidate_count_ = 0;
+
+        uint32_t discarded_count_ = 0;
+        uint8_t discarded_run_ = 0;
+        uint32_t reseed_count_ = 0;
+
+        PressLevel levelFor(float value_unit) const;
+        void trackBaseline(float reading, float dt_seconds);
+};
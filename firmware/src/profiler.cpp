@@ -0,0 +1,99 @@
+#include "logger.h"
+#include "profiler.h"
+
+static const char* SECTION_NAMES[] = {
+    "motor period",
+    "motor loop",
+    "  sensor read",
+    "  loopFOC",
+    "  detent",
+    "  publish",
+    "display frame",
+    "  render",
+    "  push",
+    "led frame",
+    "  show",
+    "interface",
+};
+static_assert(sizeof(SECTION_NAMES) / sizeof(SECTION_NAMES[0]) == (uint8_t)ProfileSection::COUNT, "Missing section names");
+
+Profiler::Section Profiler::sections_[(uint8_t)ProfileSection::COUNT];
+std::atomic<uint32_t> Profiler::epoch_;
+uint32_t Profiler::window_start_micros_;
+
+void Profiler::record(ProfileSection section, uint32_t cycles) {
+    Section& s = sections_[(uint8_t)section];
+    uint32_t sequence = s.sequence.load(std::memory_order_relaxed);
+    s.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint32_t epoch = epoch_.load(std::memory_order_relaxed);
+    if (s.epoch != epoch) {
+        s.epoch = epoch;
+        s.count = 0;
+        s.total_cycles = 0;
+        s.total_squares = 0;
+        s.min_cycles = UINT32_MAX;
+        s.max_cycles = 0;
+    }
+    s.count++;
+    s.total_cycles += cycles;
+    s.total_squares += (uint64_t)cycles * cycles;
+    if (cycles < s.min_cycles) {
+        s.min_cycles = cycles;
+    }
+    if (cycles > s.max_cycles) {
+        s.max_cycles = cycles;
+    }
+
+    s.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void Profiler::log() {
+    uint32_t now = micros();
+    uint32_t window_micros = now - window_start_micros_;
+    uint32_t epoch = epoch_.load(std::memory_order_relaxed);
+    float cycles_per_micro = ESP.getCpuFreqMHz();
+
+    LOG_INFO("Profile over %.1f s:", window_micros / 1e6f);
+    for (uint8_t i = 0; i < (uint8_t)ProfileSection::COUNT; i++) {
+        Section& s = sections_[i];
+        uint32_t count;
+        uint64_t total_cycles;
+        uint64_t total_squares;
+        uint32_t min_cycles;
+        uint32_t max_cycles;
+        bool current;
+        uint32_t sequence;
+        do {
+            sequence = s.sequence.load(std::memory_order_acquire);
+            current = s.epoch == epoch;
+            count = s.count;
+            total_cycles = s.total_cycles;
+            total_squares = s.total_squares;
+            min_cycles = s.min_cycles;
+            max_cycles = s.max_cycles;
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((sequence & 1) != 0 || sequence != s.sequence.load(std::memory_order_relaxed));
+
+        if (!current || count == 0) {
+            continue;
+        }
+        float total_micros = total_cycles / cycles_per_micro;
+        // Doubles, since the variance is a small difference of two large numbers
+        double mean_cycles = (double)total_cycles / count;
+        double variance = (double)total_squares / count - mean_cycles * mean_cycles;
+        float sd_micros = variance > 0 ? sqrt(variance) / cycles_per_micro : 0;
+        LOG_INFO("%-14s %7u calls  avg %7.1f us  sd %6.1f  min %7.1f  max %7.1f us  %5.1f%%",
+            SECTION_NAMES[i],
+            count,
+            total_micros / count,
+            sd_micros,
+            min_cycles / cycles_per_micro,
+            max_cycles / cycles_per_micro,
+            total_micros * 100 / window_micros);
+    }
+
+    window_start_micros_ = now;
+    epoch_.store(epoch + 1, std::memory_order_relaxed);
+}
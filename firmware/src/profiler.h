@@ -0,0 +1,99 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+// Scoped timers are compiled out with SK_PROFILE=0
+#ifndef SK_PROFILE
+#define SK_PROFILE 1
+#endif
+
+// Each section is only ever timed by one task. The top-level section of each task covers everything it does per
+// loop iteration, so its share of the report window is that task's CPU time.
+enum class ProfileSection : uint8_t {
+    // Start-to-start interval of motor loop iterations; its spread is the loop's scheduling jitter
+    MOTOR_PERIOD = 0,
+    MOTOR_LOOP,
+    // Nested in LOOP_FOC
+    SENSOR_READ,
+    LOOP_FOC,
+    DETENT,
+    PUBLISH,
+
+    DISPLAY_FRAME,
+    RENDER,
+    PUSH,
+
+    LED_FRAME,
+    LED_SHOW,
+
+    INTERFACE,
+
+    COUNT,
+};
+
+// Per-section call counts and durations, measured in CPU cycles. Recording is lock-free (a sequence counter lets
+// the reporting task take consistent snapshots), so timing the motor loop costs a few dozen cycles per section.
+// Durations include any time the task was preempted inside the section.
+class Profiler {
+    public:
+        static inline uint32_t cycles() {
+            #if defined(__XTENSA__)
+                uint32_t ccount;
+                __asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+                return ccount;
+            #else
+                return ESP.getCycleCount();
+            #endif
+        }
+
+        static void record(ProfileSection section, uint32_t cycles);
+
+        // Logs every section's stats since the previous report (or boot), then starts a new window
+        static void log();
+
+    private:
+        struct Section {
+            // Odd while the owning task is updating the fields below
+            std::atomic<uint32_t> sequence;
+            uint32_t epoch;
+            uint32_t count;
+            uint64_t total_cycles;
+            // Sum of squared durations, for the standard deviation; holds about 3 days of 1 ms motor loop periods
+            uint64_t total_squares;
+            uint32_t min_cycles;
+            uint32_t max_cycles;
+        };
+
+        static Section sections_[(uint8_t)ProfileSection::COUNT];
+        // Bumped by log(); sections recorded under an older epoch start over on their next record
+        static std::atomic<uint32_t> epoch_;
+        static uint32_t window_start_micros_;
+};
+
+#if SK_PROFILE
+// Times from construction until stop() or destruction
+class ProfileScope {
+    public:
+        ProfileScope(ProfileSection section) : section_(section), start_(Profiler::cycles()) {}
+        ~ProfileScope() { stop(); }
+
+        void stop() {
+            if (running_) {
+                Profiler::record(section_, Profiler::cycles() - start_);
+                running_ = false;
+            }
+        }
+
+    private:
+        const ProfileSection section_;
+        const uint32_t start_;
+        bool running_ = true;
+};
+#else
+class ProfileScope {
+    public:
+        ProfileScope(ProfileSection section) {}
+        void stop() {}
+};
+#endif
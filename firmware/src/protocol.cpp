@@ -0,0 +1,448 @@
+#include <string.h>
+
+#include "protocol.h"
+
+const char* latencyPathName(LatencyPath path) {
+    switch (path) {
+        case LatencyPath::SENSOR_TO_TORQUE:
+            return "sensor to torque";
+        case LatencyPath::SENSOR_TO_PUBLISH:
+            return "sensor to publish";
+        case LatencyPath::SENSOR_TO_RENDER:
+            return "sensor to render";
+        case LatencyPath::SENSOR_TO_PIXELS:
+            return "sensor to pixels";
+        default:
+            return "?";
+    }
+}
+
+uint8_t latencyBucket(uint32_t micros) {
+    // Bit length, less the 6 bits that all fall in bucket 0
+    int bits = micros == 0 ? 0 : 32 - __builtin_clz(micros);
+    return bits <= 6 ? 0 : (bits - 6 >= LATENCY_BUCKETS ? LATENCY_BUCKETS - 1 : bits - 6);
+}
+
+uint32_t latencyBucketLimitMicros(uint8_t bucket) {
+    return bucket >= LATENCY_BUCKETS - 1 ? UINT32_MAX : (uint32_t)64 << bucket;
+}
+
+uint32_t latencySampleCount(const LatencyMessage& message) {
+    uint32_t count = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+        count += message.buckets[i];
+    }
+    return count;
+}
+
+uint32_t latencyPercentileMicros(const LatencyMessage& message, float fraction) {
+    uint32_t count = latencySampleCount(message);
+    if (count == 0) {
+        return 0;
+    }
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+        cumulative += message.buckets[i];
+        if (cumulative >= fraction * count) {
+            uint32_t limit = latencyBucketLimitMicros(i);
+            return limit < message.max_micros ? limit : message.max_micros;
+        }
+    }
+    return message.max_micros;
+}
+
+const char* flightRecordTypeName(FlightRecordType type) {
+    switch (type) {
+        case FlightRecordType::SAMPLE:
+            return "sample";
+        case FlightRecordType::CONFIG:
+            return "config";
+        case FlightRecordType::HAPTIC:
+            return "haptic";
+        case FlightRecordType::SENSOR_ERROR:
+            return "sensor error";
+        default:
+            return "?";
+    }
+}
+
+const char* flightFreezeReasonName(FlightFreezeReason reason) {
+    switch (reason) {
+        case FlightFreezeReason::NONE:
+            return "recording";
+        case FlightFreezeReason::MOTOR_FAULT:
+            return "motor fault";
+        case FlightFreezeReason::REQUESTED:
+            return "requested";
+        case FlightFreezeReason::CRASH:
+            return "crash";
+        default:
+            return "?";
+    }
+}
+
+uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc) {
+    // Bitwise (table-free) CRC-32; frames are short, so this is cheaper in flash than a 1KB table
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+size_t cobsEncode(const uint8_t* data, size_t length, uint8_t* out) {
+    size_t code_index = 0;
+    size_t out_index = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] == 0) {
+            out[code_index] = code;
+            code_index = out_index++;
+            code = 1;
+        } else {
+            out[out_index++] = data[i];
+            code++;
+            if (code == 0xFF) {
+                out[code_index] = code;
+                code_index = out_index++;
+                code = 1;
+            }
+        }
+    }
+    out[code_index] = code;
+    return out_index;
+}
+
+size_t cobsDecode(const uint8_t* data, size_t length, uint8_t* out) {
+    size_t in_index = 0;
+    size_t out_index = 0;
+    while (in_index < length) {
+        uint8_t code = data[in_index++];
+        if (code == 0 || in_index + code - 1 > length) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            if (data[in_index] == 0) {
+                return 0;
+            }
+            out[out_index++] = data[in_index++];
+        }
+        if (code != 0xFF && in_index < length) {
+            out[out_index++] = 0;
+        }
+    }
+    return out_index;
+}
+
+
+PayloadWriter::PayloadWriter(uint8_t* buffer, size_t size) : buffer_(buffer), size_(size) {}
+
+void PayloadWriter::u8(uint8_t value) {
+    if (length_ + 1 > size_) {
+        overflow_ = true;
+        return;
+    }
+    buffer_[length_++] = value;
+}
+
+void PayloadWriter::u16(uint16_t value) {
+    u8(value & 0xFF);
+    u8(value >> 8);
+}
+
+void PayloadWriter::u32(uint32_t value) {
+    u16(value & 0xFFFF);
+    u16(value >> 16);
+}
+
+void PayloadWriter::i32(int32_t value) {
+    u32((uint32_t)value);
+}
+
+void PayloadWriter::f32(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    u32(bits);
+}
+
+void PayloadWriter::string(const char* value, size_t max_length) {
+    size_t length = strnlen(value, max_length);
+    if (length > UINT8_MAX) {
+        length = UINT8_MAX;
+    }
+    u8(length);
+    for (size_t i = 0; i < length; i++) {
+        u8(value[i]);
+    }
+}
+
+
+PayloadReader::PayloadReader(const uint8_t* buffer, size_t length) : buffer_(buffer), length_(length) {}
+
+uint8_t PayloadReader::u8() {
+    if (position_ + 1 > length_) {
+        error_ = true;
+        return 0;
+    }
+    return buffer_[position_++];
+}
+
+uint16_t PayloadReader::u16() {
+    uint16_t low = u8();
+    return low | (u8() << 8);
+}
+
+uint32_t PayloadReader::u32() {
+    uint32_t low = u16();
+    return low | ((uint32_t)u16() << 16);
+}
+
+int32_t PayloadReader::i32() {
+    return (int32_t)u32();
+}
+
+float PayloadReader::f32() {
+    uint32_t bits = u32();
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void PayloadReader::string(char* out, size_t out_size) {
+    uint8_t length = u8();
+    if (length >= out_size) {
+        error_ = true;
+        length = 0;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+        out[i] = u8();
+    }
+    out[length] = '\0';
+}
+
+
+size_t encodeFrame(MessageId id, uint8_t sequence, const uint8_t* body, size_t body_length, uint8_t* out, size_t out_size) {
+    if (body_length > PROTOCOL_MAX_BODY || out_size < PROTOCOL_MAX_FRAME) {
+        return 0;
+    }
+    uint8_t packet[PROTOCOL_MAX_PACKET];
+    packet[0] = (uint8_t)id;
+    packet[1] = sequence;
+    memcpy(packet + 2, body, body_length);
+    uint32_t crc = crc32(packet, body_length + 2);
+    PayloadWriter crc_writer(packet + 2 + body_length, 4);
+    crc_writer.u32(crc);
+
+    out[0] = 0;
+    size_t encoded_length = cobsEncode(packet, body_length + 6, out + 1);
+    out[encoded_length + 1] = 0;
+    return encoded_length + 2;
+}
+
+bool FrameDecoder::feed(uint8_t byte) {
+    if (byte != 0) {
+        if (length_ < sizeof(buffer_)) {
+            buffer_[length_++] = byte;
+        } else {
+            overflow_ = true;
+        }
+        return false;
+    }
+
+    // Delimiter: back to back delimiters (between frames) are expected, and aren't frames
+    if (length_ == 0) {
+        return false;
+    }
+    size_t length = overflow_ ? 0 : cobsDecode(buffer_, length_, packet_);
+    length_ = 0;
+    overflow_ = false;
+
+    if (length < 6) {
+        rejected_count_++;
+        return false;
+    }
+    PayloadReader crc_reader(packet_ + length - 4, 4);
+    if (crc_reader.u32() != crc32(packet_, length - 4)) {
+        rejected_count_++;
+        return false;
+    }
+    body_length_ = length - 6;
+    frame_count_++;
+    return true;
+}
+
+
+size_t encodeAck(const AckMessage& message, uint8_t* out, size_t out_size) {
+    PayloadWriter writer(out, out_size);
+    writer.u8(message.sequence);
+    writer.u8((uint8_t)message.status);
+    return writer.ok() ? writer.getLength() : 0;
+}
+
+bool decodeAck(const uint8_t* body, size_t length, AckMessage& message) {
+    PayloadReader reader(body, length);
+    message.sequence = reader.u8();
+    message.status = (AckStatus)reader.u8();
+    return reader.ok();
+}
+
+size_t encodeStream(const StreamMessage& message, uint8_t* out, size_t out_size) {
+    PayloadWriter writer(out, out_size);
+    writer.u16(message.state_interval_millis);
+    writer.u16(message.telemetry_interval_millis);
+    return writer.ok() ? writer.getLength() : 0;
+}
+
+bool decodeStream(const uint8_t* body, size_t length, StreamMessage& message) {
+    PayloadReader reader(body, length);
+    message.state_interval_millis = reader.u16();
+    message.telemetry_interval_millis = reader.u16();
+    return reader.ok();
+}
+
+size_t encodeState(const StateMessage& message, uint8_t* out, size_t out_size) {
+    PayloadWriter writer(out, out_size);
+    writer.i32(message.current_position);
+    writer.f32(message.sub_position_unit);
+    writer.f32(message.sub_position_velocity_unit);
+    writer.u32(message.timestamp_micros);
+    writer.i32(message.num_positions);
+    writer.u8(message.config_index);
+    return writer.ok() ? writer.getLength() : 0;
+}
+
+bool decodeState(const uint8_t* body, size_t length, StateMessage& message) {
+    PayloadReader reader(body, length);
+    message.current_position = reader.i32();
+    message.sub_position_unit = reader.f32();
+    message.sub_position_velocity_unit = reader.f32();
+    message.timestamp_micros = reader.u32();
+    message.num_positions = reader.i32();
+    message.config_index = reader.u8();
+    return reader.ok();
+}
+
+size_t encodeTelemetry(const TelemetryMessage& message, uint8_t* out, size_t out_size) {
+    PayloadWriter writer(out, out_size);
+    writer.u32(message.uptime_millis);
+    writer.u8(message.press_level);
+    writer.f32(message.press_value_unit);
+    writer.f32(message.lux);
+    writer.u32(message.free_heap);
+    return writer.ok() ? writer.getLength() : 0;
+}
+
+bool decodeTelemetry(const uint8_t* body, size_t length, TelemetryMessage& message) {
+    PayloadReader reader(body, length);
+    message.uptime_millis = reader.u32();
+    message.press_level = reader.u8();
+    message.press_value_unit = reader.f32();
+    message.lux = reader.f32();
+    message.free_heap = reader.u32();
+    return reader.ok();
+}
+
+size_t encodeLatency(const LatencyMessage& message, uint8_t* out, size_t out_size) {
+    PayloadWriter writer(out, out_size);
+    writer.u8((uint8_t)message.path);
+    writer.u32(message.max_micros);
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+        writer.u32(message.buckets[i]);
+    }
+    return writer.ok() ? writer.getLength() : 0;
+}
+
+bool decodeLatency(const uint8_t* body, size_t length, LatencyMessage& message) {
+    PayloadReader reader(body, length);
+    message.path = (LatencyPath)reader.u8();
+    message.max_micros = reader.u32();
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+        message.buckets[i] = reader.u32();
+    }
+    return reader.ok() && message.path < LatencyPath::COUNT;
+}
+
+size_t encodeRecording(const RecordingMessage& message, uint8_t* out, size_t out_size) {
+    PayloadWriter writer(out, out_size);
+    writer.u8((uint8_t)message.reason);
+    writer.u32(message.freeze_millis);
+    writer.u16(message.total);
+    writer.u16(message.first);
+    writer.u8(message.count);
+    for (uint8_t i = 0; i < message.count && i < RECORDING_RECORDS_PER_MESSAGE; i++) {
+        const FlightRecord& record = message.records[i];
+        writer.u32(record.millis);
+        writer.f32(record.angle_radians);
+        writer.u16((uint16_t)record.velocity_centiradians);
+        writer.u16((uint16_t)record.torque_centivolts);
+        writer.u16((uint16_t)record.position);
+        writer.u8((uint8_t)record.type);
+        writer.u8(record.detail);
+    }
+    return writer.ok() ? writer.getLength() : 0;
+}
+
+bool decodeRecording(const uint8_t* body, size_t length, RecordingMessage& message) {
+    PayloadReader reader(body, length);
+    message.reason = (FlightFreezeReason)reader.u8();
+    message.freeze_millis = reader.u32();
+    message.total = reader.u16();
+    message.first = reader.u16();
+    message.count = reader.u8();
+    if (message.count > RECORDING_RECORDS_PER_MESSAGE) {
+        return false;
+    }
+    for (uint8_t i = 0; i < message.count; i++) {
+        FlightRecord& record = message.records[i];
+        record.millis = reader.u32();
+        record.angle_radians = reader.f32();
+        record.velocity_centiradians = (int16_t)reader.u16();
+        record.torque_centivolts = (int16_t)reader.u16();
+        record.position = (int16_t)reader.u16();
+        record.type = (FlightRecordType)reader.u8();
+        record.detail = reader.u8();
+    }
+    return reader.ok();
+}
+
+size_t encodeConfig(const KnobConfig& config, uint8_t* out, size_t out_size) {
+    PayloadWriter writer(out, out_size);
+    writer.i32(config.num_positions);
+    writer.i32(config.position);
+    writer.f32(config.position_width_radians);
+    writer.f32(config.detent_strength_unit);
+    writer.f32(config.endstop_strength_unit);
+    writer.f32(config.snap_point);
+    writer.string(config.descriptor, sizeof(config.descriptor) - 1);
+    writer.u8((uint8_t)config.display_layout);
+    writer.u8((uint8_t)config.led_effect);
+    return writer.ok() ? writer.getLength() : 0;
+}
+
+bool decodeConfig(const uint8_t* body, size_t length, KnobConfig& config) {
+    PayloadReader reader(body, length);
+    config.num_positions = reader.i32();
+    config.position = reader.i32();
+    config.position_width_radians = reader.f32();
+    config.detent_strength_unit = reader.f32();
+    config.endstop_strength_unit = reader.f32();
+    config.snap_point = reader.f32();
+    reader.string(config.descriptor, sizeof(config.descriptor));
+    config.display_layout = (DisplayLayout)reader.u8();
+    config.led_effect = (LedEffect)reader.u8();
+    if (!reader.ok()) {
+        return false;
+    }
+
+    // Reject values the motor task can't work with
+    return config.num_positions >= 0
+        && config.position >= 0
+        && (config.num_positions == 0 || config.position < config.num_positions)
+        && config.position_width_radians > 0
+        && config.snap_point > 0.5
+        && config.display_layout <= DisplayLayout::DIAL
+        && config.led_effect <= LedEffect::OFF;
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "knob_data.h"
+
+// Framed binary protocol between the knob and a host, shared by the firmware and the host library (so it has no
+// Arduino dependencies).
+//
+// Each frame is a COBS-encoded packet between 0x00 delimiters:
+//     0x00 COBS(message_id, sequence, body..., crc32) 0x00
+// The CRC-32 (IEEE, little-endian) covers the message id, sequence and body. Multi-byte fields in bodies are
+// little-endian. Plain text written to the same port (e.g. uart_serial.print) never contains 0x00, so a receiver just
+// sees it as invalid frames and can pass it through as text.
+
+static const uint8_t PROTOCOL_VERSION = 1;
+
+static const size_t PROTOCOL_MAX_BODY = 120;
+// id + sequence + body + crc
+static const size_t PROTOCOL_MAX_PACKET = 2 + PROTOCOL_MAX_BODY + 4;
+// COBS adds at most one byte per 254, plus the leading code byte; then both delimiters
+static const size_t PROTOCOL_MAX_FRAME = PROTOCOL_MAX_PACKET + PROTOCOL_MAX_PACKET / 254 + 1 + 2;
+
+enum class MessageId : uint8_t {
+    // Host to device
+    PING = 0x01,
+    SET_CONFIG = 0x02,
+    COMMAND = 0x03,
+    SET_STREAM = 0x04,
+    // Config library upload (see ConfigLibraryStore): BEGIN with the image size, WRITE chunks, then COMMIT
+    LIBRARY_BEGIN = 0x05,
+    LIBRARY_WRITE = 0x06,
+    LIBRARY_COMMIT = 0x07,
+    SELECT_CONFIG = 0x08,
+    GET_LATENCY = 0x09,
+    GET_RECORDING = 0x0A,
+
+    // Device to host
+    ACK = 0x80,
+    STATE = 0x81,
+    TELEMETRY = 0x82,
+    LOG = 0x83,
+    LATENCY = 0x84,
+    RECORDING = 0x85,
+};
+
+enum class CommandId : uint8_t {
+    NEXT_CONFIG = 0,
+    PREVIOUS_CONFIG,
+    HAPTIC_PRESS,
+    HAPTIC_RELEASE,
+    // Logs each task's peak stack usage
+    LOG_STACKS,
+    // Logs CPU time and call counts per profiled section since the last report
+    LOG_PROFILE,
+    // Logs heap use, peak and fragmentation, and allocations per task (see HeapMonitor)
+    LOG_HEAP,
+    // Freezes the flight recorder, as a motor fault would
+    FREEZE_RECORDING,
+};
+
+enum class AckStatus : uint8_t {
+    OK = 0,
+    INVALID,
+    UNSUPPORTED,
+};
+
+// ACK: acknowledges a host message by its sequence number
+struct AckMessage {
+    uint8_t sequence;
+    AckStatus status;
+};
+
+// Largest LIBRARY_WRITE chunk (the body also holds the u32 offset)
+static const size_t PROTOCOL_MAX_LIBRARY_CHUNK = PROTOCOL_MAX_BODY - 4;
+
+// PING reply is an ACK; SET_STREAM sets what the device sends unprompted (0 disables)
+struct StreamMessage {
+    uint16_t state_interval_millis;
+    uint16_t telemetry_interval_millis;
+};
+
+struct StateMessage {
+    int32_t current_position;
+    float sub_position_unit;
+    float sub_position_velocity_unit;
+    uint32_t timestamp_micros;
+    int32_t num_positions;
+    uint8_t config_index;
+};
+
+struct TelemetryMessage {
+    uint32_t uptime_millis;
+    uint8_t press_level;
+    float press_value_unit;
+    float lux;
+    uint32_t free_heap;
+};
+
+// Each path runs from the sensor sample a motor loop iteration used to a later point in the pipeline
+enum class LatencyPath : uint8_t {
+    // motor.move() with the torque computed from it
+    SENSOR_TO_TORQUE = 0,
+    // The resulting KnobState published to the other tasks
+    SENSOR_TO_PUBLISH,
+    // The display starting to render the first frame showing that state
+    SENSOR_TO_RENDER,
+    // ...and having pushed it to the panel
+    SENSOR_TO_PIXELS,
+    COUNT,
+};
+
+static const uint8_t LATENCY_BUCKETS = 16;
+
+// GET_LATENCY body is a u8: 1 to start a new window once read. The device replies with a LATENCY message per path,
+// then the ACK.
+struct LatencyMessage {
+    LatencyPath path;
+    uint32_t max_micros;
+    // Bucket 0 counts latencies under 64 us, bucket i those from 2^(i+5) up to 2^(i+6) us, and the last one
+    // everything from 2^20 us (about a second) up
+    uint32_t buckets[LATENCY_BUCKETS];
+};
+
+const char* latencyPathName(LatencyPath path);
+uint8_t latencyBucket(uint32_t micros);
+// Exclusive upper end of a bucket's range (UINT32_MAX for the last)
+uint32_t latencyBucketLimitMicros(uint8_t bucket);
+uint32_t latencySampleCount(const LatencyMessage& message);
+// Upper bound on the given percentile (0 to 1) at bucket resolution, capped at the maximum; 0 without samples
+uint32_t latencyPercentileMicros(const LatencyMessage& message, float fraction);
+
+// Flight recorder capture (see FlightRecorder in the firmware)
+enum class FlightRecordType : uint8_t {
+    // Decimated motor loop state; detail is the MotorFault, if any
+    SAMPLE = 0,
+    // A new config taken by the motor loop; position is its position and detail its number of positions (capped at
+    // 255, 0 for unbounded)
+    CONFIG,
+    // A haptic pulse; detail is 1 for a press, 0 for a release
+    HAPTIC,
+    // detail is a FlightSensorError
+    SENSOR_ERROR,
+};
+
+enum class FlightSensorError : uint8_t {
+    BAD_CRC = 1,
+    READ_FAILED,
+    // Stopped updating and had to be reconfigured
+    LOCKED,
+};
+
+enum class FlightFreezeReason : uint8_t {
+    // Still recording
+    NONE = 0,
+    MOTOR_FAULT,
+    // FREEZE_RECORDING command
+    REQUESTED,
+    // Kept from before a panic, watchdog or brownout reset (times are from before the reset)
+    CRASH,
+};
+
+// Event records fill in the motion fields with the latest sample's values
+struct FlightRecord {
+    uint32_t millis;
+    float angle_radians;
+    // Fixed point, in hundredths of rad/s and of a volt
+    int16_t velocity_centiradians;
+    int16_t torque_centivolts;
+    int16_t position;
+    FlightRecordType type;
+    uint8_t detail;
+};
+
+static const uint8_t RECORDING_RECORDS_PER_MESSAGE = 6;
+
+// GET_RECORDING body is a u8: 1 to clear the capture (and resume recording) once sent. The device replies with
+// RECORDING messages covering the capture oldest record first, then the ACK.
+struct RecordingMessage {
+    FlightFreezeReason reason;
+    uint32_t freeze_millis;
+    // Records in the whole capture, and the index in it of records[0]
+    uint16_t total;
+    uint16_t first;
+    uint8_t count;
+    FlightRecord records[RECORDING_RECORDS_PER_MESSAGE];
+};
+
+const char* flightRecordTypeName(FlightRecordType type);
+const char* flightFreezeReasonName(FlightFreezeReason reason);
+
+uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
+
+// Returns the encoded length; out must have room for length + length / 254 + 1 bytes
+size_t cobsEncode(const uint8_t* data, size_t length, uint8_t* out);
+// Returns the decoded length, or 0 if the input isn't valid COBS. Decoding in place (out == data) is allowed.
+size_t cobsDecode(const uint8_t* data, size_t length, uint8_t* out);
+
+// Bounds-checked little-endian body encoding. Writes past the end set the overflow flag instead.
+class PayloadWriter {
+    public:
+        PayloadWriter(uint8_t* buffer, size_t size);
+
+        void u8(uint8_t value);
+        void u16(uint16_t value);
+        void u32(uint32_t value);
+        void i32(int32_t value);
+        void f32(float value);
+        // Length-prefixed (u8), truncated to max_length
+        void string(const char* value, size_t max_length);
+
+        size_t getLength() const { return length_; }
+        bool ok() const { return !overflow_; }
+
+    private:
+        uint8_t* buffer_;
+        size_t size_;
+        size_t length_ = 0;
+        bool overflow_ = false;
+};
+
+// Reads past the end (or over-long strings) set the error flag and return zero values.
+class PayloadReader {
+    public:
+        PayloadReader(const uint8_t* buffer, size_t length);
+
+        uint8_t u8();
+        uint16_t u16();
+        uint32_t u32();
+        int32_t i32();
+        float f32();
+        // Always null-terminates out
+        void string(char* out, size_t out_size);
+
+        // True if everything read so far was valid and, if complete is set, the whole body was consumed
+        bool ok(bool complete = true) const { return !error_ && (!complete || position_ == length_); }
+
+    private:
+        const uint8_t* buffer_;
+        size_t length_;
+        size_t position_ = 0;
+        bool error_ = false;
+};
+
+// Builds a complete frame (with both delimiters) into out; returns its length, or 0 if it doesn't fit
+size_t encodeFrame(MessageId id, uint8_t sequence, const uint8_t* body, size_t body_length, uint8_t* out, size_t out_size);
+
+// Incremental receiver. Feed bytes as they arrive; feed() returns true when a valid frame has been completed,
+// which stays available until the next call. Anything between delimiters that isn't a valid frame is counted as
+// rejected and dropped.
+class FrameDecoder {
+    public:
+        bool feed(uint8_t byte);
+
+        MessageId getId() const { return (MessageId)packet_[0]; }
+        uint8_t getSequence() const { return packet_[1]; }
+        const uint8_t* getBody() const { return packet_ + 2; }
+        size_t getBodyLength() const { return body_length_; }
+
+        uint32_t getFrameCount() const { return frame_count_; }
+        uint32_t getRejectedCount() const { return rejected_count_; }
+
+    private:
+        // Raw (still COBS encoded) bytes since the last delimiter
+        uint8_t buffer_[PROTOCOL_MAX_FRAME] = {};
+        size_t length_ = 0;
+        bool overflow_ = false;
+
+        uint8_t packet_[PROTOCOL_MAX_FRAME] = {};
+        size_t body_length_ = 0;
+
+        uint32_t frame_count_ = 0;
+        uint32_t rejected_count_ = 0;
+};
+
+// Message bodies. encode* return the body length (0 if it doesn't fit); decode* return false on malformed input.
+size_t encodeAck(const AckMessage& message, uint8_t* out, size_t out_size);
+bool decodeAck(const uint8_t* body, size_t length, AckMessage& message);
+
+size_t encodeStream(const StreamMessage& message, uint8_t* out, size_t out_size);
+bool decodeStream(const uint8_t* body, size_t length, StreamMessage& message);
+
+size_t encodeState(const StateMessage& message, uint8_t* out, size_t out_size);
+bool decodeState(const uint8_t* body, size_t length, StateMessage& message);
+
+size_t encodeTelemetry(const TelemetryMessage& message, uint8_t* out, size_t out_size);
+bool decodeTelemetry(const uint8_t* body, size_t length, TelemetryMessage& message);
+
+size_t encodeLatency(const LatencyMessage& message, uint8_t* out, size_t out_size);
+bool decodeLatency(const uint8_t* body, size_t length, LatencyMessage& message);
+
+size_t encodeRecording(const RecordingMessage& message, uint8_t* out, size_t out_size);
+bool decodeRecording(const uint8_t* body, size_t length, RecordingMessage& message);
+
+size_t encodeConfig(const KnobConfig& config, uint8_t* out, size_t out_size);
+bool decodeConfig(const uint8_t* body, size_t length, KnobConfig& config);
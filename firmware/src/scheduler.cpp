@@ -0,0 +1,55 @@
+#include "scheduler.h"
+
+uint8_t Scheduler::add(JobFunction function, void* arg, uint32_t period_millis) {
+    assert(job_count_ < MAX_JOBS);
+    uint8_t job = job_count_++;
+    jobs_[job] = {
+        .function = function,
+        .arg = arg,
+        .period_millis = period_millis,
+        .next_millis = 0,
+        .scheduled = false,
+    };
+    return job;
+}
+
+void Scheduler::schedule(uint8_t job, uint32_t at_millis) {
+    jobs_[job].next_millis = at_millis;
+    jobs_[job].scheduled = true;
+}
+
+void Scheduler::cancel(uint8_t job) {
+    jobs_[job].scheduled = false;
+}
+
+TickType_t Scheduler::run(uint32_t now_millis) {
+    for (uint8_t i = 0; i < job_count_; i++) {
+        Job& job = jobs_[i];
+        // Signed difference so that millis() wrapping around doesn't matter
+        if (job.scheduled && (int32_t)(now_millis - job.next_millis) >= 0) {
+            if (job.period_millis > 0) {
+                // Keep the original cadence, unless we've fallen more than a whole period behind
+                job.next_millis += job.period_millis;
+                if ((int32_t)(now_millis - job.next_millis) >= 0) {
+                    job.next_millis = now_millis + job.period_millis;
+                }
+            } else {
+                job.scheduled = false;
+            }
+            // May re-arm itself (or other jobs) with schedule()
+            job.function(job.arg);
+        }
+    }
+
+    TickType_t wait = portMAX_DELAY;
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < job_count_; i++) {
+        if (!jobs_[i].scheduled) {
+            continue;
+        }
+        int32_t remaining = (int32_t)(jobs_[i].next_millis - now);
+        TickType_t ticks = remaining <= 0 ? 0 : pdMS_TO_TICKS(remaining);
+        wait = min(wait, ticks);
+    }
+    return wait;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Minimal cooperative job scheduler for a task that otherwise sleeps waiting for notifications. Jobs are either
+// periodic or one-shot (re-armed with schedule()), and run() reports how long the task can sleep until the next
+// one is due.
+class Scheduler {
+    public:
+        typedef void (*JobFunction)(void* arg);
+
+        static const uint8_t MAX_JOBS = 10;
+
+        // Adds a job, initially unscheduled; a period of 0 makes it one-shot. Returns the job id.
+        uint8_t add(JobFunction function, void* arg, uint32_t period_millis);
+
+        // (Re)arms a job to run at the given millis() time
+        void schedule(uint8_t job, uint32_t at_millis);
+        void cancel(uint8_t job);
+
+        // Runs every job that is due, and returns the number of ticks until the next one (portMAX_DELAY if none)
+        TickType_t run(uint32_t now_millis);
+
+    private:
+        struct Job {
+            JobFunction function;
+            void* arg;
+            uint32_t period_millis;
+            uint32_t next_millis;
+            bool scheduled;
+        };
+
+        Job jobs_[MAX_JOBS] = {};
+        uint8_t job_count_ = 0;
+};
@@ -0,0 +1,50 @@
+#include "serial_protocol.h"
+
+SerialProtocol::SerialProtocol(Stream& stream) : stream_(stream) {}
+
+bool SerialProtocol::receive() {
+    while (stream_.available() > 0) {
+        if (decoder_.feed(stream_.read())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SerialProtocol::sendAck(uint8_t sequence, AckStatus status) {
+    uint8_t body[PROTOCOL_MAX_BODY];
+    size_t length = encodeAck({sequence, status}, body, sizeof(body));
+    send(MessageId::ACK, body, length);
+}
+
+void SerialProtocol::sendState(const StateMessage& state) {
+    uint8_t body[PROTOCOL_MAX_BODY];
+    size_t length = encodeState(state, body, sizeof(body));
+    send(MessageId::STATE, body, length);
+}
+
+void SerialProtocol::sendTelemetry(const TelemetryMessage& telemetry) {
+    uint8_t body[PROTOCOL_MAX_BODY];
+    size_t length = encodeTelemetry(telemetry, body, sizeof(body));
+    send(MessageId::TELEMETRY, body, length);
+}
+
+void SerialProtocol::sendLatency(const LatencyMessage& latency) {
+    uint8_t body[PROTOCOL_MAX_BODY];
+    size_t length = encodeLatency(latency, body, sizeof(body));
+    send(MessageId::LATENCY, body, length);
+}
+
+void SerialProtocol::sendRecording(const RecordingMessage& recording) {
+    uint8_t body[PROTOCOL_MAX_BODY];
+    size_t length = encodeRecording(recording, body, sizeof(body));
+    send(MessageId::RECORDING, body, length);
+}
+
+void SerialProtocol::send(MessageId id, const uint8_t* body, size_t body_length) {
+    uint8_t frame[PROTOCOL_MAX_FRAME];
+    size_t length = encodeFrame(id, sequence_++, body, body_length, frame, sizeof(frame));
+    if (length > 0) {
+        stream_.write(frame, length);
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "protocol.h"
+
+// Device end of the framed host protocol (see protocol.h) on a Stream, normally uart_serial. Only one task may use
+// an instance. Each frame goes out in a single write(), so it can't be split by text printed from other tasks.
+class SerialProtocol {
+    public:
+        SerialProtocol(Stream& stream);
+
+        // Consumes available input until a complete message has been received (returns true; see getMessage())
+        // or the input is exhausted
+        bool receive();
+        const FrameDecoder& getMessage() const { return decoder_; }
+
+        void sendAck(uint8_t sequence, AckStatus status);
+        void sendState(const StateMessage& state);
+        void sendTelemetry(const TelemetryMessage& telemetry);
+        void sendLatency(const LatencyMessage& latency);
+        void sendRecording(const RecordingMessage& recording);
+
+    private:
+        Stream& stream_;
+        FrameDecoder decoder_;
+        uint8_t sequence_ = 0;
+
+        void send(MessageId id, const uint8_t* body, size_t body_length);
+};
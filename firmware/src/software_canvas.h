@@ -0,0 +1,387 @@
+#pragma once
+
+// Host-side (non-Arduino) stand-in for the subset of TFT_eSprite used by the display renderer. Pixels are kept
+// in memory as TFT_eSprite keeps them (RGB565, or 4-bit palette indices packed two to a byte) and can be read back
+// as RGB565 with readPixel(), which makes it possible to run the drawing code on Linux (e.g. for comparing rendered
+// frames against known-good images, see host/tools/render.cpp) without a display attached.
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
+#ifndef _GFXFONT_H_
+#define _GFXFONT_H_
+// Adafruit GFX font format, as used by TFT_eSPI's free fonts
+typedef struct {
+    uint16_t bitmapOffset;
+    uint8_t width;
+    uint8_t height;
+    uint8_t xAdvance;
+    int8_t xOffset;
+    int8_t yOffset;
+} GFXglyph;
+
+typedef struct {
+    uint8_t* bitmap;
+    GFXglyph* glyph;
+    uint8_t first;
+    uint8_t last;
+    uint8_t yAdvance;
+} GFXfont;
+#endif
+
+#ifndef TFT_BLACK
+#define TFT_BLACK       0x0000
+#define TFT_WHITE       0xFFFF
+#define TFT_DARKGREY    0x7BEF
+#define TFT_DARKGREEN   0x03E0
+#define TFT_RED         0xF800
+#define TFT_PURPLE      0x780F
+#endif
+
+#ifndef TL_DATUM
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+#define ML_DATUM 3
+#define MC_DATUM 4
+#define CC_DATUM 4
+#define MR_DATUM 5
+#define BL_DATUM 6
+#define BC_DATUM 7
+#define BR_DATUM 8
+#endif
+
+class SoftwareCanvas {
+    public:
+        SoftwareCanvas() {}
+
+        // 16 (RGB565) or 4 (palette indices); takes effect on the next createSprite()
+        void setColorDepth(int8_t depth) {
+            color_depth_ = depth == 4 ? 4 : 16;
+        }
+
+        void* createSprite(int16_t width, int16_t height) {
+            width_ = width;
+            height_ = height;
+            if (color_depth_ == 4) {
+                pixels_.clear();
+                indices_.assign(((size_t)width * height + 1) / 2, 0);
+            } else {
+                indices_.clear();
+                pixels_.assign((size_t)width * height, TFT_BLACK);
+            }
+            line_.assign(width, 0);
+            return getFrameBuffer();
+        }
+
+        void deleteSprite() {
+            pixels_.clear();
+            indices_.clear();
+            line_.clear();
+            width_ = 0;
+            height_ = 0;
+        }
+
+        // For 4-bit sprites: the RGB565 color of each index
+        void createPalette(const uint16_t* palette, uint8_t colors = 16) {
+            memcpy(palette_, palette, std::min<uint8_t>(colors, 16) * sizeof(uint16_t));
+        }
+
+        // Memory taken by the pixels
+        size_t getFrameBytes() const {
+            return color_depth_ == 4 ? indices_.size() : pixels_.size() * sizeof(uint16_t);
+        }
+
+        int16_t width() const { return width_; }
+        int16_t height() const { return height_; }
+
+        uint16_t color565(uint8_t r, uint8_t g, uint8_t b) const {
+            return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+        }
+
+        uint16_t readPixel(int32_t x, int32_t y) const {
+            if (x < 0 || y < 0 || x >= width_ || y >= height_) {
+                return 0;
+            }
+            if (color_depth_ == 4) {
+                return palette_[readIndex(y * width_ + x)];
+            }
+            return pixels_[y * width_ + x];
+        }
+
+        void drawPixel(int32_t x, int32_t y, uint32_t color) {
+            if (x < clip_x0_ || y < clip_y0_ || x >= clip_x1_ || y >= clip_y1_ || x >= width_ || y >= height_) {
+                return;
+            }
+            if (color_depth_ == 4) {
+                // Even pixels in the high nibble, as in TFT_eSprite
+                size_t i = y * width_ + x;
+                uint8_t& pair = indices_[i / 2];
+                pair = (i & 1) ? (pair & 0xF0) | (color & 0x0F) : (pair & 0x0F) | ((color & 0x0F) << 4);
+            } else {
+                pixels_[y * width_ + x] = (uint16_t)color;
+            }
+            pixels_touched_++;
+        }
+
+        void fillSprite(uint32_t color) {
+            fillRect(0, 0, width_, height_, color);
+        }
+
+        void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+            for (int32_t j = y; j < y + h; j++) {
+                drawFastHLine(x, j, w, color);
+            }
+        }
+
+        void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) {
+            for (int32_t i = x; i < x + w; i++) {
+                drawPixel(i, y, color);
+            }
+        }
+
+        void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) {
+            for (int32_t j = y; j < y + h; j++) {
+                drawPixel(x, j, color);
+            }
+        }
+
+        void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color) {
+            int32_t dx = abs(x1 - x0);
+            int32_t dy = -abs(y1 - y0);
+            int32_t sx = x0 < x1 ? 1 : -1;
+            int32_t sy = y0 < y1 ? 1 : -1;
+            int32_t err = dx + dy;
+            while (true) {
+                drawPixel(x0, y0, color);
+                if (x0 == x1 && y0 == y1) {
+                    break;
+                }
+                int32_t e2 = 2 * err;
+                if (e2 >= dy) {
+                    err += dy;
+                    x0 += sx;
+                }
+                if (e2 <= dx) {
+                    err += dx;
+                    y0 += sy;
+                }
+            }
+        }
+
+        void drawCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color) {
+            int32_t x = r;
+            int32_t y = 0;
+            int32_t err = 1 - r;
+            while (x >= y) {
+                drawPixel(x0 + x, y0 + y, color);
+                drawPixel(x0 + y, y0 + x, color);
+                drawPixel(x0 - y, y0 + x, color);
+                drawPixel(x0 - x, y0 + y, color);
+                drawPixel(x0 - x, y0 - y, color);
+                drawPixel(x0 - y, y0 - x, color);
+                drawPixel(x0 + y, y0 - x, color);
+                drawPixel(x0 + x, y0 - y, color);
+                y++;
+                if (err < 0) {
+                    err += 2 * y + 1;
+                } else {
+                    x--;
+                    err += 2 * (y - x) + 1;
+                }
+            }
+        }
+
+        void fillCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color) {
+            for (int32_t dy = -r; dy <= r; dy++) {
+                int32_t dx = 0;
+                while ((dx + 1) * (dx + 1) + dy * dy <= r * r) {
+                    dx++;
+                }
+                drawFastHLine(x0 - dx, y0 + dy, 2 * dx + 1, color);
+            }
+        }
+
+        void setViewport(int32_t x, int32_t y, int32_t w, int32_t h, bool vp_datum = true) {
+            // Only clipping is modeled (i.e. vp_datum == false)
+            (void)vp_datum;
+            clip_x0_ = std::max<int32_t>(0, x);
+            clip_y0_ = std::max<int32_t>(0, y);
+            clip_x1_ = std::min<int32_t>(width_, x + w);
+            clip_y1_ = std::min<int32_t>(height_, y + h);
+        }
+
+        void resetViewport() {
+            clip_x0_ = 0;
+            clip_y0_ = 0;
+            clip_x1_ = INT16_MAX;
+            clip_y1_ = INT16_MAX;
+        }
+
+        void setTextColor(uint16_t color) {
+            text_color_ = color;
+        }
+
+        void setTextColor(uint16_t color, uint16_t background) {
+            // Like TFT_eSPI, free fonts are always drawn with a transparent background
+            (void)background;
+            text_color_ = color;
+        }
+
+        void setTextDatum(uint8_t datum) {
+            text_datum_ = datum;
+        }
+
+        void setFreeFont(const GFXfont* font) {
+            font_ = font;
+            glyph_ab_ = 0;
+            glyph_bb_ = 0;
+            if (font_ == nullptr) {
+                return;
+            }
+            for (uint16_t c = 0; c <= font_->last - font_->first; c++) {
+                const GFXglyph& glyph = font_->glyph[c];
+                int8_t ab = -glyph.yOffset;
+                int8_t bb = glyph.height - ab;
+                glyph_ab_ = std::max(glyph_ab_, ab);
+                glyph_bb_ = std::max(glyph_bb_, bb);
+            }
+        }
+
+        int16_t fontHeight(int16_t font = 1) const {
+            (void)font;
+            return font_ == nullptr ? 0 : font_->yAdvance;
+        }
+
+        int16_t textWidth(const char* string, uint8_t font = 1) const {
+            (void)font;
+            if (font_ == nullptr) {
+                return 0;
+            }
+            int16_t width = 0;
+            for (const char* c = string; *c != '\0'; c++) {
+                if ((uint8_t)*c >= font_->first && (uint8_t)*c <= font_->last) {
+                    width += font_->glyph[(uint8_t)*c - font_->first].xAdvance;
+                }
+            }
+            return width;
+        }
+
+        int16_t drawString(const char* string, int32_t x, int32_t y, uint8_t font) {
+            if (font_ == nullptr) {
+                return 0;
+            }
+            int16_t width = textWidth(string, font);
+
+            // Horizontal alignment
+            switch (text_datum_ % 3) {
+                case 1: x -= width / 2; break;
+                case 2: x -= width; break;
+            }
+            // Vertical alignment; y ends up as the baseline. Like TFT_eSPI, only the ascent is considered when
+            // centering free fonts.
+            switch (text_datum_ / 3) {
+                case 0: y += glyph_ab_; break;
+                case 1: y += glyph_ab_ - glyph_ab_ / 2; break;
+                case 2: y -= glyph_bb_; break;
+            }
+
+            for (const char* c = string; *c != '\0'; c++) {
+                x += drawGlyph((uint8_t)*c, x, y);
+            }
+            return width;
+        }
+
+        void pushSprite(int32_t x, int32_t y) {
+            pushSprite(x, y, 0, 0, width_, height_);
+        }
+
+        // There's no panel, but the rows are still read out as RGB565 a line at a time, as TFT_eSprite does to send
+        // them (expanding palette indices in 4-bit mode), so pushes cost about what they do in CPU time
+        bool pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh) {
+            (void)tx;
+            (void)ty;
+            int32_t x0 = std::max<int32_t>(sx, 0);
+            int32_t x1 = std::min<int32_t>(sx + sw, width_);
+            for (int32_t y = std::max<int32_t>(sy, 0); y < std::min<int32_t>(sy + sh, height_); y++) {
+                if (color_depth_ == 4) {
+                    for (int32_t x = x0; x < x1; x++) {
+                        line_[x - x0] = palette_[readIndex(y * width_ + x)];
+                    }
+                } else if (x1 > x0) {
+                    memcpy(line_.data(), &pixels_[y * width_ + x0], (x1 - x0) * sizeof(uint16_t));
+                }
+                pixels_pushed_ += std::max<int32_t>(x1 - x0, 0);
+            }
+            frames_pushed_++;
+            return true;
+        }
+
+        uint32_t getPixelsTouched() const { return pixels_touched_; }
+        uint32_t getFramesPushed() const { return frames_pushed_; }
+        uint32_t getPixelsPushed() const { return pixels_pushed_; }
+
+        void resetStats() {
+            pixels_touched_ = 0;
+            frames_pushed_ = 0;
+            pixels_pushed_ = 0;
+        }
+
+    private:
+        int16_t width_ = 0;
+        int16_t height_ = 0;
+        int8_t color_depth_ = 16;
+        std::vector<uint16_t> pixels_;
+        std::vector<uint8_t> indices_;
+        uint16_t palette_[16] = {};
+        // One row, as read out by pushSprite()
+        std::vector<uint16_t> line_;
+
+        int32_t clip_x0_ = 0;
+        int32_t clip_y0_ = 0;
+        int32_t clip_x1_ = INT16_MAX;
+        int32_t clip_y1_ = INT16_MAX;
+
+        const GFXfont* font_ = nullptr;
+        int8_t glyph_ab_ = 0;
+        int8_t glyph_bb_ = 0;
+        uint16_t text_color_ = TFT_WHITE;
+        uint8_t text_datum_ = TL_DATUM;
+
+        uint32_t pixels_touched_ = 0;
+        uint32_t frames_pushed_ = 0;
+        uint32_t pixels_pushed_ = 0;
+
+        void* getFrameBuffer() {
+            return color_depth_ == 4 ? (void*)indices_.data() : (void*)pixels_.data();
+        }
+
+        uint8_t readIndex(size_t i) const {
+            return (i & 1) ? indices_[i / 2] & 0x0F : indices_[i / 2] >> 4;
+        }
+
+        // Draws a single glyph with its origin on the baseline at (x, y); returns the x advance
+        int16_t drawGlyph(uint8_t c, int32_t x, int32_t y) {
+            if (c < font_->first || c > font_->last) {
+                return 0;
+            }
+            const GFXglyph& glyph = font_->glyph[c - font_->first];
+            const uint8_t* bitmap = font_->bitmap + glyph.bitmapOffset;
+            uint32_t bit = 0;
+            for (uint8_t row = 0; row < glyph.height; row++) {
+                for (uint8_t col = 0; col < glyph.width; col++, bit++) {
+                    if (bitmap[bit >> 3] & (0x80 >> (bit & 7))) {
+                        drawPixel(x + glyph.xOffset + col, y + glyph.yOffset + row, text_color_);
+                    }
+                }
+            }
+            return glyph.xAdvance;
+        }
+};
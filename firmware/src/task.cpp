@@ -0,0 +1,34 @@
+#include "logger.h"
+#include "task.h"
+
+static const uint8_t MAX_TASK_STACKS = 8;
+
+struct TaskStack {
+    const char* name;
+    TaskHandle_t handle;
+    uint32_t size;
+};
+
+static TaskStack task_stacks[MAX_TASK_STACKS];
+static uint8_t task_stack_count = 0;
+static portMUX_TYPE task_stacks_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void registerTaskStack(const char* name, TaskHandle_t handle, uint32_t stack_size) {
+    portENTER_CRITICAL(&task_stacks_mux);
+    if (task_stack_count < MAX_TASK_STACKS) {
+        task_stacks[task_stack_count++] = {name, handle, stack_size};
+    }
+    portEXIT_CRITICAL(&task_stacks_mux);
+}
+
+void logTaskStacks() {
+    portENTER_CRITICAL(&task_stacks_mux);
+    uint8_t count = task_stack_count;
+    portEXIT_CRITICAL(&task_stacks_mux);
+
+    for (uint8_t i = 0; i < count; i++) {
+        const TaskStack& stack = task_stacks[i];
+        uint32_t free_bytes = uxTaskGetStackHighWaterMark(stack.handle);
+        LOG_INFO("Stack %s: %u of %u bytes used", stack.name, stack.size - free_bytes, stack.size);
+    }
+}
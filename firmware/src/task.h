@@ -17,16 +17,26 @@
 
 #include<Arduino.h>
 
+// Records a task's stack for logTaskStacks(); called by Task<T>::begin()
+void registerTaskStack(const char* name, TaskHandle_t handle, uint32_t stack_size);
+// Logs how much of its stack each task has used at most so far
+void logTaskStacks();
+
 // Static polymorphic abstract base class for a FreeRTOS task using CRTP pattern. Concrete implementations
 // should implement a run() method.
 // Inspired by https://fjrg76.wordpress.com/2018/05/23/objectifying-task-creation-in-freertos-ii/
-template<class T>
+//
+// The stack (STACK_SIZE bytes, as ESP-IDF's FreeRTOS counts stack depth in bytes) and task control block are part
+// of the object, so creating the task doesn't touch the heap.
+template<class T, uint32_t STACK_SIZE, UBaseType_t PRIORITY>
 class Task {
+    static_assert(configSUPPORT_STATIC_ALLOCATION == 1, "Tasks are created from static memory, which FreeRTOS must support");
+    static_assert(STACK_SIZE >= configMINIMAL_STACK_SIZE, "Task stack is below the FreeRTOS minimum");
+    static_assert(PRIORITY < configMAX_PRIORITIES, "Task priority is out of range");
+
     public:
-        Task(const char* name, uint32_t stackDepth, UBaseType_t priority, const BaseType_t coreId = tskNO_AFFINITY) : 
+        Task(const char* name, const BaseType_t coreId = tskNO_AFFINITY) :
                 name { name },
-                stackDepth {stackDepth},
-                priority { priority },
                 coreId { coreId }
         {}
         virtual ~Task() {};
@@ -35,20 +45,28 @@ class Task {
             return taskHandle;
         }
 
+        // Least free stack seen so far, in bytes
+        uint32_t getStackHighWaterMark() {
+            return uxTaskGetStackHighWaterMark(taskHandle);
+        }
+
         void begin() {
-            BaseType_t result = xTaskCreatePinnedToCore(taskFunction, name, stackDepth, this, priority, &taskHandle, coreId);
-            assert("Failed to create task" && result == pdPASS);
+            taskHandle = xTaskCreateStaticPinnedToCore(taskFunction, name, STACK_SIZE, static_cast<T*>(this), PRIORITY, stack, &taskBuffer, coreId);
+            assert("Failed to create task" && taskHandle != nullptr);
+            registerTaskStack(name, taskHandle, STACK_SIZE);
         }
 
     private:
+        // params is the T (not just this base, which needn't be at the same address if T has others)
         static void taskFunction(void* params) {
             T* t = static_cast<T*>(params);
             t->run();
         }
 
         const char* name;
-        uint32_t stackDepth;
-        UBaseType_t priority;
-        TaskHandle_t taskHandle;
+        TaskHandle_t taskHandle = nullptr;
         const BaseType_t coreId;
+
+        alignas(portBYTE_ALIGNMENT) StackType_t stack[STACK_SIZE / sizeof(StackType_t)];
+        StaticTask_t taskBuffer;
 };
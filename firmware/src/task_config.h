@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Priorities and core placement of the firmware's tasks, in one place so the scheduling scheme can be read (and
+// changed) as a whole. Any of these can be overridden per build env, e.g. -DSK_DISPLAY_TASK_CORE=1.
+//
+// The motor loop is the only hard real-time work, so it runs at the highest application priority, alone on the APP
+// core (1), which the Arduino loop task leaves once setup() finishes. ESP-IDF's own tasks (esp_timer, IPC, WiFi) run
+// at much higher priorities, mostly on the PRO core (0), with everything else: the UART event task (which only hands
+// input over) above interface (short, event-driven bursts), above display and LEDs (long frames that can always be
+// dropped), and log draining below them all.
+
+#ifndef SK_MOTOR_TASK_PRIORITY
+#define SK_MOTOR_TASK_PRIORITY 4
+#endif
+#ifndef SK_UART_TASK_PRIORITY
+#define SK_UART_TASK_PRIORITY 3
+#endif
+#ifndef SK_INTERFACE_TASK_PRIORITY
+#define SK_INTERFACE_TASK_PRIORITY 2
+#endif
+#ifndef SK_DISPLAY_TASK_PRIORITY
+#define SK_DISPLAY_TASK_PRIORITY 1
+#endif
+#ifndef SK_LED_TASK_PRIORITY
+#define SK_LED_TASK_PRIORITY 1
+#endif
+#ifndef SK_LOGGER_TASK_PRIORITY
+#define SK_LOGGER_TASK_PRIORITY 0
+#endif
+
+#ifndef SK_MOTOR_TASK_CORE
+#define SK_MOTOR_TASK_CORE 1
+#endif
+#ifndef SK_UART_TASK_CORE
+#define SK_UART_TASK_CORE 0
+#endif
+#ifndef SK_INTERFACE_TASK_CORE
+#define SK_INTERFACE_TASK_CORE 0
+#endif
+#ifndef SK_DISPLAY_TASK_CORE
+#define SK_DISPLAY_TASK_CORE 0
+#endif
+#ifndef SK_LED_TASK_CORE
+#define SK_LED_TASK_CORE 0
+#endif
+#ifndef SK_LOGGER_TASK_CORE
+#define SK_LOGGER_TASK_CORE 0
+#endif
+
+static const UBaseType_t MOTOR_TASK_PRIORITY = SK_MOTOR_TASK_PRIORITY;
+static const UBaseType_t UART_TASK_PRIORITY = SK_UART_TASK_PRIORITY;
+static const UBaseType_t INTERFACE_TASK_PRIORITY = SK_INTERFACE_TASK_PRIORITY;
+static const UBaseType_t DISPLAY_TASK_PRIORITY = SK_DISPLAY_TASK_PRIORITY;
+static const UBaseType_t LED_TASK_PRIORITY = SK_LED_TASK_PRIORITY;
+static const UBaseType_t LOGGER_TASK_PRIORITY = SK_LOGGER_TASK_PRIORITY;
+
+static const uint8_t MOTOR_TASK_CORE = SK_MOTOR_TASK_CORE;
+static const uint8_t UART_TASK_CORE = SK_UART_TASK_CORE;
+static const uint8_t INTERFACE_TASK_CORE = SK_INTERFACE_TASK_CORE;
+static const uint8_t DISPLAY_TASK_CORE = SK_DISPLAY_TASK_CORE;
+static const uint8_t LED_TASK_CORE = SK_LED_TASK_CORE;
+static const uint8_t LOGGER_TASK_CORE = SK_LOGGER_TASK_CORE;
+
+// Period of the motor control loop: one tick, i.e. 1 ms at the Arduino core's 1 kHz tick rate. Iterations start on
+// a fixed schedule (see MotorTask::run), so time spent in the loop or preempted doesn't push the next one back.
+static const TickType_t MOTOR_LOOP_PERIOD_TICKS = 1;
@@ -1,22 +1,50 @@
+#include "flight_recorder.h"
+#include "logger.h"
+#include "profiler.h"
 #include "tlv_sensor.h"
 
 static const float ALPHA = 1;
 
 TlvSensor::TlvSensor() {}
 
-void TlvSensor::init(TwoWire* wire, bool invert) {
-  wire_ = wire;
+void TlvSensor::init(I2CBus* bus, bool invert) {
+  bus_ = bus;
+  bus_device_ = bus->registerDevice("TLV493D", I2CPriority::HIGH_PRIORITY);
   invert_ = invert;
-  tlv_.begin(*wire);
+  while (!configure()) {
+    delay(1);
+  }
+}
+
+bool TlvSensor::configure() {
+  I2CTransaction transaction(*bus_, bus_device_);
+  if (!transaction.isAcquired()) {
+    return false;
+  }
+  tlv_.begin(transaction.getWire());
   tlv_.setAccessMode(Tlv493d::AccessMode_e::MASTERCONTROLLEDMODE);
   tlv_.disableInterrupt();
   tlv_.disableTemp();
+  return true;
 }
 
 float TlvSensor::getSensorAngle() {
+    ProfileScope scope(ProfileSection::SENSOR_READ);
     uint32_t now = micros();
     if (now - last_update_ > 50) {
-      tlv_.updateData();
+      {
+        I2CTransaction transaction(*bus_, bus_device_);
+        if (!transaction.isAcquired()) {
+          // Bus is busy; keep using the previous reading rather than stalling the motor loop
+          return lastAngle();
+        }
+        if (tlv_.updateData() != TLV493D_NO_ERROR) {
+          transaction.setError();
+          FlightRecorder::event(FlightRecordType::SENSOR_ERROR, (uint8_t)FlightSensorError::READ_FAILED);
+        } else {
+          last_valid_micros_ = now;
+        }
+      }
       frame_counts_[cur_frame_count_index_] = tlv_.getExpectedFrameCount();
       cur_frame_count_index_++;
       if (cur_frame_count_index_ >= sizeof(frame_counts_)) {
@@ -35,14 +63,19 @@ float TlvSensor::getSensorAngle() {
         }
       }
       if (all_same) {
-        Serial.println("LOCKED!");
-        init(wire_, invert_);
+        LOG_WARNING("LOCKED!");
+        FlightRecorder::event(FlightRecordType::SENSOR_ERROR, (uint8_t)FlightSensorError::LOCKED);
+        configure();
         // Force unique frame counts to avoid reset loop
         for (uint8_t i = 1; i < sizeof(frame_counts_); i++) {
           frame_counts_[i] = i;
         }
       }
     }
+    return lastAngle();
+}
+
+float TlvSensor::lastAngle() {
     float rad = (invert_ ? -1 : 1) * atan2f(y_, x_);
     if (rad < 0) {
         rad += 2*PI;
@@ -3,12 +3,14 @@
 #include <SimpleFOC.h>
 #include <Tlv493d.h>
 
+#include "i2c_bus.h"
+
 class TlvSensor : public Sensor {
     public:
         TlvSensor();
 
         // initialize the sensor hardware
-        void init(TwoWire* wire, bool invert);
+        void init(I2CBus* bus, bool invert);
 
         // Get current shaft angle from the sensor hardware, and 
         // return it as a float in radians, in the range 0 to 2PI.
@@ -16,14 +18,23 @@ class TlvSensor : public Sensor {
         //    Calling this method directly does not update the base-class internal fields.
         //    Use update() when calling from outside code.
         float getSensorAngle();
+
+        // micros() of the last reading that completed without a bus error
+        uint32_t getLastValidMicros() const { return last_valid_micros_; }
     private:
         Tlv493d tlv_ = Tlv493d();
         float x_;
         float y_;
         uint32_t last_update_;
-        TwoWire* wire_;
+        uint32_t last_valid_micros_ = 0;
+        I2CBus* bus_;
+        uint8_t bus_device_;
         bool invert_;
 
         uint8_t frame_counts_[3] = {};
         uint8_t cur_frame_count_index_ = 0;
+
+        // Returns false if the bus couldn't be acquired
+        bool configure();
+        float lastAngle();
 };
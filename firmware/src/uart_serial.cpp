@@ -0,0 +1,83 @@
+#include "uart_serial.h"
+
+// The driver needs more than the 128 byte hardware FIFO. This holds about 90 ms of input at 115200 baud, far longer
+// than the interface task takes to get to it.
+static const int UART_RX_BUFFER_SIZE = 1024;
+// Room for a burst of log lines without blocking the tasks writing them
+static const int UART_TX_BUFFER_SIZE = 1024;
+static const int UART_EVENT_QUEUE_LENGTH = 8;
+
+UartSerial uart_serial(UART_NUM_0, UART_TASK_CORE);
+
+UartSerial::UartSerial(uart_port_t port, const uint8_t task_core) : Task("Uart", task_core), port_(port), notify_task_(nullptr) {}
+
+void UartSerial::begin(uint32_t baud) {
+    uart_config_t config = {};
+    config.baud_rate = baud;
+    config.data_bits = UART_DATA_8_BITS;
+    config.parity = UART_PARITY_DISABLE;
+    config.stop_bits = UART_STOP_BITS_1;
+    config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    esp_err_t result = uart_param_config(port_, &config);
+    assert("Failed to configure UART" && result == ESP_OK);
+    result = uart_driver_install(port_, UART_RX_BUFFER_SIZE, UART_TX_BUFFER_SIZE, UART_EVENT_QUEUE_LENGTH, &events_, 0);
+    assert("Failed to install UART driver" && result == ESP_OK);
+    Task::begin();
+}
+
+void UartSerial::notifyOnReceive(TaskHandle_t task, uint32_t notify_bits) {
+    notify_bits_ = notify_bits;
+    notify_task_.store(task, std::memory_order_release);
+    xTaskNotify(task, notify_bits, eSetBits);
+}
+
+void UartSerial::run() {
+    while (1) {
+        uart_event_t event;
+        if (xQueueReceive(events_, &event, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        // Data, or the buffer or FIFO filling up: either way there's input to read, and reading it is what lets the
+        // driver take more
+        TaskHandle_t task = notify_task_.load(std::memory_order_acquire);
+        if (task != nullptr) {
+            xTaskNotify(task, notify_bits_, eSetBits);
+        }
+    }
+}
+
+int UartSerial::available() {
+    size_t length = 0;
+    uart_get_buffered_data_len(port_, &length);
+    return length + (peeked_ >= 0 ? 1 : 0);
+}
+
+int UartSerial::read() {
+    if (peeked_ >= 0) {
+        int c = peeked_;
+        peeked_ = -1;
+        return c;
+    }
+    uint8_t c;
+    return uart_read_bytes(port_, &c, 1, 0) == 1 ? c : -1;
+}
+
+int UartSerial::peek() {
+    if (peeked_ < 0) {
+        peeked_ = read();
+    }
+    return peeked_;
+}
+
+void UartSerial::flush() {
+    uart_wait_tx_done(port_, portMAX_DELAY);
+}
+
+size_t UartSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t UartSerial::write(const uint8_t* buffer, size_t size) {
+    int written = uart_write_bytes(port_, (const char*)buffer, size);
+    return written < 0 ? 0 : written;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <driver/uart.h>
+
+#include "task.h"
+#include "task_config.h"
+
+static const uint32_t UART_TASK_STACK_SIZE = 2048;
+
+// The serial port, on ESP-IDF's UART driver instead of the Arduino core's Serial, which can only be polled. The driver
+// reports what it receives on an event queue; this task waits on it and notifies the reading task (setting
+// notify_bits in its notification value), so the reader sleeps until input arrives. A write() goes into the driver's
+// TX buffer under its TX lock, so a frame written in one call isn't split by text written from other tasks.
+//
+// Any task may write; only one may read.
+class UartSerial : public Task<UartSerial, UART_TASK_STACK_SIZE, UART_TASK_PRIORITY>, public Stream {
+    template<class, uint32_t, UBaseType_t> friend class Task; // Allow base Task to invoke protected run()
+
+    public:
+        UartSerial(uart_port_t port, const uint8_t task_core);
+
+        // Installs the driver and starts the task. Call before anything uses the port.
+        void begin(uint32_t baud);
+
+        // From the reading task: notifies it whenever input arrives from now on, and once right away in case some
+        // arrived before
+        void notifyOnReceive(TaskHandle_t task, uint32_t notify_bits);
+
+        int available() override;
+        int read() override;
+        int peek() override;
+        // Waits until everything written has gone out
+        void flush() override;
+
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t* buffer, size_t size) override;
+        using Print::write;
+
+    protected:
+        void run();
+
+    private:
+        const uart_port_t port_;
+        QueueHandle_t events_ = nullptr;
+
+        // Bits first, then the task (released), so the event task never sees one without the other
+        uint32_t notify_bits_ = 0;
+        std::atomic<TaskHandle_t> notify_task_;
+
+        // A byte peek() has taken from the driver, or -1
+        int peeked_ = -1;
+};
+
+// UART0, on the USB serial converter: the host protocol, logs and calibration prompts
+extern UartSerial uart_serial;
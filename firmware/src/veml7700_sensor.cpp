@@ -0,0 +1,138 @@
+#if (defined(SK_ALS) && (SK_ALS >0))
+#include "veml7700_sensor.h"
+
+struct AlsSetting {
+    uint8_t gain;
+    uint8_t integration_time;
+    uint16_t integration_time_millis;
+    // Lux per raw count
+    float resolution;
+};
+
+// From most to least sensitive. Resolution is 0.0036 lux/count at gain 2 with 800ms integration, and scales
+// linearly with both gain and integration time.
+static const AlsSetting SETTINGS[] = {
+    {VEML7700_GAIN_2, VEML7700_IT_800MS, 800, 0.0036},
+    {VEML7700_GAIN_2, VEML7700_IT_400MS, 400, 0.0072},
+    {VEML7700_GAIN_2, VEML7700_IT_200MS, 200, 0.0144},
+    {VEML7700_GAIN_2, VEML7700_IT_100MS, 100, 0.0288},
+    {VEML7700_GAIN_1, VEML7700_IT_100MS, 100, 0.0576},
+    {VEML7700_GAIN_1_4, VEML7700_IT_100MS, 100, 0.2304},
+    {VEML7700_GAIN_1_8, VEML7700_IT_100MS, 100, 0.4608},
+    {VEML7700_GAIN_1_8, VEML7700_IT_50MS, 50, 0.9216},
+    {VEML7700_GAIN_1_8, VEML7700_IT_25MS, 25, 1.8432},
+};
+static const uint8_t SETTING_COUNT = sizeof(SETTINGS) / sizeof(SETTINGS[0]);
+static const uint8_t INITIAL_SETTING = 4;
+
+// Step to a less sensitive setting above this count (response becomes non-linear towards saturation), and to a
+// more sensitive one below the low count (too coarse)
+static const uint16_t RAW_HIGH = 10000;
+static const uint16_t RAW_LOW = 100;
+
+// Shorter integration times still only get read this often, which bounds the I2C traffic in bright light
+static const uint32_t MIN_READ_PERIOD_MILLIS = 100;
+// Margin after the nominal integration time, since the sensor's internal oscillator isn't exact
+static const uint32_t READ_MARGIN_MILLIS = 10;
+
+static const float FILTER_TIME_CONSTANT_MILLIS = 2000;
+
+VEML7700Sensor::VEML7700Sensor() : setting_index_(INITIAL_SETTING) {}
+
+bool VEML7700Sensor::begin(I2CBus& bus) {
+    bus_ = &bus;
+    bus_device_ = bus.registerDevice("VEML7700", I2CPriority::LOW_PRIORITY);
+
+    I2CTransaction transaction(bus, bus_device_);
+    if (!transaction.isAcquired()) {
+        return false;
+    }
+    if (!veml_.begin(&transaction.getWire())) {
+        transaction.setError();
+        return false;
+    }
+    applySetting(INITIAL_SETTING);
+    return true;
+}
+
+bool VEML7700Sensor::update() {
+    uint32_t now = millis();
+    if (now - period_start_millis_ < getReadPeriodMillis()) {
+        return false;
+    }
+
+    I2CTransaction transaction(*bus_, bus_device_);
+    if (!transaction.isAcquired()) {
+        // Timed out waiting behind higher priority devices; try again next period
+        period_start_millis_ = now;
+        return false;
+    }
+    uint16_t raw = veml_.readALS();
+    read_count_++;
+    // readALS() can't report failure itself (it returns the truncated -1, which is also a saturated reading)
+    if (transaction.getWire().lastError() != I2C_ERROR_OK) {
+        // Keep the last reading and try again next period
+        transaction.setError();
+        period_start_millis_ = now;
+        return false;
+    }
+    if (discard_next_) {
+        discard_next_ = false;
+        period_start_millis_ = now;
+        return false;
+    }
+
+    const AlsSetting& setting = SETTINGS[setting_index_];
+    float lux = raw * setting.resolution;
+    // Non-linearity correction from the VEML7700 application note, needed for the low gain settings
+    if (setting.gain == VEML7700_GAIN_1_4 || setting.gain == VEML7700_GAIN_1_8) {
+        lux = (((6.0135e-13 * lux - 9.3924e-9) * lux + 8.1488e-5) * lux + 1.0023) * lux;
+    }
+
+    if (raw > RAW_HIGH && setting_index_ < SETTING_COUNT - 1) {
+        applySetting(setting_index_ + 1);
+    } else if (raw < RAW_LOW && setting_index_ > 0) {
+        applySetting(setting_index_ - 1);
+    } else {
+        period_start_millis_ = now;
+    }
+
+    if (timestamp_millis_ == 0) {
+        lux_ = lux;
+    } else {
+        float alpha = min(1.f, (now - timestamp_millis_) / FILTER_TIME_CONSTANT_MILLIS);
+        lux_ = lux * alpha + lux_ * (1 - alpha);
+    }
+    timestamp_millis_ = now;
+    return true;
+}
+
+float VEML7700Sensor::getLux() {
+    return lux_;
+}
+
+uint32_t VEML7700Sensor::getTimestampMillis() {
+    return timestamp_millis_;
+}
+
+uint32_t VEML7700Sensor::getNextReadMillis() {
+    return period_start_millis_ + getReadPeriodMillis();
+}
+
+uint32_t VEML7700Sensor::getReadCount() {
+    return read_count_;
+}
+
+uint32_t VEML7700Sensor::getReadPeriodMillis() {
+    return max((uint32_t)SETTINGS[setting_index_].integration_time_millis, MIN_READ_PERIOD_MILLIS) + READ_MARGIN_MILLIS;
+}
+
+void VEML7700Sensor::applySetting(uint8_t index) {
+    setting_index_ = index;
+    veml_.setGain(SETTINGS[index].gain);
+    veml_.setIntegrationTime(SETTINGS[index].integration_time);
+    period_start_millis_ = millis();
+    discard_next_ = true;
+}
+
+#endif
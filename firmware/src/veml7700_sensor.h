@@ -0,0 +1,49 @@
+#pragma once
+
+#if (defined(SK_ALS) && (SK_ALS >0))
+
+#include <Adafruit_VEML7700.h>
+#include <Arduino.h>
+
+#include "i2c_bus.h"
+
+// Non-blocking, auto-ranging ambient light sensor. The ALS register is only read once per integration period
+// (and never more often than every 100ms), gain and integration time are stepped up or down to keep the raw
+// count in a useful range, and the result is published as a low-pass filtered lux value with a timestamp.
+class VEML7700Sensor {
+    public:
+        VEML7700Sensor();
+
+        bool begin(I2CBus& bus);
+
+        // Reads the sensor if a new integration result is due. Cheap to call often; returns true if a new lux value
+        // was published.
+        bool update();
+
+        float getLux();
+        // millis() timestamp of the last published lux value (0 if none yet)
+        uint32_t getTimestampMillis();
+        // millis() time at which the next result will be available
+        uint32_t getNextReadMillis();
+        uint32_t getReadCount();
+
+    private:
+        Adafruit_VEML7700 veml_ = Adafruit_VEML7700();
+        I2CBus* bus_ = nullptr;
+        uint8_t bus_device_;
+
+        uint8_t setting_index_;
+        uint32_t period_start_millis_ = 0;
+        // Set after changing gain/integration time, since the result in progress was measured with the old setting
+        bool discard_next_ = true;
+
+        float lux_ = 0;
+        uint32_t timestamp_millis_ = 0;
+        uint32_t read_count_ = 0;
+
+        uint32_t getReadPeriodMillis();
+        // Must be called with a transaction open
+        void applySetting(uint8_t index);
+};
+
+#endif
@@ -0,0 +1,331 @@
+#if (defined(SK_DISPLAY) && (SK_DISPLAY >0))
+#include "widgets.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+static const int16_t CENTER_X = TFT_WIDTH / 2;
+static const int16_t CENTER_Y = TFT_HEIGHT / 2;
+static const int16_t RADIUS = TFT_WIDTH / 2;
+static const int16_t POINTER_RADIUS = RADIUS - 10;
+static const float TRAIL_STEP_RADIANS = 2 * PI / 180;
+static const float ARC_STEP_RADIANS = 1.5 * PI / 180;
+
+// Extra margin around text bounds, to absorb small differences in how glyphs are positioned
+static const int16_t TEXT_MARGIN = 2;
+
+bool Rect::isEmpty() const {
+    return w <= 0 || h <= 0;
+}
+
+bool Rect::intersects(const Rect& other) const {
+    return !isEmpty() && !other.isEmpty()
+        && x < other.x + other.w && other.x < x + w
+        && y < other.y + other.h && other.y < y + h;
+}
+
+Rect Rect::merge(const Rect& other) const {
+    if (isEmpty()) {
+        return other;
+    }
+    if (other.isEmpty()) {
+        return *this;
+    }
+    int16_t x0 = std::min(x, other.x);
+    int16_t y0 = std::min(y, other.y);
+    int16_t x1 = std::max(x + w, other.x + other.w);
+    int16_t y1 = std::max(y + h, other.y + other.h);
+    return {x0, y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0)};
+}
+
+int32_t Rect::area() const {
+    return isEmpty() ? 0 : (int32_t)w * h;
+}
+
+static Rect pointBounds(float x, float y, int16_t radius) {
+    return {(int16_t)(x - radius - 1), (int16_t)(y - radius - 1), (int16_t)(2 * radius + 3), (int16_t)(2 * radius + 3)};
+}
+
+static float ringX(float angle, float radius) {
+    return CENTER_X + radius * cosf(angle);
+}
+
+static float ringY(float angle, float radius) {
+    return CENTER_Y - radius * sinf(angle);
+}
+
+// Bounds of the ring segment between two angles (in either order), padded by pad pixels
+static Rect arcBounds(float a0, float a1, float radius, int16_t pad) {
+    if (a0 > a1) {
+        std::swap(a0, a1);
+    }
+    Rect bounds = pointBounds(ringX(a1, radius), ringY(a1, radius), pad);
+    for (float a = a0; a < a1; a += 5 * PI / 180) {
+        bounds = bounds.merge(pointBounds(ringX(a, radius), ringY(a, radius), pad));
+    }
+    return bounds;
+}
+
+// Vertical extent of a free font's glyphs above (ascent) and below (descent) the baseline
+static void fontExtent(const GFXfont* font, int16_t* ascent, int16_t* descent) {
+    *ascent = 0;
+    *descent = 0;
+    for (uint16_t c = 0; c <= font->last - font->first; c++) {
+        const GFXglyph& glyph = font->glyph[c];
+        *ascent = std::max<int16_t>(*ascent, -glyph.yOffset);
+        *descent = std::max<int16_t>(*descent, glyph.height + glyph.yOffset);
+    }
+}
+
+// Bounds of a full-width line of text drawn with CC_DATUM at center_y
+static Rect textLineBounds(const GFXfont* font, int16_t center_y) {
+    int16_t ascent, descent;
+    fontExtent(font, &ascent, &descent);
+    int16_t top = center_y - ascent / 2 - TEXT_MARGIN;
+    int16_t bottom = center_y + (ascent - ascent / 2) + descent + TEXT_MARGIN;
+    return {0, top, TFT_WIDTH, (int16_t)(bottom - top)};
+}
+
+static float leftBound(const KnobConfig& config) {
+    if (config.num_positions <= 0) {
+        return PI / 2;
+    }
+    float range_radians = (config.num_positions - 1) * config.position_width_radians;
+    return PI / 2 + range_radians / 2;
+}
+
+void Widget::setBounds(const Rect& bounds) {
+    invalidate(bounds_);
+    bounds_ = bounds;
+    invalidate(bounds_);
+}
+
+
+FillBar::FillBar() {
+    bounds_ = {0, 0, TFT_WIDTH, TFT_HEIGHT};
+}
+
+void FillBar::update(const KnobState& state) {
+    int32_t height = 0;
+    if (state.config.num_positions > 1) {
+        height = state.current_position * TFT_HEIGHT / (state.config.num_positions - 1);
+    }
+    if (height != height_) {
+        // Only the band between the old and new fill level changes
+        int32_t low = std::min(height, height_);
+        int32_t high = std::max(height, height_);
+        invalidate({0, (int16_t)(TFT_HEIGHT - high), TFT_WIDTH, (int16_t)(high - low)});
+        height_ = height;
+    }
+}
+
+void FillBar::draw(Canvas& canvas, const DisplayColors& colors) {
+    if (height_ > 0) {
+        canvas.fillRect(0, TFT_HEIGHT - height_, TFT_WIDTH, height_, colors.fill);
+    }
+}
+
+
+ValueLabel::ValueLabel(const GFXfont* font, int16_t center_x, int16_t center_y) : font_(font), center_x_(center_x), center_y_(center_y) {
+    bounds_ = textLineBounds(font_, center_y_);
+}
+
+void ValueLabel::update(const KnobState& state) {
+    if (state.current_position != value_) {
+        value_ = state.current_position;
+        invalidate();
+    }
+}
+
+void ValueLabel::draw(Canvas& canvas, const DisplayColors& colors) {
+    char buf[12];
+    snprintf(buf, sizeof(buf), "%d", value_);
+    canvas.setFreeFont(font_);
+    canvas.setTextColor(colors.text);
+    canvas.drawString(buf, center_x_, center_y_, 1);
+}
+
+
+TextBlock::TextBlock(const GFXfont* font, int16_t center_x, int16_t first_line_y) : font_(font), center_x_(center_x), first_line_y_(first_line_y) {}
+
+void TextBlock::update(const KnobState& state) {
+    if (strncmp(text_, state.config.descriptor, sizeof(text_)) == 0) {
+        return;
+    }
+    strncpy(text_, state.config.descriptor, sizeof(text_) - 1);
+
+    uint8_t lines = 0;
+    const char* start = text_;
+    const char* end = text_ + strlen(text_);
+    while (start < end) {
+        const char* newline = strchr(start, '\n');
+        start = (newline == nullptr ? end : newline) + 1;
+        lines++;
+    }
+
+    Rect bounds = EMPTY_RECT;
+    for (uint8_t i = 0; i < lines; i++) {
+        bounds = bounds.merge(textLineBounds(font_, first_line_y_ + i * font_->yAdvance));
+    }
+    setBounds(bounds);
+}
+
+void TextBlock::draw(Canvas& canvas, const DisplayColors& colors) {
+    canvas.setFreeFont(font_);
+    canvas.setTextColor(colors.text);
+
+    int32_t line_y = first_line_y_;
+    const char* start = text_;
+    const char* end = start + strlen(text_);
+    while (start < end) {
+        const char* newline = strchr(start, '\n');
+        if (newline == nullptr) {
+            newline = end;
+        }
+
+        char buf[sizeof(text_)] = {};
+        strncat(buf, start, std::min(sizeof(buf) - 1, (size_t)(newline - start)));
+        canvas.drawString(buf, center_x_, line_y, 1);
+        start = newline + 1;
+        line_y += canvas.fontHeight(1);
+    }
+}
+
+
+TickMarks::TickMarks() {}
+
+void TickMarks::update(const KnobState& state) {
+    bool visible = state.config.num_positions > 0;
+    float left_bound = leftBound(state.config);
+    float right_bound = PI - left_bound;
+    if (visible == visible_ && left_bound == left_bound_) {
+        return;
+    }
+    visible_ = visible;
+    left_bound_ = left_bound;
+    right_bound_ = right_bound;
+
+    Rect bounds = EMPTY_RECT;
+    if (visible_) {
+        bounds = pointBounds(ringX(left_bound_, RADIUS), ringY(left_bound_, RADIUS), 0)
+            .merge(pointBounds(ringX(left_bound_, RADIUS - 10), ringY(left_bound_, RADIUS - 10), 0))
+            .merge(pointBounds(ringX(right_bound_, RADIUS), ringY(right_bound_, RADIUS), 0))
+            .merge(pointBounds(ringX(right_bound_, RADIUS - 10), ringY(right_bound_, RADIUS - 10), 0));
+    }
+    setBounds(bounds);
+}
+
+void TickMarks::draw(Canvas& canvas, const DisplayColors& colors) {
+    if (!visible_) {
+        return;
+    }
+    canvas.drawLine(ringX(left_bound_, RADIUS), ringY(left_bound_, RADIUS), ringX(left_bound_, RADIUS - 10), ringY(left_bound_, RADIUS - 10), colors.text);
+    canvas.drawLine(ringX(right_bound_, RADIUS), ringY(right_bound_, RADIUS), ringX(right_bound_, RADIUS - 10), ringY(right_bound_, RADIUS - 10), colors.text);
+}
+
+
+ArcGauge::ArcGauge(bool outline, uint8_t thickness) : outline_(outline), thickness_(thickness) {
+    bounds_ = {CENTER_X - RADIUS - 1, CENTER_Y - RADIUS - 1, 2 * RADIUS + 3, 2 * RADIUS + 3};
+}
+
+void ArcGauge::update(const KnobState& state) {
+    if (thickness_ == 0) {
+        return;
+    }
+
+    bool visible = state.config.num_positions > 1;
+    float start_angle = leftBound(state.config);
+    float end_angle = start_angle - state.current_position * state.config.position_width_radians;
+    if (visible == visible_ && start_angle == start_angle_ && end_angle == end_angle_) {
+        return;
+    }
+
+    float arc_radius = RADIUS - 1 - thickness_ / 2.;
+    if (visible != visible_ || start_angle != start_angle_) {
+        invalidate();
+    } else {
+        // Same arc, different length: only the segment between the old and new end changes
+        invalidate(arcBounds(end_angle_, end_angle, arc_radius, thickness_));
+    }
+    visible_ = visible;
+    start_angle_ = start_angle;
+    end_angle_ = end_angle;
+}
+
+void ArcGauge::draw(Canvas& canvas, const DisplayColors& colors) {
+    if (outline_) {
+        canvas.drawCircle(CENTER_X, CENTER_Y, RADIUS, colors.arc);
+    }
+    if (!visible_) {
+        return;
+    }
+    float arc_radius = RADIUS - 1 - thickness_ / 2.;
+    for (float a = start_angle_; a >= end_angle_; a -= ARC_STEP_RADIANS) {
+        canvas.fillCircle(ringX(a, arc_radius), ringY(a, arc_radius), thickness_ / 2, colors.fill);
+    }
+    canvas.fillCircle(ringX(end_angle_, arc_radius), ringY(end_angle_, arc_radius), thickness_ / 2, colors.fill);
+}
+
+
+PointerDot::PointerDot() {}
+
+template <typename F>
+void PointerDot::forEachDot(F f) const {
+    if (out_of_bounds_) {
+        f(ringX(raw_angle_, POINTER_RADIUS), ringY(raw_angle_, POINTER_RADIUS), 5);
+        if (raw_angle_ < adjusted_angle_) {
+            for (float r = raw_angle_; r <= adjusted_angle_; r += TRAIL_STEP_RADIANS) {
+                f(ringX(r, POINTER_RADIUS), ringY(r, POINTER_RADIUS), 2);
+            }
+        } else {
+            for (float r = raw_angle_; r >= adjusted_angle_; r -= TRAIL_STEP_RADIANS) {
+                f(ringX(r, POINTER_RADIUS), ringY(r, POINTER_RADIUS), 2);
+            }
+        }
+        f(ringX(adjusted_angle_, POINTER_RADIUS), ringY(adjusted_angle_, POINTER_RADIUS), 2);
+    } else {
+        f(ringX(adjusted_angle_, POINTER_RADIUS), ringY(adjusted_angle_, POINTER_RADIUS), 5);
+    }
+}
+
+void PointerDot::update(const KnobState& state) {
+    float adjusted_sub_position = state.sub_position_unit * state.config.position_width_radians;
+    if (state.config.num_positions > 0) {
+        if (state.current_position == 0 && state.sub_position_unit < 0) {
+            adjusted_sub_position = -logf(1 - state.sub_position_unit  * state.config.position_width_radians / 5 / PI * 180) * 5 * PI / 180;
+        } else if (state.current_position == state.config.num_positions - 1 && state.sub_position_unit > 0) {
+            adjusted_sub_position = logf(1 + state.sub_position_unit  * state.config.position_width_radians / 5 / PI * 180)  * 5 * PI / 180;
+        }
+    }
+
+    float raw_angle = leftBound(state.config) - state.current_position * state.config.position_width_radians;
+    float adjusted_angle = raw_angle - adjusted_sub_position;
+    bool out_of_bounds = state.config.num_positions > 0 && ((state.current_position == 0 && state.sub_position_unit < 0) || (state.current_position == state.config.num_positions - 1 && state.sub_position_unit > 0));
+
+    if (out_of_bounds == out_of_bounds_ && raw_angle == raw_angle_ && adjusted_angle == adjusted_angle_) {
+        return;
+    }
+    out_of_bounds_ = out_of_bounds;
+    raw_angle_ = raw_angle;
+    adjusted_angle_ = adjusted_angle;
+
+    Rect bounds = EMPTY_RECT;
+    forEachDot([&bounds](float x, float y, int16_t r) {
+        bounds = bounds.merge(pointBounds(x, y, r));
+    });
+    setBounds(bounds);
+}
+
+void PointerDot::draw(Canvas& canvas, const DisplayColors& colors) {
+    forEachDot([&canvas, &colors](float x, float y, int16_t r) {
+        canvas.fillCircle(x, y, r, colors.dot);
+    });
+}
+
+#endif
@@ -0,0 +1,135 @@
+#pragma once
+
+#if (defined(SK_DISPLAY) && (SK_DISPLAY >0))
+
+#include "display_canvas.h"
+#include "knob_data.h"
+
+struct Rect {
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+
+    bool isEmpty() const;
+    bool intersects(const Rect& other) const;
+    // Smallest rect containing both; an empty rect contributes nothing
+    Rect merge(const Rect& other) const;
+    int32_t area() const;
+};
+
+static const Rect EMPTY_RECT = {0, 0, 0, 0};
+
+// Retained-mode widget. Widgets keep whatever state they need to draw themselves, compare it against each new
+// KnobState in update(), and invalidate only the screen area that actually changed. The renderer then redraws
+// just the invalidated areas (clipped), so widgets always draw themselves in full from draw().
+class Widget {
+    public:
+        virtual ~Widget() {};
+
+        virtual void update(const KnobState& state) = 0;
+        virtual void draw(Canvas& canvas, const DisplayColors& colors) = 0;
+
+        const Rect& getBounds() const { return bounds_; }
+        const Rect& getDirty() const { return dirty_; }
+        void clearDirty() { dirty_ = EMPTY_RECT; }
+
+        // Marks the whole widget for redraw, e.g. when it first becomes visible
+        void invalidate() { invalidate(bounds_); }
+
+    protected:
+        Rect bounds_ = EMPTY_RECT;
+        Rect dirty_ = EMPTY_RECT;
+
+        void invalidate(const Rect& area) { dirty_ = dirty_.merge(area); }
+
+        // Moves/resizes the widget, invalidating both the old and new area
+        void setBounds(const Rect& bounds);
+};
+
+// Horizontal fill rising from the bottom of the screen in proportion to the current position.
+class FillBar : public Widget {
+    public:
+        FillBar();
+        void update(const KnobState& state) override;
+        void draw(Canvas& canvas, const DisplayColors& colors) override;
+
+    private:
+        int32_t height_ = 0;
+};
+
+// Current position as a number, centered at a fixed point.
+class ValueLabel : public Widget {
+    public:
+        ValueLabel(const GFXfont* font, int16_t center_x, int16_t center_y);
+        void update(const KnobState& state) override;
+        void draw(Canvas& canvas, const DisplayColors& colors) override;
+
+    private:
+        const GFXfont* font_;
+        int16_t center_x_;
+        int16_t center_y_;
+        int32_t value_ = INT32_MIN;
+};
+
+// The config descriptor, one centered line per '\n'-separated segment.
+class TextBlock : public Widget {
+    public:
+        TextBlock(const GFXfont* font, int16_t center_x, int16_t first_line_y);
+        void update(const KnobState& state) override;
+        void draw(Canvas& canvas, const DisplayColors& colors) override;
+
+    private:
+        const GFXfont* font_;
+        int16_t center_x_;
+        int16_t first_line_y_;
+        char text_[sizeof(KnobConfig::descriptor)] = {};
+};
+
+// Short radial lines at the endstops of a bounded config.
+class TickMarks : public Widget {
+    public:
+        TickMarks();
+        void update(const KnobState& state) override;
+        void draw(Canvas& canvas, const DisplayColors& colors) override;
+
+    private:
+        bool visible_ = false;
+        float left_bound_ = 0;
+        float right_bound_ = 0;
+};
+
+// Ring around the edge of the display. Optionally shows the full outline, and for bounded configs a thicker
+// arc from the left endstop to the current position.
+class ArcGauge : public Widget {
+    public:
+        ArcGauge(bool outline, uint8_t thickness);
+        void update(const KnobState& state) override;
+        void draw(Canvas& canvas, const DisplayColors& colors) override;
+
+    private:
+        bool outline_;
+        uint8_t thickness_;
+        bool visible_ = false;
+        float start_angle_ = 0;
+        float end_angle_ = 0;
+};
+
+// Dot showing the knob's angle, with a trail when pushing past an endstop.
+class PointerDot : public Widget {
+    public:
+        PointerDot();
+        void update(const KnobState& state) override;
+        void draw(Canvas& canvas, const DisplayColors& colors) override;
+
+    private:
+        bool out_of_bounds_ = false;
+        float raw_angle_ = 0;
+        float adjusted_angle_ = 0;
+
+        // Calls f(x, y, radius) for each dot making up the pointer
+        template <typename F>
+        void forEachDot(F f) const;
+};
+
+#endif
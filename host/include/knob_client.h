@@ -0,0 +1,74 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "config_library.h"
+#include "protocol.h"
+#include "serial_port.h"
+
+// A flight recorder capture, reassembled from its RECORDING messages
+struct FlightRecording {
+    FlightFreezeReason reason;
+    uint32_t freeze_millis;
+    // Oldest first
+    std::vector<FlightRecord> records;
+};
+
+// Host end of the framed protocol (see firmware/src/protocol.h). Requests block until the matching ACK arrives;
+// anything else received meanwhile (state, telemetry, text) is dispatched to the callbacks.
+class KnobClient {
+    public:
+        KnobClient(SerialPort& port);
+
+        std::function<void(const StateMessage&)> on_state;
+        std::function<void(const TelemetryMessage&)> on_telemetry;
+        // Plain text printed by the firmware between frames. Text is only recognized once the next delimiter
+        // arrives, so it may be delayed while nothing else is being sent.
+        std::function<void(const std::string&)> on_text;
+
+        // Each returns false if no ACK arrived in time; otherwise the device's status is stored in status
+        bool ping(AckStatus& status, int timeout_millis = 500);
+        bool setConfig(const KnobConfig& config, AckStatus& status, int timeout_millis = 500);
+        bool sendCommand(CommandId command, AckStatus& status, int timeout_millis = 500);
+        bool setStream(const StreamMessage& stream, AckStatus& status, int timeout_millis = 500);
+        // Selects a config from the device's library (or a built-in config, numbered from 1) by id
+        bool selectConfig(uint32_t id, AckStatus& status, int timeout_millis = 500);
+        // Fetches the histogram of each LatencyPath since the device's last reset, and optionally resets them
+        bool getLatency(std::vector<LatencyMessage>& latencies, bool reset, AckStatus& status, int timeout_millis = 500);
+        // Downloads the flight recorder's capture, and optionally clears it. A full capture takes about half a second
+        // at 115200 baud.
+        bool getRecording(FlightRecording& recording, bool clear, AckStatus& status, int timeout_millis = 2000);
+
+        // Replaces the device's config library. Stops at the first request that fails or isn't acknowledged with
+        // OK; status then holds that request's result. Erasing the flash makes the first request slow.
+        bool uploadConfigLibrary(const ConfigRecord* records, uint32_t count, AckStatus& status, int timeout_millis = 2000);
+
+        // Processes input for up to timeout_millis, dispatching callbacks. Returns false if the port failed.
+        bool poll(int timeout_millis);
+
+        uint32_t getFrameCount() const { return decoder_.getFrameCount(); }
+        uint32_t getRejectedCount() const { return decoder_.getRejectedCount(); }
+
+    private:
+        SerialPort& port_;
+        FrameDecoder decoder_;
+        uint8_t sequence_ = 0;
+
+        // Raw bytes since the last delimiter, kept for text passthrough
+        std::string pending_;
+
+        bool awaiting_ack_ = false;
+        uint8_t awaited_sequence_ = 0;
+        bool ack_received_ = false;
+        AckMessage ack_ = {};
+        // Collects LATENCY replies during getLatency()
+        std::vector<LatencyMessage>* latencies_ = nullptr;
+        // Collects RECORDING replies during getRecording()
+        FlightRecording* recording_ = nullptr;
+
+        bool request(MessageId id, const uint8_t* body, size_t body_length, AckStatus& status, int timeout_millis);
+        void handleByte(uint8_t byte);
+        void handleFrame();
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string.h>
+#include <vector>
+
+#include "flash_region.h"
+
+// FlashRegion in RAM with NOR semantics (erase to 0xFF, writes only clear bits), for simulating the device on the host
+class RamFlashRegion : public FlashRegion {
+    public:
+        RamFlashRegion(size_t size) : data_(size, 0xFF) {}
+
+        size_t getSize() override { return data_.size(); }
+
+        bool erase(size_t offset, size_t length) override {
+            if (offset % SECTOR_SIZE != 0 || length % SECTOR_SIZE != 0 || offset + length > data_.size()) {
+                return false;
+            }
+            memset(&data_[offset], 0xFF, length);
+            return true;
+        }
+
+        bool write(size_t offset, const uint8_t* data, size_t length) override {
+            if (offset + length > data_.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < length; i++) {
+                data_[offset + i] &= data[i];
+            }
+            return true;
+        }
+
+        bool read(size_t offset, uint8_t* data, size_t length) override {
+            if (offset + length > data_.size()) {
+                return false;
+            }
+            memcpy(data, &data_[offset], length);
+            return true;
+        }
+
+        const uint8_t* map() override { return data_.data(); }
+
+    private:
+        std::vector<uint8_t> data_;
+};
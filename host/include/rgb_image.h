@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "software_canvas.h"
+
+// 8-bit RGB image, read from and written to PNG files (with libpng), e.g. for comparing rendered display frames
+// against golden images
+struct RgbImage {
+    int32_t width = 0;
+    int32_t height = 0;
+    // Rows top to bottom, 3 bytes per pixel
+    std::vector<uint8_t> pixels;
+
+    // Expands the canvas' RGB565 pixels
+    static RgbImage fromCanvas(const SoftwareCanvas& canvas);
+
+    // Both return false on I/O failure (or, reading, if the file isn't a PNG libpng can decode)
+    bool readPng(const char* path);
+    bool writePng(const char* path) const;
+
+    // Number of pixels that differ, counting every pixel if the sizes differ
+    uint32_t countDifferences(const RgbImage& other) const;
+};
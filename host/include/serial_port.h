@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Raw (no echo, no line discipline) POSIX serial port. Also works on pseudo-terminals.
+class SerialPort {
+    public:
+        SerialPort();
+        ~SerialPort();
+        SerialPort(SerialPort const&)=delete;
+        SerialPort& operator=(SerialPort const&)=delete;
+
+        bool open(const char* path, uint32_t baud);
+        void close();
+        bool isOpen() const { return fd_ >= 0; }
+
+        // Waits up to timeout_millis for input; returns the number of bytes read, 0 on timeout, or -1 on error
+        int read(uint8_t* buffer, size_t size, int timeout_millis);
+        bool write(const uint8_t* data, size_t length);
+
+    private:
+        int fd_ = -1;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+// Declarations only, so the sensor's header compiles; the simulation has no ambient light sensor (SK_ALS=0)
+#include "Wire.h"
+
+#define VEML7700_GAIN_1 0x00
+#define VEML7700_GAIN_2 0x01
+#define VEML7700_GAIN_1_8 0x02
+#define VEML7700_GAIN_1_4 0x03
+#define VEML7700_IT_100MS 0x00
+#define VEML7700_IT_200MS 0x01
+#define VEML7700_IT_400MS 0x02
+#define VEML7700_IT_800MS 0x03
+#define VEML7700_IT_50MS 0x08
+#define VEML7700_IT_25MS 0x0C
+
+class Adafruit_VEML7700 {
+    public:
+        bool begin(TwoWire* bus = &Wire);
+        void setGain(uint8_t gain);
+        uint8_t getGain();
+        void setIntegrationTime(uint8_t integration_time);
+        uint8_t getIntegrationTime();
+        uint16_t readALS();
+        float readLux();
+        void enable(bool enable);
+};
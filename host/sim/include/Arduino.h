@@ -0,0 +1,149 @@
+#pragma once
+
+// Simulated Arduino core (arduino-esp32 flavour): timing on the simulation's virtual clock, and GPIO/LEDC state kept
+// in memory. The firmware talks to the serial port through the UART driver (see driver/uart.h) rather than Serial.
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_freertos.h"
+
+#define PROGMEM
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x02
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define DEC 10
+#define HEX 16
+
+using std::min;
+using std::max;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define radians(deg) ((deg) * DEG_TO_RAD)
+#define degrees(rad) ((rad) * RAD_TO_DEG)
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void ets_delay_us(uint32_t us);
+// Goes to stderr
+int ets_printf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+double ledcSetup(uint8_t channel, double frequency, uint8_t resolution_bits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+
+typedef enum {
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+// Every simulation run starts from power on
+inline esp_reset_reason_t esp_reset_reason() { return ESP_RST_POWERON; }
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERROR_CHECK(x) do { esp_err_t err_ = (x); assert(err_ == ESP_OK); (void)err_; } while (0)
+
+class Print {
+    public:
+        virtual ~Print() {}
+
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t* buffer, size_t size) {
+            size_t n = 0;
+            while (size-- > 0) {
+                n += write(*buffer++);
+            }
+            return n;
+        }
+        size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+
+        size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+        size_t print(const char* str) { return write(str); }
+        size_t print(char c) { return write((uint8_t)c); }
+        size_t print(int value, int base = DEC) { return print((long)value, base); }
+        size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+        size_t print(long value, int base = DEC);
+        size_t print(unsigned long value, int base = DEC);
+        size_t print(double value, int digits = 2);
+
+        size_t println() { return write("\r\n"); }
+        template<typename T>
+        size_t println(T value) { return print(value) + println(); }
+        template<typename T>
+        size_t println(T value, int format) { return print(value, format) + println(); }
+};
+
+class Stream : public Print {
+    public:
+        virtual int available() = 0;
+        virtual int read() = 0;
+        virtual int peek() = 0;
+        virtual void flush() {}
+
+        size_t readBytes(uint8_t* buffer, size_t length);
+};
+
+// Cycle counts follow virtual time at the nominal 240 MHz
+class EspClass {
+    public:
+        uint32_t getCycleCount();
+        uint32_t getCpuFreqMHz() { return 240; }
+        // The heap isn't modeled; these report a nominal ESP32 heap
+        uint32_t getHeapSize() { return 327680; }
+        uint32_t getFreeHeap() { return 262144; }
+        uint32_t getMinFreeHeap() { return 262144; }
+        uint32_t getMaxAllocHeap() { return 114688; }
+        void restart();
+};
+
+extern EspClass ESP;
@@ -0,0 +1,103 @@
+#pragma once
+
+// Simulated subset of FastLED: the color types and 8-bit math follow the library's definitions, and show()
+// hands the registered pixel buffer to the simulation (which counts frames and keeps the colors for harnesses).
+
+#include "Arduino.h"
+
+typedef uint8_t fract8;
+
+inline uint8_t scale8(uint8_t i, fract8 scale) {
+    return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8;
+}
+
+// Like scale8, but never scales a non-zero value down to zero
+inline uint8_t scale8_video(uint8_t i, fract8 scale) {
+    return (((uint16_t)i * scale) >> 8) + ((i && scale) ? 1 : 0);
+}
+
+inline uint8_t qadd8(uint8_t i, uint8_t j) {
+    uint16_t t = i + j;
+    return t > 255 ? 255 : t;
+}
+
+inline uint8_t qsub8(uint8_t i, uint8_t j) {
+    return i > j ? i - j : 0;
+}
+
+inline uint8_t dim8_video(uint8_t x) {
+    return scale8_video(x, x);
+}
+
+struct CHSV {
+    uint8_t h;
+    uint8_t s;
+    uint8_t v;
+
+    CHSV() {}
+    CHSV(uint8_t hue, uint8_t saturation, uint8_t value) : h(hue), s(saturation), v(value) {}
+};
+
+struct CRGB;
+void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb);
+
+struct CRGB {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+
+    enum HTMLColorCode : uint32_t {
+        Black = 0x000000,
+        Blue = 0x0000FF,
+        Green = 0x008000,
+        Red = 0xFF0000,
+        White = 0xFFFFFF,
+    };
+
+    CRGB() {}
+    CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+    CRGB(uint32_t color_code) : r((color_code >> 16) & 0xFF), g((color_code >> 8) & 0xFF), b(color_code & 0xFF) {}
+    CRGB(HTMLColorCode color_code) : CRGB((uint32_t)color_code) {}
+    CRGB(const CHSV& hsv) { hsv2rgb_rainbow(hsv, *this); }
+
+    CRGB& operator+=(const CRGB& other) {
+        r = qadd8(r, other.r);
+        g = qadd8(g, other.g);
+        b = qadd8(b, other.b);
+        return *this;
+    }
+
+    CRGB& nscale8_video(uint8_t scale) {
+        r = scale8_video(r, scale);
+        g = scale8_video(g, scale);
+        b = scale8_video(b, scale);
+        return *this;
+    }
+
+    bool operator==(const CRGB& other) const { return r == other.r && g == other.g && b == other.b; }
+    bool operator!=(const CRGB& other) const { return !(*this == other); }
+};
+
+enum EOrder {
+    RGB = 0012,
+    GRB = 0102,
+};
+
+template<uint8_t DATA_PIN>
+class SK6812 {};
+
+class CFastLED {
+    public:
+        template<template<uint8_t> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+        void addLeds(CRGB* leds, int count) {
+            addLeds(leds, count);
+        }
+
+        void setBrightness(uint8_t brightness) {}
+        void show();
+
+    private:
+        void addLeds(CRGB* leds, int count);
+};
+
+extern CFastLED FastLED;
@@ -0,0 +1,170 @@
+#pragma once
+
+// Simulated subset of Simple FOC 2.2: the sensor base class, PID and low pass filter behave like the library's,
+// while the motor and driver hand a q-axis voltage straight to the simulated plant (commutation is assumed ideal,
+// so the pole pairs and zero electric angle only matter to code that reads them back).
+
+#include "Arduino.h"
+
+#define _PI 3.14159265359f
+#define _PI_2 1.57079632679f
+#define _PI_3 1.0471975512f
+#define _2PI 6.28318530718f
+#define _3PI_2 4.71238898038f
+#define _sign(a) (((a) < 0) ? -1 : ((a) > 0))
+#define _constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define NOT_SET -12345.0f
+
+float _normalizeAngle(float angle);
+unsigned long _micros();
+
+enum Direction {
+    CW = 1,
+    CCW = -1,
+    UNKNOWN = 0,
+};
+
+enum class MotionControlType {
+    torque,
+    velocity,
+    angle,
+    velocity_openloop,
+    angle_openloop,
+};
+
+class PIDController {
+    public:
+        PIDController(float P, float I, float D, float ramp, float limit);
+        float operator()(float error);
+
+        float P;
+        float I;
+        float D;
+        float output_ramp;
+        float limit;
+
+    protected:
+        float error_prev = 0;
+        float output_prev = 0;
+        float integral_prev = 0;
+        unsigned long timestamp_prev;
+};
+
+class LowPassFilter {
+    public:
+        LowPassFilter(float time_constant);
+        float operator()(float x);
+
+        float Tf;
+
+    protected:
+        unsigned long timestamp_prev;
+        float y_prev = 0;
+};
+
+class Sensor {
+    public:
+        virtual ~Sensor() {}
+
+        virtual void update();
+        virtual float getMechanicalAngle();
+        virtual float getAngle();
+        virtual double getPreciseAngle();
+        virtual float getVelocity();
+        virtual int32_t getFullRotations();
+        virtual int needsSearch() { return 0; }
+        virtual void init();
+
+        float min_elapsed_time = 0.000100;
+
+    protected:
+        virtual float getSensorAngle() = 0;
+
+        float velocity = 0;
+        float angle_prev = 0;
+        long angle_prev_ts = 0;
+        float vel_angle_prev = 0;
+        long vel_angle_prev_ts = 0;
+        int32_t full_rotations = 0;
+        int32_t vel_full_rotations = 0;
+};
+
+class BLDCDriver {
+    public:
+        virtual ~BLDCDriver() {}
+        virtual int init() = 0;
+        virtual void enable() = 0;
+        virtual void disable() = 0;
+        virtual void setPhaseVoltage(float voltage_q, float voltage_d, float angle_electrical) = 0;
+
+        float voltage_power_supply = 12;
+        float voltage_limit = NOT_SET;
+};
+
+// Drives the simulated plant
+class BLDCDriver6PWM : public BLDCDriver {
+    public:
+        BLDCDriver6PWM(int phA_h, int phA_l, int phB_h, int phB_l, int phC_h, int phC_l, int en = NOT_SET) {}
+
+        int init() override;
+        void enable() override {}
+        void disable() override;
+        void setPhaseVoltage(float voltage_q, float voltage_d, float angle_electrical) override;
+};
+
+struct DQVoltage_s {
+    float d;
+    float q;
+};
+
+class BLDCMotor {
+    public:
+        BLDCMotor(int pole_pairs);
+
+        void linkDriver(BLDCDriver* driver);
+        void linkSensor(Sensor* sensor);
+
+        void init();
+        int initFOC(float zero_electric_offset = NOT_SET, Direction sensor_direction = CW);
+        void loopFOC();
+        void move(float new_target = NOT_SET);
+        void monitor() {}
+
+        float shaftAngle();
+        float shaftVelocity();
+
+        int pole_pairs;
+        float zero_electric_angle = NOT_SET;
+        Direction sensor_direction = CW;
+        MotionControlType controller = MotionControlType::torque;
+
+        float target = 0;
+        float shaft_angle = 0;
+        float shaft_velocity = 0;
+        DQVoltage_s voltage = {0, 0};
+
+        float voltage_limit = 12;
+        float velocity_limit = 20;
+
+        PIDController PID_velocity = PIDController(0.5f, 10, 0, 1000, 12);
+        PIDController P_angle = PIDController(20, 0, 0, 0, 20);
+        LowPassFilter LPF_velocity = LowPassFilter(0.005f);
+        LowPassFilter LPF_angle = LowPassFilter(0);
+
+        unsigned int monitor_downsample = 10;
+
+        Sensor* sensor = nullptr;
+        BLDCDriver* driver = nullptr;
+};
+
+typedef void (*CommandCallback)(char*);
+
+// Serial command parser; the simulation doesn't run any of the commands
+class Commander {
+    public:
+        Commander(Stream& serial, char eol = '\n', bool echo = false) {}
+
+        void add(char id, CommandCallback callback, const char* label = nullptr) {}
+        void run() {}
+        void motor(BLDCMotor* motor, char* user_cmd) {}
+};
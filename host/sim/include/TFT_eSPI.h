@@ -0,0 +1,32 @@
+#pragma once
+
+// Simulated TFT_eSPI: the panel and sprites are software canvases. Pushing a sprite copies the pixels (as RGB565, so
+// 4-bit sprites are expanded through their palette) into the panel, so harnesses can inspect what the screen shows.
+
+#include "Arduino.h"
+#include "software_canvas.h"
+
+class TFT_eSPI : public SoftwareCanvas {
+    public:
+        TFT_eSPI(int16_t width = TFT_WIDTH, int16_t height = TFT_HEIGHT) : panel_width_(width), panel_height_(height) {}
+
+        void begin();
+        void invertDisplay(bool invert) {}
+        void setRotation(uint8_t rotation) {}
+        void fillScreen(uint32_t color) { fillSprite(color); }
+
+    private:
+        int16_t panel_width_;
+        int16_t panel_height_;
+};
+
+class TFT_eSprite : public SoftwareCanvas {
+    public:
+        TFT_eSprite(TFT_eSPI* panel) : panel_(panel) {}
+
+        void pushSprite(int32_t x, int32_t y);
+        bool pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh);
+
+    private:
+        TFT_eSPI* panel_;
+};
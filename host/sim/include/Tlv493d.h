@@ -0,0 +1,31 @@
+#pragma once
+
+// Declarations only, so the sensor's header compiles; the simulation reads the knob through the MT6701 instead
+#include "Wire.h"
+
+enum Tlv493d_Error_t {
+    TLV493D_NO_ERROR = 0,
+    TLV493D_BUS_ERROR = 1,
+    TLV493D_FRAME_ERROR = 2,
+};
+
+class Tlv493d {
+    public:
+        enum AccessMode_e {
+            POWERDOWNMODE = 0,
+            FASTMODE,
+            LOWPOWERMODE,
+            ULTRALOWPOWERMODE,
+            MASTERCONTROLLEDMODE,
+        };
+
+        void begin(TwoWire& bus);
+        void setAccessMode(AccessMode_e mode);
+        void disableInterrupt();
+        void disableTemp();
+        Tlv493d_Error_t updateData();
+        uint8_t getExpectedFrameCount();
+        float getX();
+        float getY();
+        float getZ();
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+// Simulated I2C bus with nothing attached: every transaction is NACKed
+#include "Arduino.h"
+
+typedef enum {
+    I2C_ERROR_OK = 0,
+    I2C_ERROR_DEV,
+    I2C_ERROR_ACK,
+    I2C_ERROR_TIMEOUT,
+    I2C_ERROR_BUS,
+    I2C_ERROR_BUSY,
+    I2C_ERROR_MEMORY,
+    I2C_ERROR_CONTINUE,
+    I2C_ERROR_NO_BEGIN,
+} i2c_err_t;
+
+class TwoWire : public Stream {
+    public:
+        bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) { return true; }
+        void setClock(uint32_t frequency) {}
+        void setTimeOut(uint16_t timeout_millis) {}
+
+        void beginTransmission(uint8_t address) {}
+        // 2: address NACK
+        uint8_t endTransmission(bool send_stop = true) { return 2; }
+        uint8_t requestFrom(uint8_t address, uint8_t quantity, bool send_stop = true) { return 0; }
+        i2c_err_t lastError() { return I2C_ERROR_ACK; }
+
+        size_t write(uint8_t c) override { return 0; }
+        size_t write(const uint8_t* buffer, size_t size) override { return 0; }
+        using Print::write;
+        int available() override { return 0; }
+        int read() override { return -1; }
+        int peek() override { return -1; }
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,74 @@
+#pragma once
+
+// Simulated UART driver: UART0 on the file descriptor chosen by the harness (SimOptions::serial_fd). Input is taken
+// into the RX buffer as it arrives, with a UART_DATA event each time, like the driver's interrupt does; the other
+// ports don't exist.
+
+#include "Arduino.h"
+
+typedef int uart_port_t;
+
+#define UART_NUM_0 0
+
+typedef enum {
+    UART_DATA_5_BITS = 0,
+    UART_DATA_6_BITS = 1,
+    UART_DATA_7_BITS = 2,
+    UART_DATA_8_BITS = 3,
+} uart_word_length_t;
+
+typedef enum {
+    UART_PARITY_DISABLE = 0,
+    UART_PARITY_EVEN = 2,
+    UART_PARITY_ODD = 3,
+} uart_parity_t;
+
+typedef enum {
+    UART_STOP_BITS_1 = 1,
+    UART_STOP_BITS_1_5 = 2,
+    UART_STOP_BITS_2 = 3,
+} uart_stop_bits_t;
+
+typedef enum {
+    UART_HW_FLOWCTRL_DISABLE = 0,
+    UART_HW_FLOWCTRL_RTS = 1,
+    UART_HW_FLOWCTRL_CTS = 2,
+    UART_HW_FLOWCTRL_CTS_RTS = 3,
+} uart_hw_flowcontrol_t;
+
+typedef struct {
+    int baud_rate;
+    uart_word_length_t data_bits;
+    uart_parity_t parity;
+    uart_stop_bits_t stop_bits;
+    uart_hw_flowcontrol_t flow_ctrl;
+    uint8_t rx_flow_ctrl_thresh;
+    bool use_ref_tick;
+} uart_config_t;
+
+typedef enum {
+    UART_DATA,
+    UART_BREAK,
+    UART_BUFFER_FULL,
+    UART_FIFO_OVF,
+    UART_FRAME_ERR,
+    UART_PARITY_ERR,
+    UART_DATA_BREAK,
+    UART_PATTERN_DET,
+    UART_EVENT_MAX,
+} uart_event_type_t;
+
+typedef struct {
+    uart_event_type_t type;
+    size_t size;
+} uart_event_t;
+
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t* config);
+esp_err_t uart_driver_install(uart_port_t port, int rx_buffer_size, int tx_buffer_size, int queue_size,
+    QueueHandle_t* queue, int intr_alloc_flags);
+// Never waits, whatever ticks says: returns what has been received so far (up to length)
+int uart_read_bytes(uart_port_t port, uint8_t* buffer, uint32_t length, TickType_t ticks);
+int uart_write_bytes(uart_port_t port, const char* buffer, size_t size);
+esp_err_t uart_get_buffered_data_len(uart_port_t port, size_t* size);
+// Output goes straight to the file descriptor, so there's never anything left to wait for
+esp_err_t uart_wait_tx_done(uart_port_t port, TickType_t ticks);
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t spi_flash_mmap_handle_t;
+
+typedef enum {
+    SPI_FLASH_MMAP_DATA,
+    SPI_FLASH_MMAP_INST,
+} spi_flash_mmap_memory_t;
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle);
@@ -0,0 +1,26 @@
+#pragma once
+
+// Simulated high resolution timers. As on the ESP32, callbacks run one after another in a task of their own, above
+// every application task; here they fire on the first tick at or after they're due.
+
+#include "Arduino.h"
+
+typedef struct SimEspTimer* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void* arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_micros);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_micros);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+int64_t esp_timer_get_time();
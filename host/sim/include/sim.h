@@ -0,0 +1,67 @@
+#pragma once
+
+// Harness side of the firmware simulation: runs the firmware's setup() and loop() with its tasks on the simulation
+// kernel (see sim_freertos.h) and gives access to the simulated hardware. Calls that run the simulation or read
+// firmware-owned state (the display panel, LEDs) are meant for threads outside it, e.g. a test's main thread.
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "sim_plant.h"
+
+class SoftwareCanvas;
+
+struct SimOptions {
+    // Virtual seconds per wall clock second; 0 runs as fast as possible
+    double speed = 0;
+    // File descriptor UART0 reads and writes (e.g. a pseudo-terminal); -1 discards output and never receives
+    int serial_fd = -1;
+    // Partition table to create the flash partitions from (the firmware's partitions.csv)
+    std::string partitions_path;
+};
+
+struct SimTaskStats {
+    std::string name;
+    uint32_t priority;
+    // Host CPU time the task's thread has used
+    double cpu_seconds;
+    // Times it has woken up from blocking
+    uint64_t wakes;
+};
+
+class Simulation {
+    public:
+        // Runs setup() and then loop() forever in a task, like the Arduino core's loop task. Virtual time stays
+        // at 0 until runUntil()/runFor() (or a non-zero speed) lets it advance.
+        static void start(void (*setup)(), void (*loop)(), const SimOptions& options);
+
+        // Lets the simulation run until virtual time reaches the given point and every task has blocked, then
+        // pauses it. While paused, firmware state can be inspected without racing the tasks.
+        static void runUntil(uint64_t micros);
+        static void runFor(uint64_t micros);
+        // Lets the simulation run without a limit (e.g. when paced at real time for a client on the serial port)
+        static void resume();
+
+        static uint64_t micros();
+        static void setSpeed(double speed);
+
+        static void getTaskStats(std::vector<SimTaskStats>& stats);
+
+        static SimPlant& plant();
+
+        // Panel contents as last pushed by the display task; nullptr before the display is initialized
+        static const SoftwareCanvas* display();
+        static uint32_t getDisplayPushCount();
+
+        // LED colors as of the last FastLED.show()
+        static uint16_t getLedCount();
+        static uint32_t getLed(uint16_t index);
+        static uint32_t getLedShowCount();
+
+        // Duty cycle last written to a LEDC (PWM) channel, e.g. the display backlight
+        static uint32_t getLedcDuty(uint8_t channel);
+
+        // Flash erase and write calls so far, on any partition
+        static uint32_t getFlashWriteCount();
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <mutex>
+#include <stdint.h>
+
+struct SimPlantParams {
+    // Rotor plus knob, in kg m^2
+    float inertia = 1e-5f;
+    // Torque per amp (equal to the back-EMF constant in V s/rad)
+    float torque_constant = 0.04f;
+    // Phase resistance in ohms
+    float resistance = 10;
+    // Bearing friction: viscous (N m s/rad) and Coulomb (N m)
+    float viscous_friction = 1e-5f;
+    float coulomb_friction = 2e-4f;
+};
+
+// Physical model of the knob: a gimbal motor with ideal commutation driving a rotor with friction, optionally held
+// by a hand. Motor torque follows the q-axis voltage applied by the driver, less back-EMF. The state is integrated
+// lazily, in small fixed steps, up to the virtual time of each query.
+class SimPlant {
+    public:
+        SimPlant(const SimPlantParams& params = SimPlantParams());
+
+        // From the motor driver
+        void setVoltage(float voltage_q);
+        float getVoltage();
+
+        // Mechanical angle (radians, unbounded) and velocity (rad/s)
+        float getAngle();
+        float getVelocity();
+
+        // Puts a hand on the knob: a spring (N m/rad) and damper (N m s/rad) pulling it towards the hand's angle,
+        // which starts where the knob is
+        void grab(float stiffness = 0.5f, float damping = 2e-3f);
+        // Turns the hand to an absolute angle at constant speed over the given time
+        void turnTo(float angle, uint64_t duration_micros);
+        void release();
+
+    private:
+        static const uint32_t STEP_MICROS = 10;
+
+        const SimPlantParams params_;
+        std::mutex mutex_;
+
+        uint64_t time_micros_ = 0;
+        double angle_ = 0;
+        double velocity_ = 0;
+        float voltage_q_ = 0;
+
+        bool holding_ = false;
+        float hand_stiffness_ = 0;
+        float hand_damping_ = 0;
+        double hand_from_ = 0;
+        double hand_to_ = 0;
+        uint64_t hand_start_micros_ = 0;
+        uint64_t hand_end_micros_ = 0;
+
+        void advance();
+        double handAngle(uint64_t micros) const;
+};
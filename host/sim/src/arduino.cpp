@@ -0,0 +1,147 @@
+#include "Arduino.h"
+#include "sim.h"
+#include "sim_internal.h"
+
+EspClass ESP;
+
+static const uint8_t PIN_COUNT = 40;
+static const uint8_t LEDC_CHANNEL_COUNT = 16;
+
+static uint8_t pin_values[PIN_COUNT];
+static uint32_t ledc_duty[LEDC_CHANNEL_COUNT];
+
+uint32_t millis() {
+    return simNowMicros() / 1000;
+}
+
+uint32_t micros() {
+    return simNowMicros();
+}
+
+void delay(uint32_t ms) {
+    vTaskDelay(ms / portTICK_PERIOD_MS);
+}
+
+// Both spin on the ESP32 rather than block
+void delayMicroseconds(uint32_t us) {
+    simBusyMicros(us);
+}
+
+void ets_delay_us(uint32_t us) {
+    simBusyMicros(us);
+}
+
+int ets_printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vfprintf(stderr, format, args);
+    va_end(args);
+    return length;
+}
+
+// On the ESP32 libstdc++ is linked statically, so operator new reaches the (possibly wrapped, see heap_monitor.h)
+// malloc. Here it lives in a shared library that would call the real one, so route it through this object instead.
+void* operator new(size_t size) {
+    void* ptr = malloc(size);
+    if (ptr == nullptr) {
+        abort();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept {
+    free(ptr);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin < PIN_COUNT && mode == INPUT_PULLUP) {
+        pin_values[pin] = HIGH;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin < PIN_COUNT) {
+        pin_values[pin] = value;
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < PIN_COUNT ? pin_values[pin] : LOW;
+}
+
+// No simulated peripheral raises pin interrupts yet
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {}
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode) {}
+void detachInterrupt(uint8_t pin) {}
+
+double ledcSetup(uint8_t channel, double frequency, uint8_t resolution_bits) {
+    return frequency;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t channel) {}
+
+void ledcWrite(uint8_t channel, uint32_t duty) {
+    if (channel < LEDC_CHANNEL_COUNT) {
+        ledc_duty[channel] = duty;
+    }
+}
+
+uint32_t Simulation::getLedcDuty(uint8_t channel) {
+    return channel < LEDC_CHANNEL_COUNT ? ledc_duty[channel] : 0;
+}
+
+uint32_t EspClass::getCycleCount() {
+    return (uint32_t)(simNowMicros() * getCpuFreqMHz());
+}
+
+void EspClass::restart() {
+    fprintf(stderr, "ESP.restart() called at %.3f s\n", simNowMicros() / 1e6);
+    abort();
+}
+
+// --- Print ---
+
+size_t Print::printf(const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) {
+        return 0;
+    }
+    return write((const uint8_t*)buffer, std::min((size_t)length, sizeof(buffer) - 1));
+}
+
+size_t Print::print(long value, int base) {
+    if (base == DEC) {
+        char buffer[24];
+        snprintf(buffer, sizeof(buffer), "%ld", value);
+        return write(buffer);
+    }
+    return print((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%lu", value);
+    return write(buffer);
+}
+
+size_t Print::print(double value, int digits) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return write(buffer);
+}
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length && available() > 0) {
+        buffer[count++] = read();
+    }
+    return count;
+}
@@ -0,0 +1,97 @@
+// Simulated esp_timer: the callbacks run in a task at the priority of ESP-IDF's esp_timer task, which sleeps until
+// the earliest armed timer is due
+
+#include <vector>
+
+#include "esp_timer.h"
+#include "sim_internal.h"
+
+static const UBaseType_t ESP_TIMER_TASK_PRIORITY = 22;
+static const uint64_t MICROS_PER_TICK = 1000000 / configTICK_RATE_HZ;
+
+struct SimEspTimer {
+    esp_timer_cb_t callback;
+    void* arg;
+    bool armed;
+    uint64_t due_micros;
+    // 0 for a one-shot timer
+    uint64_t period_micros;
+};
+
+// Only touched from simulated tasks, which never run at the same time
+static std::vector<SimEspTimer*> timers;
+static TaskHandle_t timer_task = nullptr;
+
+static void runTimers(void* params) {
+    while (1) {
+        uint64_t now = simNowMicros();
+        uint64_t next = UINT64_MAX;
+        // By index: a callback may create timers
+        for (size_t i = 0; i < timers.size(); i++) {
+            SimEspTimer* timer = timers[i];
+            if (timer->armed && timer->due_micros <= now) {
+                if (timer->period_micros > 0) {
+                    // Like ESP-IDF, keep the schedule, but don't run a backlog of missed periods
+                    timer->due_micros += timer->period_micros;
+                    if (timer->due_micros <= now) {
+                        timer->due_micros = now + timer->period_micros;
+                    }
+                } else {
+                    timer->armed = false;
+                }
+                timer->callback(timer->arg);
+            }
+            if (timer->armed) {
+                next = std::min(next, timer->due_micros);
+            }
+        }
+        TickType_t ticks = next == UINT64_MAX ? portMAX_DELAY
+            : (TickType_t)((next - now + MICROS_PER_TICK - 1) / MICROS_PER_TICK);
+        // Woken early when a timer is started
+        xTaskNotifyWait(0, UINT32_MAX, nullptr, ticks);
+    }
+}
+
+static esp_err_t start(esp_timer_handle_t timer, uint64_t timeout_micros, uint64_t period_micros) {
+    if (timer == nullptr || timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->due_micros = simNowMicros() + timeout_micros;
+    timer->period_micros = period_micros;
+    xTaskNotify(timer_task, 0, eNoAction);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle) {
+    if (args == nullptr || args->callback == nullptr || handle == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer_task == nullptr) {
+        xTaskCreatePinnedToCore(runTimers, "esp_timer", 3584, nullptr, ESP_TIMER_TASK_PRIORITY, &timer_task, 0);
+    }
+    SimEspTimer* timer = new SimEspTimer{args->callback, args->arg, false, 0, 0};
+    timers.push_back(timer);
+    *handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_micros) {
+    return start(timer, timeout_micros, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_micros) {
+    return start(timer, period_micros, period_micros);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (timer == nullptr || !timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+    return simNowMicros();
+}
@@ -0,0 +1,179 @@
+// Flash partitions held in memory, laid out from the firmware's partition table
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "esp_partition.h"
+#include "sim.h"
+#include "sim_internal.h"
+
+static const size_t SECTOR_SIZE = 4096;
+// Typical for the ESP32's flash chips, during which both cores stall
+static const uint32_t SECTOR_ERASE_MICROS = 45000;
+static const size_t PAGE_SIZE = 256;
+static const uint32_t PAGE_PROGRAM_MICROS = 700;
+
+struct SimPartition {
+    esp_partition_t info;
+    std::vector<uint8_t> contents;
+};
+
+// Partitions are never removed once loaded, so the esp_partition_t pointers handed out stay valid
+static std::vector<SimPartition*> partitions;
+static std::atomic<uint32_t> write_count(0);
+
+static std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t\r");
+    size_t end = s.find_last_not_of(" \t\r");
+    return start == std::string::npos ? "" : s.substr(start, end - start + 1);
+}
+
+static bool parseSubtype(const std::string& name, int* subtype) {
+    static const struct {
+        const char* name;
+        int subtype;
+    } NAMES[] = {
+        {"factory", 0x00}, {"ota_0", 0x10}, {"ota_1", 0x11}, {"test", 0x20},
+        {"ota", 0x00}, {"phy", 0x01}, {"nvs", 0x02}, {"coredump", 0x03}, {"nvs_keys", 0x04}, {"fat", 0x81},
+        {"spiffs", 0x82},
+    };
+    for (const auto& entry : NAMES) {
+        if (name == entry.name) {
+            *subtype = entry.subtype;
+            return true;
+        }
+    }
+    char* end;
+    long value = strtol(name.c_str(), &end, 0);
+    if (name.empty() || *end != '\0') {
+        return false;
+    }
+    *subtype = value;
+    return true;
+}
+
+void simLoadPartitions(const char* path) {
+    std::ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "Can't open partition table %s\n", path);
+        abort();
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, ',')) {
+            fields.push_back(trim(field));
+        }
+        int subtype;
+        if (fields.size() < 5 || !parseSubtype(fields[2], &subtype)) {
+            fprintf(stderr, "Bad partition table line: %s\n", line.c_str());
+            abort();
+        }
+
+        SimPartition* partition = new SimPartition();
+        partition->info.type = fields[1] == "app" ? ESP_PARTITION_TYPE_APP : ESP_PARTITION_TYPE_DATA;
+        partition->info.subtype = subtype;
+        partition->info.address = strtoul(fields[3].c_str(), nullptr, 0);
+        partition->info.size = strtoul(fields[4].c_str(), nullptr, 0);
+        snprintf(partition->info.label, sizeof(partition->info.label), "%s", fields[0].c_str());
+        partition->info.encrypted = false;
+        // Flash starts out erased
+        partition->contents.assign(partition->info.size, 0xFF);
+        partitions.push_back(partition);
+    }
+}
+
+static SimPartition* find(const esp_partition_t* info) {
+    for (SimPartition* partition : partitions) {
+        if (&partition->info == info) {
+            return partition;
+        }
+    }
+    return nullptr;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label) {
+    for (SimPartition* partition : partitions) {
+        if (partition->info.type == type
+                && (subtype == ESP_PARTITION_SUBTYPE_ANY || partition->info.subtype == subtype)
+                && (label == nullptr || strcmp(partition->info.label, label) == 0)) {
+            return &partition->info;
+        }
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* info, size_t offset, size_t size) {
+    SimPartition* partition = find(info);
+    if (partition == nullptr || offset % SECTOR_SIZE != 0 || size % SECTOR_SIZE != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset + size > info->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memset(partition->contents.data() + offset, 0xFF, size);
+    write_count++;
+    simStallMicros(size / SECTOR_SIZE * SECTOR_ERASE_MICROS);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* info, size_t offset, const void* data, size_t size) {
+    SimPartition* partition = find(info);
+    if (partition == nullptr || data == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset + size > info->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // Programming can only clear bits
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        partition->contents[offset + i] &= bytes[i];
+    }
+    write_count++;
+    // Programmed a page at a time
+    size_t pages = size == 0 ? 0 : (offset + size - 1) / PAGE_SIZE - offset / PAGE_SIZE + 1;
+    simStallMicros(pages * PAGE_PROGRAM_MICROS);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* info, size_t offset, void* data, size_t size) {
+    SimPartition* partition = find(info);
+    if (partition == nullptr || data == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset + size > info->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(data, partition->contents.data() + offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t* info, size_t offset, size_t size,
+        spi_flash_mmap_memory_t memory, const void** out_ptr, spi_flash_mmap_handle_t* out_handle) {
+    SimPartition* partition = find(info);
+    if (partition == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset + size > info->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *out_ptr = partition->contents.data() + offset;
+    *out_handle = 0;
+    return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle) {}
+
+uint32_t Simulation::getFlashWriteCount() {
+    return write_count;
+}
@@ -0,0 +1,335 @@
+// Simulated peripherals: the MT6701 encoder on SPI, the empty I2C bus, the UART, the LED strip and the display panel
+
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "FastLED.h"
+#include "TFT_eSPI.h"
+#include "Wire.h"
+#include "driver/spi_master.h"
+#include "driver/uart.h"
+#include "sim.h"
+#include "sim_internal.h"
+
+TwoWire Wire;
+CFastLED FastLED;
+
+SimPlant& Simulation::plant() {
+    static SimPlant plant;
+    return plant;
+}
+
+// --- MT6701 over SPI ---
+
+struct SimSpiDevice {};
+
+static SimSpiDevice mt6701;
+
+// CRC-6 (polynomial x^6 + x + 1) over the 18 bits of angle and status, as computed by the sensor
+static uint8_t crc6(uint32_t data) {
+    uint8_t crc = 0;
+    for (int bit = 17; bit >= 0; bit--) {
+        uint8_t feedback = ((crc >> 5) ^ (data >> bit)) & 1;
+        crc = (crc << 1) & 0x3F;
+        if (feedback) {
+            crc ^= 0x03;
+        }
+    }
+    return crc;
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* config, int dma_channel) {
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* config, spi_device_handle_t* handle) {
+    *handle = &mt6701;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t* transaction) {
+    if (handle != &mt6701 || transaction == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // The encoder counts clockwise looking at the magnet, opposite to the knob's positive direction
+    double angle = fmod(-Simulation::plant().getAngle(), 2 * PI);
+    if (angle < 0) {
+        angle += 2 * PI;
+    }
+    uint32_t counts = (uint32_t)(angle / (2 * PI) * 16384) & 0x3FFF;
+    // Status bits: normal field strength, no push, no loss of track
+    uint32_t data = counts << 4;
+    uint32_t frame = (data << 6) | crc6(data);
+    transaction->rx_data[0] = (frame >> 16) & 0xFF;
+    transaction->rx_data[1] = (frame >> 8) & 0xFF;
+    transaction->rx_data[2] = frame & 0xFF;
+    return ESP_OK;
+}
+
+// --- UART0 ---
+
+struct SimUart {
+    int fd = -1;
+    QueueHandle_t events = nullptr;
+
+    // The harness's receiving thread and the tasks share the RX buffer
+    std::mutex rx_mutex;
+    std::vector<uint8_t> rx_buffer;
+    size_t rx_head = 0;
+    size_t rx_count = 0;
+
+    std::mutex tx_mutex;
+};
+
+static SimUart uart;
+
+void simSetSerialFd(int fd) {
+    uart.fd = fd;
+    if (fd >= 0) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+}
+
+// Stands in for the driver's RX interrupt: moves input into the RX buffer as it arrives and reports it on the event
+// queue. Runs on a thread of its own, outside the simulation, so input arrives whenever the other end sends it.
+static void receiveInput() {
+    while (true) {
+        struct pollfd poll_fd = {uart.fd, POLLIN, 0};
+        if (poll(&poll_fd, 1, -1) <= 0) {
+            continue;
+        }
+        ssize_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(uart.rx_mutex);
+            size_t size = uart.rx_buffer.size();
+            if (uart.rx_count < size) {
+                // Up to the end of the buffer; the rest on the next pass
+                size_t tail = (uart.rx_head + uart.rx_count) % size;
+                size_t space = tail >= uart.rx_head ? size - tail : uart.rx_head - tail;
+                count = ::read(uart.fd, &uart.rx_buffer[tail], space);
+                if (count > 0) {
+                    uart.rx_count += count;
+                }
+            }
+        }
+        if (count > 0) {
+            uart_event_t event = {UART_DATA, (size_t)count};
+            xQueueSendFromISR(uart.events, &event, nullptr);
+        } else {
+            // The buffer is full, or nobody has the other end open: wait rather than spin
+            usleep(10000);
+        }
+    }
+}
+
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t* config) {
+    return port == UART_NUM_0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_driver_install(uart_port_t port, int rx_buffer_size, int tx_buffer_size, int queue_size,
+        QueueHandle_t* queue, int intr_alloc_flags) {
+    if (port != UART_NUM_0 || uart.events != nullptr) {
+        return ESP_FAIL;
+    }
+    uart.rx_buffer.resize(rx_buffer_size);
+    uart.events = xQueueCreate(queue_size, sizeof(uart_event_t));
+    if (queue != nullptr) {
+        *queue = uart.events;
+    }
+    if (uart.fd >= 0) {
+        std::thread(receiveInput).detach();
+    }
+    return ESP_OK;
+}
+
+// Never waits: whatever has been received by now
+int uart_read_bytes(uart_port_t port, uint8_t* buffer, uint32_t length, TickType_t ticks) {
+    std::lock_guard<std::mutex> lock(uart.rx_mutex);
+    uint32_t count = 0;
+    while (count < length && uart.rx_count > 0) {
+        buffer[count++] = uart.rx_buffer[uart.rx_head];
+        uart.rx_head = (uart.rx_head + 1) % uart.rx_buffer.size();
+        uart.rx_count--;
+    }
+    return count;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t port, size_t* size) {
+    std::lock_guard<std::mutex> lock(uart.rx_mutex);
+    *size = uart.rx_count;
+    return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t port, const char* buffer, size_t size) {
+    std::lock_guard<std::mutex> lock(uart.tx_mutex);
+    if (uart.fd < 0) {
+        return size;
+    }
+    size_t written = 0;
+    while (written < size) {
+        ssize_t count = ::write(uart.fd, buffer + written, size - written);
+        if (count < 0 && errno != EAGAIN && errno != EINTR) {
+            // Reader went away; drop the output like an unconnected UART would
+            return size;
+        }
+        if (count <= 0) {
+            usleep(100);
+            continue;
+        }
+        written += count;
+    }
+    return size;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t port, TickType_t ticks) {
+    return ESP_OK;
+}
+
+// --- LEDs ---
+
+static std::mutex led_mutex;
+static const CRGB* registered_leds = nullptr;
+static uint16_t led_count = 0;
+static std::vector<CRGB> shown_leds;
+static std::atomic<uint32_t> led_show_count(0);
+
+void CFastLED::addLeds(CRGB* leds, int count) {
+    simRegisterLeds(leds, count);
+}
+
+void CFastLED::show() {
+    simShowLeds();
+}
+
+void simRegisterLeds(const CRGB* leds, uint16_t count) {
+    std::lock_guard<std::mutex> lock(led_mutex);
+    registered_leds = leds;
+    led_count = count;
+    shown_leds.assign(count, CRGB(0, 0, 0));
+}
+
+void simShowLeds() {
+    {
+        std::lock_guard<std::mutex> lock(led_mutex);
+        shown_leds.assign(registered_leds, registered_leds + led_count);
+    }
+    led_show_count++;
+}
+
+uint16_t Simulation::getLedCount() {
+    std::lock_guard<std::mutex> lock(led_mutex);
+    return led_count;
+}
+
+uint32_t Simulation::getLed(uint16_t index) {
+    std::lock_guard<std::mutex> lock(led_mutex);
+    if (index >= shown_leds.size()) {
+        return 0;
+    }
+    const CRGB& led = shown_leds[index];
+    return ((uint32_t)led.r << 16) | ((uint32_t)led.g << 8) | led.b;
+}
+
+uint32_t Simulation::getLedShowCount() {
+    return led_show_count;
+}
+
+// FastLED's "rainbow" mapping: the hue wheel is split into eight sections, with yellow given more room than in a
+// plain HSV spectrum. The library's optional green/blue weighting is left out.
+void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb) {
+    uint8_t hue = hsv.h;
+    uint8_t sat = hsv.s;
+    uint8_t val = hsv.v;
+
+    uint8_t offset = hue & 0x1F;
+    uint8_t offset8 = offset << 3;
+    uint8_t third = scale8(offset8, 85);
+
+    uint8_t r, g, b;
+    switch (hue >> 5) {
+        case 0: r = 255 - third; g = third; b = 0; break;
+        case 1: r = 171; g = 85 + third; b = 0; break;
+        case 2: {
+            uint8_t two_thirds = scale8(offset8, 170);
+            r = 171 - two_thirds; g = 170 + third; b = 0;
+            break;
+        }
+        case 3: r = 0; g = 255 - third; b = third; break;
+        case 4: {
+            uint8_t two_thirds = scale8(offset8, 170);
+            r = 0; g = 171 - two_thirds; b = 85 + two_thirds;
+            break;
+        }
+        case 5: r = third; g = 0; b = 255 - third; break;
+        case 6: r = 85 + third; g = 0; b = 171 - third; break;
+        default: r = 170 + third; g = 0; b = 85 - third; break;
+    }
+
+    if (sat != 255) {
+        if (sat == 0) {
+            r = g = b = 255;
+        } else {
+            uint8_t desat = 255 - sat;
+            desat = scale8_video(desat, desat);
+            uint8_t satscale = 255 - desat;
+            r = scale8(r, satscale) + desat;
+            g = scale8(g, satscale) + desat;
+            b = scale8(b, satscale) + desat;
+        }
+    }
+
+    if (val != 255) {
+        val = scale8_video(val, val);
+        r = scale8(r, val);
+        g = scale8(g, val);
+        b = scale8(b, val);
+    }
+
+    rgb = CRGB(r, g, b);
+}
+
+// --- Display ---
+
+static std::atomic<SoftwareCanvas*> display_panel(nullptr);
+static std::atomic<uint32_t> display_push_count(0);
+
+void simRegisterDisplay(SoftwareCanvas* panel) {
+    display_panel = panel;
+}
+
+void simCountDisplayPush() {
+    display_push_count++;
+}
+
+const SoftwareCanvas* Simulation::display() {
+    return display_panel;
+}
+
+uint32_t Simulation::getDisplayPushCount() {
+    return display_push_count;
+}
+
+void TFT_eSPI::begin() {
+    createSprite(panel_width_, panel_height_);
+    simRegisterDisplay(this);
+}
+
+void TFT_eSprite::pushSprite(int32_t x, int32_t y) {
+    pushSprite(x, y, 0, 0, width(), height());
+}
+
+bool TFT_eSprite::pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh) {
+    for (int32_t j = 0; j < sh; j++) {
+        for (int32_t i = 0; i < sw; i++) {
+            panel_->drawPixel(tx + i, ty + j, readPixel(sx + i, sy + j));
+        }
+    }
+    simCountDisplayPush();
+    return true;
+}
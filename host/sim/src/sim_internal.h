@@ -0,0 +1,25 @@
+#pragma once
+
+// Hooks between the simulated hardware and the harness, not visible to the firmware
+
+#include <stdint.h>
+
+class SoftwareCanvas;
+struct CRGB;
+
+// Virtual time
+uint64_t simNowMicros();
+// Lets a number of microseconds pass with the calling task keeping the CPU and nothing else running, like flash
+// operations on the ESP32, which stall both cores
+void simStallMicros(uint32_t micros);
+// Keeps the calling task busy for a number of microseconds of CPU time, like a busy-wait: higher priority tasks
+// preempt it, and tasks of the same priority take turns with it at each tick
+void simBusyMicros(uint32_t micros);
+
+void simSetSerialFd(int fd);
+void simLoadPartitions(const char* path);
+
+void simRegisterDisplay(SoftwareCanvas* panel);
+void simCountDisplayPush();
+void simRegisterLeds(const CRGB* leds, uint16_t count);
+void simShowLeds();
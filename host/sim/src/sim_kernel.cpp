@@ -0,0 +1,719 @@
+// Simulation kernel: FreeRTOS tasks, queues, semaphores and notifications on POSIX threads with a virtual clock.
+//
+// Exactly one task holds the (single, simulated) CPU at a time: the highest priority ready task, first come first
+// served within a priority. A task gives the CPU up when it blocks, yields, or wakes a higher priority task, and
+// the thread giving it up picks the next one. Code between kernel calls takes no virtual time (busy-waits aside, see
+// simBusyMicros), so when no task is ready, the clock jumps straight to the earliest timeout (or, when paced, waits
+// for the wall clock to catch up).
+// Scheduling is therefore deterministic for a given sequence of inputs.
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <pthread.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+#include "sim.h"
+#include "sim_freertos.h"
+#include "sim_internal.h"
+
+static const uint64_t NEVER = UINT64_MAX;
+static const uint64_t MICROS_PER_TICK = 1000000 / configTICK_RATE_HZ;
+// More than this many tasks waiting on one queue makes the wait list allocate
+static const size_t MAX_QUEUE_WAITERS = 8;
+
+struct SimTask {
+    enum class State {
+        READY,
+        RUNNING,
+        BLOCKED,
+        DELETED,
+    };
+
+    std::string name;
+    UBaseType_t priority;
+    BaseType_t core;
+    uint32_t stack_size;
+    TaskFunction_t function;
+    void* params;
+
+    State state = State::READY;
+    // Order in which ready tasks of the same priority get the CPU
+    uint64_t ready_order = 0;
+    std::condition_variable cv;
+
+    // While blocked: when to time out, when it blocked (tasks timing out together wake in that order, like on
+    // FreeRTOS's delayed list), and the wait list (if any) it's on
+    uint64_t wake_micros = NEVER;
+    uint64_t blocked_order = 0;
+    std::vector<SimTask*>* wait_list = nullptr;
+    bool timed_out = false;
+
+    uint32_t notify_value = 0;
+    bool notify_pending = false;
+    bool waiting_for_notify = false;
+
+    uint64_t wakes = 0;
+
+    clockid_t cpu_clock;
+    bool has_cpu_clock = false;
+};
+
+struct SimQueue {
+    uint32_t length;
+    uint32_t item_size;
+    std::vector<uint8_t> items;
+    uint32_t head = 0;
+    uint32_t count = 0;
+
+    std::vector<SimTask*> senders;
+    std::vector<SimTask*> receivers;
+};
+
+namespace {
+
+struct Kernel {
+    std::mutex mutex;
+    // Wakes the thread looking for something to run (external wake-ups, limit changes, wall clock pacing)
+    std::condition_variable idle_cv;
+    // Wakes harness threads waiting in runUntil()
+    std::condition_variable progress_cv;
+
+    std::vector<SimTask*> tasks;
+    SimTask* current = nullptr;
+    // Set while a thread is in dispatch(), i.e. responsible for finding the next task to run
+    bool dispatching = false;
+    bool paused = false;
+    uint64_t order = 0;
+
+    std::atomic<uint64_t> now{0};
+    uint64_t limit = 0;
+
+    double speed = 0;
+    std::chrono::steady_clock::time_point wall_anchor;
+    uint64_t virtual_anchor = 0;
+
+    std::recursive_mutex critical;
+};
+
+// Created on first use, since firmware objects with static storage create their queues and semaphores during static
+// initialization. Never destroyed: task threads may still be parked on it when the process exits.
+Kernel& kernel() {
+    static Kernel* instance = new Kernel();
+    return *instance;
+}
+
+thread_local SimTask* self_task = nullptr;
+
+SimTask* pickReady() {
+    SimTask* best = nullptr;
+    for (SimTask* task : kernel().tasks) {
+        if (task->state == SimTask::State::READY && (best == nullptr || task->priority > best->priority
+                || (task->priority == best->priority && task->ready_order < best->ready_order))) {
+            best = task;
+        }
+    }
+    return best;
+}
+
+uint64_t nextWake() {
+    uint64_t wake = NEVER;
+    for (SimTask* task : kernel().tasks) {
+        if (task->state == SimTask::State::BLOCKED) {
+            wake = std::min(wake, task->wake_micros);
+        }
+    }
+    return wake;
+}
+
+void makeReady(SimTask* task) {
+    if (task->wait_list != nullptr) {
+        task->wait_list->erase(std::find(task->wait_list->begin(), task->wait_list->end(), task));
+        task->wait_list = nullptr;
+    }
+    if (task->state == SimTask::State::BLOCKED) {
+        task->wakes++;
+    }
+    task->wake_micros = NEVER;
+    task->state = SimTask::State::READY;
+    task->ready_order = kernel().order++;
+}
+
+// Makes ready every blocked task whose timeout has come by the given time, in order of timeout and then of blocking
+void wakeTimedOut(uint64_t micros) {
+    while (true) {
+        SimTask* first = nullptr;
+        for (SimTask* task : kernel().tasks) {
+            if (task->state == SimTask::State::BLOCKED && task->wake_micros <= micros && (first == nullptr
+                    || task->wake_micros < first->wake_micros
+                    || (task->wake_micros == first->wake_micros && task->blocked_order < first->blocked_order))) {
+                first = task;
+            }
+        }
+        if (first == nullptr) {
+            return;
+        }
+        makeReady(first);
+        first->timed_out = true;
+    }
+}
+
+void resetPacing() {
+    kernel().wall_anchor = std::chrono::steady_clock::now();
+    kernel().virtual_anchor = kernel().now;
+}
+
+// Hands the CPU to the next task, advancing time as needed. Called with the lock held by a thread that has just
+// given up the CPU (or, at start, by the harness); returns once another task (possibly the caller's) is running.
+void dispatch(std::unique_lock<std::mutex>& lock) {
+    kernel().current = nullptr;
+    kernel().dispatching = true;
+    while (true) {
+        SimTask* next = pickReady();
+        if (next != nullptr) {
+            kernel().paused = false;
+            next->state = SimTask::State::RUNNING;
+            kernel().current = next;
+            kernel().dispatching = false;
+            next->cv.notify_one();
+            return;
+        }
+
+        uint64_t wake = nextWake();
+        if (wake == NEVER || wake > kernel().limit) {
+            // Nothing to do before the limit: let the clock reach it and wait for the harness (or, if every task
+            // is blocked indefinitely, for something outside the simulation to wake one)
+            if (kernel().limit != NEVER) {
+                kernel().now = std::max(kernel().now.load(), kernel().limit);
+            }
+            kernel().paused = true;
+            kernel().progress_cv.notify_all();
+            kernel().idle_cv.wait(lock);
+            continue;
+        }
+        if (kernel().speed > 0) {
+            auto due = kernel().wall_anchor + std::chrono::microseconds((int64_t)((wake - kernel().virtual_anchor) / kernel().speed));
+            if (std::chrono::steady_clock::now() < due) {
+                kernel().idle_cv.wait_until(lock, due);
+                continue;
+            }
+        }
+
+        kernel().now = wake;
+        wakeTimedOut(wake);
+    }
+}
+
+// Gives up the CPU and waits to get it back. The caller has already set its own state.
+void switchAway(std::unique_lock<std::mutex>& lock, SimTask* self) {
+    dispatch(lock);
+    self->cv.wait(lock, [self]() { return kernel().current == self; });
+}
+
+// Blocks the running task until made ready by someone else or until wake_micros; returns false on timeout
+bool block(std::unique_lock<std::mutex>& lock, std::vector<SimTask*>* wait_list, uint64_t wake_micros) {
+    SimTask* self = self_task;
+    assert("Blocking call outside a simulated task" && self != nullptr);
+    self->state = SimTask::State::BLOCKED;
+    self->wake_micros = wake_micros;
+    self->blocked_order = kernel().order++;
+    self->timed_out = false;
+    self->wait_list = wait_list;
+    if (wait_list != nullptr) {
+        wait_list->push_back(self);
+    }
+    switchAway(lock, self);
+    return !self->timed_out;
+}
+
+uint64_t ticksToWake(TickType_t ticks) {
+    if (ticks == portMAX_DELAY) {
+        return NEVER;
+    }
+    return (kernel().now / MICROS_PER_TICK + ticks) * MICROS_PER_TICK;
+}
+
+// After making tasks ready: lets a higher priority one take the CPU from the caller, or lets the idle dispatcher
+// know there's work (when called from outside the simulation)
+void reschedule(std::unique_lock<std::mutex>& lock) {
+    SimTask* self = self_task;
+    if (self != nullptr && kernel().current == self) {
+        SimTask* next = pickReady();
+        if (next != nullptr && next->priority > self->priority) {
+            self->state = SimTask::State::READY;
+            self->ready_order = kernel().order++;
+            switchAway(lock, self);
+        }
+    } else if (kernel().current == nullptr) {
+        kernel().idle_cv.notify_all();
+    }
+}
+
+void wakeFirst(std::vector<SimTask*>& wait_list) {
+    SimTask* best = nullptr;
+    for (SimTask* task : wait_list) {
+        if (best == nullptr || task->priority > best->priority) {
+            best = task;
+        }
+    }
+    if (best != nullptr) {
+        makeReady(best);
+    }
+}
+
+void taskEntry(SimTask* task) {
+    {
+        std::unique_lock<std::mutex> lock(kernel().mutex);
+        self_task = task;
+        task->has_cpu_clock = pthread_getcpuclockid(pthread_self(), &task->cpu_clock) == 0;
+        task->cv.wait(lock, [task]() { return kernel().current == task; });
+    }
+    task->function(task->params);
+    // FreeRTOS tasks must not return; treat it as deleting itself
+    vTaskDelete(nullptr);
+}
+
+SimQueue* createQueue(uint32_t length, uint32_t item_size, uint32_t initial_count) {
+    SimQueue* queue = new SimQueue();
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->items.resize((size_t)length * item_size);
+    queue->count = initial_count;
+    // Waiting on a queue mustn't allocate, as the firmware's tasks may not once set up (see heap_monitor.h)
+    queue->senders.reserve(MAX_QUEUE_WAITERS);
+    queue->receivers.reserve(MAX_QUEUE_WAITERS);
+    return queue;
+}
+
+BaseType_t queueSend(SimQueue* queue, const void* item, TickType_t ticks, bool overwrite) {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    uint64_t wake = ticksToWake(ticks);
+    while (true) {
+        if (queue->count < queue->length || overwrite) {
+            if (queue->count == queue->length) {
+                // Only used on length 1 queues: replace the item
+                queue->count--;
+            }
+            uint32_t tail = (queue->head + queue->count) % queue->length;
+            if (queue->item_size > 0) {
+                memcpy(&queue->items[(size_t)tail * queue->item_size], item, queue->item_size);
+            }
+            queue->count++;
+            wakeFirst(queue->receivers);
+            reschedule(lock);
+            return pdTRUE;
+        }
+        if (ticks == 0 || !block(lock, &queue->senders, wake)) {
+            return errQUEUE_FULL;
+        }
+    }
+}
+
+BaseType_t queueReceive(SimQueue* queue, void* item, TickType_t ticks, bool peek) {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    uint64_t wake = ticksToWake(ticks);
+    while (true) {
+        if (queue->count > 0) {
+            if (queue->item_size > 0) {
+                memcpy(item, &queue->items[(size_t)queue->head * queue->item_size], queue->item_size);
+            }
+            if (!peek) {
+                queue->head = (queue->head + 1) % queue->length;
+                queue->count--;
+                wakeFirst(queue->senders);
+                reschedule(lock);
+            }
+            return pdTRUE;
+        }
+        if (ticks == 0 || !block(lock, &queue->receivers, wake)) {
+            return errQUEUE_EMPTY;
+        }
+    }
+}
+
+BaseType_t notify(SimTask* task, uint32_t value, eNotifyAction action) {
+    bool was_pending = task->notify_pending;
+    switch (action) {
+        case eNoAction:
+            break;
+        case eSetBits:
+            task->notify_value |= value;
+            break;
+        case eIncrement:
+            task->notify_value++;
+            break;
+        case eSetValueWithOverwrite:
+            task->notify_value = value;
+            break;
+        case eSetValueWithoutOverwrite:
+            if (was_pending) {
+                return pdFAIL;
+            }
+            task->notify_value = value;
+            break;
+    }
+    task->notify_pending = true;
+    if (task->state == SimTask::State::BLOCKED && task->waiting_for_notify) {
+        makeReady(task);
+    }
+    return pdPASS;
+}
+
+}
+
+// --- Harness ---
+
+void Simulation::start(void (*setup)(), void (*loop)(), const SimOptions& options) {
+    simSetSerialFd(options.serial_fd);
+    if (!options.partitions_path.empty()) {
+        simLoadPartitions(options.partitions_path.c_str());
+    }
+
+    struct Sketch {
+        void (*setup)();
+        void (*loop)();
+    };
+    static Sketch sketch;
+    sketch = {setup, loop};
+
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    kernel().speed = options.speed;
+    kernel().limit = options.speed > 0 ? NEVER : 0;
+    resetPacing();
+    lock.unlock();
+
+    // Like the Arduino core's loopTask
+    xTaskCreatePinnedToCore([](void* params) {
+        Sketch* sketch = static_cast<Sketch*>(params);
+        sketch->setup();
+        while (1) {
+            sketch->loop();
+        }
+    }, "loopTask", 8192, &sketch, 1, nullptr, 1);
+
+    lock.lock();
+    if (kernel().current == nullptr && !kernel().dispatching) {
+        dispatch(lock);
+    }
+}
+
+void Simulation::runUntil(uint64_t micros) {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    kernel().limit = micros;
+    resetPacing();
+    kernel().paused = false;
+    kernel().idle_cv.notify_all();
+    kernel().progress_cv.wait(lock, [micros]() { return kernel().paused && kernel().now >= micros; });
+}
+
+void Simulation::runFor(uint64_t micros) {
+    runUntil(kernel().now + micros);
+}
+
+void Simulation::resume() {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    kernel().limit = NEVER;
+    resetPacing();
+    kernel().idle_cv.notify_all();
+}
+
+uint64_t Simulation::micros() {
+    return kernel().now;
+}
+
+void Simulation::setSpeed(double speed) {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    kernel().speed = speed;
+    resetPacing();
+    kernel().idle_cv.notify_all();
+}
+
+void Simulation::getTaskStats(std::vector<SimTaskStats>& stats) {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    stats.clear();
+    for (SimTask* task : kernel().tasks) {
+        double cpu_seconds = 0;
+        struct timespec time;
+        if (task->has_cpu_clock && clock_gettime(task->cpu_clock, &time) == 0) {
+            cpu_seconds = time.tv_sec + time.tv_nsec / 1e9;
+        }
+        stats.push_back({task->name, task->priority, cpu_seconds, task->wakes});
+    }
+}
+
+uint64_t simNowMicros() {
+    return kernel().now;
+}
+
+// Moves the clock forward with the caller keeping the CPU, making ready whatever timed out meanwhile
+static void advanceRunning(std::unique_lock<std::mutex>& lock, uint64_t until) {
+    if (kernel().speed > 0) {
+        auto due = kernel().wall_anchor + std::chrono::microseconds((int64_t)((until - kernel().virtual_anchor) / kernel().speed));
+        while (std::chrono::steady_clock::now() < due) {
+            kernel().idle_cv.wait_until(lock, due);
+        }
+    }
+    kernel().now = until;
+    wakeTimedOut(until);
+}
+
+void simStallMicros(uint32_t micros) {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    if (self_task == nullptr) {
+        return;
+    }
+    // Whatever timed out meanwhile only gets to run now
+    advanceRunning(lock, kernel().now + micros);
+    reschedule(lock);
+}
+
+void simBusyMicros(uint32_t micros) {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    SimTask* self = self_task;
+    if (self == nullptr) {
+        return;
+    }
+    uint64_t remaining = micros;
+    while (remaining > 0) {
+        // Spin up to the next point where another task could take the CPU: a timeout, or a tick
+        uint64_t next_tick = (kernel().now / MICROS_PER_TICK + 1) * MICROS_PER_TICK;
+        uint64_t until = std::min(kernel().now + remaining, std::min(next_tick, nextWake()));
+        remaining -= until - kernel().now;
+        advanceRunning(lock, until);
+
+        // Preempted by a higher priority task, and at a tick, the CPU goes round the tasks of the caller's priority
+        // (FreeRTOS time slicing)
+        SimTask* next = pickReady();
+        if (next != nullptr && (next->priority > self->priority
+                || (next->priority == self->priority && kernel().now % MICROS_PER_TICK == 0))) {
+            self->state = SimTask::State::READY;
+            self->ready_order = kernel().order++;
+            switchAway(lock, self);
+        }
+    }
+}
+
+// --- FreeRTOS API ---
+
+void vPortEnterCritical(portMUX_TYPE* mux) {
+    kernel().critical.lock();
+}
+
+void vPortExitCritical(portMUX_TYPE* mux) {
+    kernel().critical.unlock();
+}
+
+BaseType_t xPortInIsrContext() {
+    return self_task == nullptr;
+}
+
+BaseType_t xPortGetCoreID() {
+    return self_task == nullptr || self_task->core == tskNO_AFFINITY ? 0 : self_task->core;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_size, void* params,
+        UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    assert(priority < configMAX_PRIORITIES);
+    SimTask* task = new SimTask();
+    task->name = name;
+    task->priority = priority;
+    task->core = core;
+    task->stack_size = stack_size;
+    task->function = function;
+    task->params = params;
+
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    task->ready_order = kernel().order++;
+    kernel().tasks.push_back(task);
+    std::thread(taskEntry, task).detach();
+    if (handle != nullptr) {
+        *handle = task;
+    }
+    reschedule(lock);
+    return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_size,
+        void* params, UBaseType_t priority, StackType_t* stack, StaticTask_t* task_buffer, BaseType_t core) {
+    TaskHandle_t handle = nullptr;
+    xTaskCreatePinnedToCore(function, name, stack_size, params, priority, &handle, core);
+    return handle;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    SimTask* target = task == nullptr ? self_task : task;
+    if (target->wait_list != nullptr) {
+        target->wait_list->erase(std::find(target->wait_list->begin(), target->wait_list->end(), target));
+        target->wait_list = nullptr;
+    }
+    target->state = SimTask::State::DELETED;
+    if (target == self_task) {
+        dispatch(lock);
+        // Park the thread for good; the process exits without joining it
+        target->cv.wait(lock, []() { return false; });
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) {
+        taskYIELD();
+        return;
+    }
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    block(lock, nullptr, ticksToWake(ticks));
+}
+
+void vTaskDelayUntil(TickType_t* previous_wake, TickType_t increment) {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    TickType_t now = kernel().now / MICROS_PER_TICK;
+    TickType_t target = *previous_wake + increment;
+    *previous_wake = target;
+    // Only wait if the target is still ahead (allowing for tick count overflow, like FreeRTOS)
+    if ((int32_t)(target - now) > 0) {
+        block(lock, nullptr, (uint64_t)(kernel().now / MICROS_PER_TICK + (target - now)) * MICROS_PER_TICK);
+    }
+}
+
+void taskYIELD() {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    SimTask* self = self_task;
+    self->state = SimTask::State::READY;
+    self->ready_order = kernel().order++;
+    switchAway(lock, self);
+}
+
+TickType_t xTaskGetTickCount() {
+    return kernel().now / MICROS_PER_TICK;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return self_task;
+}
+
+const char* pcTaskGetTaskName(TaskHandle_t task) {
+    return (task == nullptr ? self_task : task)->name.c_str();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return (task == nullptr ? self_task : task)->stack_size;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    BaseType_t result = notify(task, value, action);
+    reschedule(lock);
+    return result;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t* higher_priority_task_woken) {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    BaseType_t result = notify(task, value, action);
+    if (higher_priority_task_woken != nullptr) {
+        *higher_priority_task_woken = kernel().current != nullptr && task->state == SimTask::State::READY
+            && task->priority > kernel().current->priority;
+    }
+    if (kernel().current == nullptr) {
+        kernel().idle_cv.notify_all();
+    }
+    return result;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t* value, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    SimTask* self = self_task;
+    if (!self->notify_pending) {
+        self->notify_value &= ~clear_on_entry;
+        if (ticks > 0) {
+            self->waiting_for_notify = true;
+            block(lock, nullptr, ticksToWake(ticks));
+            self->waiting_for_notify = false;
+        }
+    }
+    if (value != nullptr) {
+        *value = self->notify_value;
+    }
+    if (!self->notify_pending) {
+        return pdFALSE;
+    }
+    self->notify_value &= ~clear_on_exit;
+    self->notify_pending = false;
+    return pdTRUE;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    return createQueue(length, item_size, 0);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    return queueSend(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* higher_priority_task_woken) {
+    if (higher_priority_task_woken != nullptr) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+    return queueSend(queue, item, 0, false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void* item) {
+    return queueSend(queue, item, 0, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    return queueReceive(queue, item, ticks, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t ticks) {
+    return queueReceive(queue, item, ticks, true);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::unique_lock<std::mutex> lock(kernel().mutex);
+    return queue->count;
+}
+
+// Semaphores are queues of zero-size items, like in FreeRTOS: giving sends, taking receives. Mutexes don't model
+// priority inheritance.
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return createQueue(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return createQueue(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    return createQueue(max_count, 0, initial_count);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    return queueReceive(semaphore, nullptr, ticks, false);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    return queueSend(semaphore, nullptr, 0, false);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* higher_priority_task_woken) {
+    if (higher_priority_task_woken != nullptr) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+    return queueSend(semaphore, nullptr, 0, false);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <math.h>
+
+#include "sim_internal.h"
+#include "sim_plant.h"
+
+// Below this speed (rad/s) the rotor is considered to be at rest, so Coulomb friction can hold it
+static const double STICTION_VELOCITY = 1e-3;
+
+SimPlant::SimPlant(const SimPlantParams& params) : params_(params) {}
+
+void SimPlant::setVoltage(float voltage_q) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    advance();
+    voltage_q_ = voltage_q;
+}
+
+float SimPlant::getVoltage() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return voltage_q_;
+}
+
+float SimPlant::getAngle() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    advance();
+    return angle_;
+}
+
+float SimPlant::getVelocity() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    advance();
+    return velocity_;
+}
+
+void SimPlant::grab(float stiffness, float damping) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    advance();
+    holding_ = true;
+    hand_stiffness_ = stiffness;
+    hand_damping_ = damping;
+    hand_from_ = angle_;
+    hand_to_ = angle_;
+    hand_start_micros_ = time_micros_;
+    hand_end_micros_ = time_micros_;
+}
+
+void SimPlant::turnTo(float angle, uint64_t duration_micros) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    advance();
+    hand_from_ = handAngle(time_micros_);
+    hand_to_ = angle;
+    hand_start_micros_ = time_micros_;
+    hand_end_micros_ = time_micros_ + duration_micros;
+}
+
+void SimPlant::release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    advance();
+    holding_ = false;
+}
+
+double SimPlant::handAngle(uint64_t micros) const {
+    if (micros >= hand_end_micros_) {
+        return hand_to_;
+    }
+    double progress = (double)(micros - hand_start_micros_) / (hand_end_micros_ - hand_start_micros_);
+    return hand_from_ + (hand_to_ - hand_from_) * progress;
+}
+
+void SimPlant::advance() {
+    uint64_t now = simNowMicros();
+    while (time_micros_ < now) {
+        uint32_t step = (uint32_t)std::min<uint64_t>(STEP_MICROS, now - time_micros_);
+        double dt = step * 1e-6;
+
+        // Voltage mode: the current follows the applied voltage less back-EMF (winding inductance is neglected)
+        double current = (voltage_q_ - params_.torque_constant * velocity_) / params_.resistance;
+        double torque = params_.torque_constant * current - params_.viscous_friction * velocity_;
+        if (holding_) {
+            double hand_velocity = 0;
+            if (time_micros_ < hand_end_micros_) {
+                hand_velocity = (hand_to_ - hand_from_) / ((hand_end_micros_ - hand_start_micros_) * 1e-6);
+            }
+            torque += hand_stiffness_ * (handAngle(time_micros_) - angle_) + hand_damping_ * (hand_velocity - velocity_);
+        }
+
+        if (fabs(velocity_) < STICTION_VELOCITY && fabs(torque) <= params_.coulomb_friction) {
+            velocity_ = 0;
+        } else {
+            double direction = fabs(velocity_) < STICTION_VELOCITY ? (torque > 0 ? 1 : -1) : (velocity_ > 0 ? 1 : -1);
+            double previous_velocity = velocity_;
+            velocity_ += (torque - direction * params_.coulomb_friction) / params_.inertia * dt;
+            // Friction can stop the rotor but never reverse it
+            if (previous_velocity != 0 && (velocity_ > 0) != (previous_velocity > 0)) {
+                velocity_ = 0;
+            }
+            angle_ += velocity_ * dt;
+        }
+        time_micros_ += step;
+    }
+}
@@ -0,0 +1,240 @@
+#include "SimpleFOC.h"
+#include "sim.h"
+
+float _normalizeAngle(float angle) {
+    float a = fmod(angle, _2PI);
+    return a >= 0 ? a : (a + _2PI);
+}
+
+unsigned long _micros() {
+    return micros();
+}
+
+// --- PIDController ---
+
+PIDController::PIDController(float P, float I, float D, float ramp, float limit) :
+        P(P), I(I), D(D), output_ramp(ramp), limit(limit) {
+    timestamp_prev = _micros();
+}
+
+float PIDController::operator()(float error) {
+    unsigned long timestamp_now = _micros();
+    float Ts = (timestamp_now - timestamp_prev) * 1e-6f;
+    // Quick fix for strange cases (micros overflow or a first call long after construction)
+    if (Ts <= 0 || Ts > 0.5f) {
+        Ts = 1e-3f;
+    }
+
+    float proportional = P * error;
+    // Tustin transform of the integral part
+    float integral = integral_prev + I * Ts * 0.5f * (error + error_prev);
+    integral = _constrain(integral, -limit, limit);
+    float derivative = D * (error - error_prev) / Ts;
+
+    float output = proportional + integral + derivative;
+    output = _constrain(output, -limit, limit);
+
+    if (output_ramp > 0) {
+        float output_rate = (output - output_prev) / Ts;
+        if (output_rate > output_ramp) {
+            output = output_prev + output_ramp * Ts;
+        } else if (output_rate < -output_ramp) {
+            output = output_prev - output_ramp * Ts;
+        }
+    }
+    integral_prev = integral;
+    output_prev = output;
+    error_prev = error;
+    timestamp_prev = timestamp_now;
+    return output;
+}
+
+// --- LowPassFilter ---
+
+LowPassFilter::LowPassFilter(float time_constant) : Tf(time_constant) {
+    timestamp_prev = _micros();
+}
+
+float LowPassFilter::operator()(float x) {
+    unsigned long timestamp = _micros();
+    float dt = (timestamp - timestamp_prev) * 1e-6f;
+
+    if (dt < 0.0f) {
+        dt = 1e-3f;
+    } else if (dt > 0.3f) {
+        y_prev = x;
+        timestamp_prev = timestamp;
+        return x;
+    }
+
+    float alpha = Tf / (Tf + dt);
+    float y = alpha * y_prev + (1.0f - alpha) * x;
+    y_prev = y;
+    timestamp_prev = timestamp;
+    return y;
+}
+
+// --- Sensor ---
+
+void Sensor::update() {
+    float val = getSensorAngle();
+    angle_prev_ts = _micros();
+    float d_angle = val - angle_prev;
+    // A jump of more than 80% of a turn is taken as a wrap around
+    if (fabs(d_angle) > (0.8f * _2PI)) {
+        full_rotations += (d_angle > 0) ? -1 : 1;
+    }
+    angle_prev = val;
+}
+
+float Sensor::getVelocity() {
+    float Ts = (angle_prev_ts - vel_angle_prev_ts) * 1e-6f;
+    if (Ts < min_elapsed_time) {
+        return velocity;
+    }
+    velocity = ((float)(full_rotations - vel_full_rotations) * _2PI + (angle_prev - vel_angle_prev)) / Ts;
+    vel_angle_prev = angle_prev;
+    vel_full_rotations = full_rotations;
+    vel_angle_prev_ts = angle_prev_ts;
+    return velocity;
+}
+
+void Sensor::init() {
+    getSensorAngle();
+    delayMicroseconds(1);
+    vel_angle_prev = getSensorAngle();
+    vel_angle_prev_ts = _micros();
+    delay(1);
+    getSensorAngle();
+    delayMicroseconds(1);
+    angle_prev = getSensorAngle();
+    angle_prev_ts = _micros();
+}
+
+float Sensor::getMechanicalAngle() {
+    return angle_prev;
+}
+
+float Sensor::getAngle() {
+    return (float)full_rotations * _2PI + angle_prev;
+}
+
+double Sensor::getPreciseAngle() {
+    return (double)full_rotations * (double)_2PI + (double)angle_prev;
+}
+
+int32_t Sensor::getFullRotations() {
+    return full_rotations;
+}
+
+// --- BLDCDriver6PWM ---
+
+int BLDCDriver6PWM::init() {
+    if (voltage_limit == NOT_SET || voltage_limit > voltage_power_supply) {
+        voltage_limit = voltage_power_supply;
+    }
+    return 1;
+}
+
+void BLDCDriver6PWM::disable() {
+    Simulation::plant().setVoltage(0);
+}
+
+void BLDCDriver6PWM::setPhaseVoltage(float voltage_q, float voltage_d, float angle_electrical) {
+    Simulation::plant().setVoltage(_constrain(voltage_q, -voltage_limit, voltage_limit));
+}
+
+// --- BLDCMotor ---
+
+BLDCMotor::BLDCMotor(int pole_pairs) : pole_pairs(pole_pairs) {}
+
+void BLDCMotor::linkDriver(BLDCDriver* driver) {
+    this->driver = driver;
+}
+
+void BLDCMotor::linkSensor(Sensor* sensor) {
+    this->sensor = sensor;
+}
+
+void BLDCMotor::init() {
+    if (driver != nullptr && voltage_limit > driver->voltage_limit) {
+        voltage_limit = driver->voltage_limit;
+    }
+    P_angle.limit = velocity_limit;
+    delay(500);
+}
+
+int BLDCMotor::initFOC(float zero_electric_offset, Direction sensor_direction) {
+    // The plant needs no alignment, so the offset and direction are taken as given (or left as they were)
+    if (zero_electric_offset != NOT_SET) {
+        zero_electric_angle = zero_electric_offset;
+        this->sensor_direction = sensor_direction;
+    }
+    if (sensor != nullptr) {
+        sensor->update();
+        shaft_angle = shaftAngle();
+    }
+    return 1;
+}
+
+float BLDCMotor::shaftAngle() {
+    if (sensor == nullptr) {
+        return shaft_angle;
+    }
+    return sensor_direction * LPF_angle(sensor->getAngle());
+}
+
+float BLDCMotor::shaftVelocity() {
+    if (sensor == nullptr) {
+        return shaft_velocity;
+    }
+    return sensor_direction * LPF_velocity(sensor->getVelocity());
+}
+
+void BLDCMotor::loopFOC() {
+    if (sensor != nullptr) {
+        sensor->update();
+    }
+    if (controller == MotionControlType::velocity_openloop || controller == MotionControlType::angle_openloop) {
+        return;
+    }
+    // With ideal commutation the q-axis voltage always produces torque along the shaft angle, so it's handed to the
+    // plant in the sensor's frame instead of being turned into phase voltages at the electrical angle
+    if (driver != nullptr) {
+        driver->setPhaseVoltage(sensor_direction * voltage.q, voltage.d, 0);
+    }
+}
+
+void BLDCMotor::move(float new_target) {
+    if (controller != MotionControlType::velocity_openloop && controller != MotionControlType::angle_openloop) {
+        shaft_angle = shaftAngle();
+    }
+    shaft_velocity = shaftVelocity();
+    if (new_target != NOT_SET) {
+        target = new_target;
+    }
+
+    switch (controller) {
+        case MotionControlType::torque:
+            // Voltage mode without a phase resistance or current sense: the target is the q-axis voltage
+            voltage.q = target;
+            voltage.d = 0;
+            break;
+        case MotionControlType::angle: {
+            float shaft_velocity_sp = P_angle(target - shaft_angle);
+            voltage.q = PID_velocity(shaft_velocity_sp - shaft_velocity);
+            voltage.d = 0;
+            break;
+        }
+        case MotionControlType::velocity:
+            voltage.q = PID_velocity(target - shaft_velocity);
+            voltage.d = 0;
+            break;
+        case MotionControlType::velocity_openloop:
+        case MotionControlType::angle_openloop:
+            // Only used by the interactive calibration, which the simulation doesn't support
+            voltage.q = 0;
+            voltage.d = 0;
+            break;
+    }
+}
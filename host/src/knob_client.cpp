@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+#include <vector>
+
+#include "knob_client.h"
+
+// Bounds the text passthrough buffer if the firmware prints a lot between frames
+static const size_t MAX_PENDING = 4096;
+
+static int64_t nowMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool isText(const std::string& bytes) {
+    for (char c : bytes) {
+        if ((c < 0x20 || c > 0x7E) && c != '\r' && c != '\n' && c != '\t') {
+            return false;
+        }
+    }
+    return !bytes.empty();
+}
+
+KnobClient::KnobClient(SerialPort& port) : port_(port) {}
+
+bool KnobClient::ping(AckStatus& status, int timeout_millis) {
+    return request(MessageId::PING, nullptr, 0, status, timeout_millis);
+}
+
+bool KnobClient::setConfig(const KnobConfig& config, AckStatus& status, int timeout_millis) {
+    uint8_t body[PROTOCOL_MAX_BODY];
+    size_t length = encodeConfig(config, body, sizeof(body));
+    return length > 0 && request(MessageId::SET_CONFIG, body, length, status, timeout_millis);
+}
+
+bool KnobClient::sendCommand(CommandId command, AckStatus& status, int timeout_millis) {
+    uint8_t body[1] = {(uint8_t)command};
+    return request(MessageId::COMMAND, body, sizeof(body), status, timeout_millis);
+}
+
+bool KnobClient::setStream(const StreamMessage& stream, AckStatus& status, int timeout_millis) {
+    uint8_t body[PROTOCOL_MAX_BODY];
+    size_t length = encodeStream(stream, body, sizeof(body));
+    return length > 0 && request(MessageId::SET_STREAM, body, length, status, timeout_millis);
+}
+
+bool KnobClient::selectConfig(uint32_t id, AckStatus& status, int timeout_millis) {
+    uint8_t body[4];
+    PayloadWriter writer(body, sizeof(body));
+    writer.u32(id);
+    return request(MessageId::SELECT_CONFIG, body, writer.getLength(), status, timeout_millis);
+}
+
+bool KnobClient::getLatency(std::vector<LatencyMessage>& latencies, bool reset, AckStatus& status, int timeout_millis) {
+    uint8_t body[1] = {(uint8_t)(reset ? 1 : 0)};
+    latencies.clear();
+    latencies_ = &latencies;
+    bool acked = request(MessageId::GET_LATENCY, body, sizeof(body), status, timeout_millis);
+    latencies_ = nullptr;
+    return acked;
+}
+
+bool KnobClient::getRecording(FlightRecording& recording, bool clear, AckStatus& status, int timeout_millis) {
+    uint8_t body[1] = {(uint8_t)(clear ? 1 : 0)};
+    recording = {};
+    recording_ = &recording;
+    bool acked = request(MessageId::GET_RECORDING, body, sizeof(body), status, timeout_millis);
+    recording_ = nullptr;
+    return acked;
+}
+
+bool KnobClient::uploadConfigLibrary(const ConfigRecord* records, uint32_t count, AckStatus& status, int timeout_millis) {
+    std::vector<uint8_t> image(sizeof(ConfigLibraryHeader) + count * sizeof(ConfigRecord));
+    size_t size = ConfigLibrary::build(records, count, image.data(), image.size());
+    if (size == 0) {
+        return false;
+    }
+
+    uint8_t body[PROTOCOL_MAX_BODY];
+    PayloadWriter begin(body, sizeof(body));
+    begin.u32(size);
+    if (!request(MessageId::LIBRARY_BEGIN, body, begin.getLength(), status, timeout_millis)) {
+        return false;
+    }
+    if (status != AckStatus::OK) {
+        return true;
+    }
+
+    for (size_t offset = 0; offset < size; offset += PROTOCOL_MAX_LIBRARY_CHUNK) {
+        size_t length = std::min(size - offset, PROTOCOL_MAX_LIBRARY_CHUNK);
+        PayloadWriter writer(body, sizeof(body));
+        writer.u32(offset);
+        memcpy(body + writer.getLength(), image.data() + offset, length);
+        if (!request(MessageId::LIBRARY_WRITE, body, writer.getLength() + length, status, timeout_millis)) {
+            return false;
+        }
+        if (status != AckStatus::OK) {
+            return true;
+        }
+    }
+    return request(MessageId::LIBRARY_COMMIT, nullptr, 0, status, timeout_millis);
+}
+
+bool KnobClient::poll(int timeout_millis) {
+    uint8_t buffer[256];
+    int count = port_.read(buffer, sizeof(buffer), timeout_millis);
+    if (count < 0) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        handleByte(buffer[i]);
+    }
+    return true;
+}
+
+bool KnobClient::request(MessageId id, const uint8_t* body, size_t body_length, AckStatus& status, int timeout_millis) {
+    uint8_t frame[PROTOCOL_MAX_FRAME];
+    uint8_t sequence = sequence_++;
+    size_t length = encodeFrame(id, sequence, body, body_length, frame, sizeof(frame));
+    if (length == 0 || !port_.write(frame, length)) {
+        return false;
+    }
+
+    awaiting_ack_ = true;
+    awaited_sequence_ = sequence;
+    ack_received_ = false;
+    int64_t deadline = nowMillis() + timeout_millis;
+    while (!ack_received_) {
+        int64_t remaining = deadline - nowMillis();
+        if (remaining <= 0 || !poll((int)remaining)) {
+            break;
+        }
+    }
+    awaiting_ack_ = false;
+
+    if (ack_received_) {
+        status = ack_.status;
+    }
+    return ack_received_;
+}
+
+void KnobClient::handleByte(uint8_t byte) {
+    uint32_t rejected = decoder_.getRejectedCount();
+    if (decoder_.feed(byte)) {
+        pending_.clear();
+        handleFrame();
+        return;
+    }
+    if (byte != 0) {
+        if (pending_.size() < MAX_PENDING) {
+            pending_.push_back((char)byte);
+        }
+        return;
+    }
+
+    // A rejected frame that's printable was most likely text from the firmware
+    if (decoder_.getRejectedCount() != rejected && isText(pending_) && on_text) {
+        on_text(pending_);
+    }
+    pending_.clear();
+}
+
+void KnobClient::handleFrame() {
+    const uint8_t* body = decoder_.getBody();
+    size_t length = decoder_.getBodyLength();
+    switch (decoder_.getId()) {
+        case MessageId::ACK: {
+            AckMessage ack;
+            if (decodeAck(body, length, ack) && awaiting_ack_ && ack.sequence == awaited_sequence_) {
+                ack_ = ack;
+                ack_received_ = true;
+            }
+            break;
+        }
+        case MessageId::STATE: {
+            StateMessage state;
+            if (decodeState(body, length, state) && on_state) {
+                on_state(state);
+            }
+            break;
+        }
+        case MessageId::TELEMETRY: {
+            TelemetryMessage telemetry;
+            if (decodeTelemetry(body, length, telemetry) && on_telemetry) {
+                on_telemetry(telemetry);
+            }
+            break;
+        }
+        case MessageId::LATENCY: {
+            LatencyMessage latency;
+            if (decodeLatency(body, length, latency) && latencies_ != nullptr) {
+                latencies_->push_back(latency);
+            }
+            break;
+        }
+        case MessageId::RECORDING: {
+            RecordingMessage message;
+            // Messages arrive in order; one out of place means a frame was lost, so skip it rather than misplace it
+            if (decodeRecording(body, length, message) && recording_ != nullptr && message.first == recording_->records.size()) {
+                recording_->reason = message.reason;
+                recording_->freeze_millis = message.freeze_millis;
+                recording_->records.insert(recording_->records.end(), message.records, message.records + message.count);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
@@ -0,0 +1,62 @@
+#include "rgb_image.h"
+
+#include <png.h>
+#include <string.h>
+
+RgbImage RgbImage::fromCanvas(const SoftwareCanvas& canvas) {
+    RgbImage image;
+    image.width = canvas.width();
+    image.height = canvas.height();
+    image.pixels.reserve((size_t)image.width * image.height * 3);
+    for (int32_t y = 0; y < image.height; y++) {
+        for (int32_t x = 0; x < image.width; x++) {
+            uint16_t pixel = canvas.readPixel(x, y);
+            image.pixels.push_back(((pixel >> 11) & 0x1F) * 255 / 31);
+            image.pixels.push_back(((pixel >> 5) & 0x3F) * 255 / 63);
+            image.pixels.push_back((pixel & 0x1F) * 255 / 31);
+        }
+    }
+    return image;
+}
+
+bool RgbImage::readPng(const char* path) {
+    png_image png;
+    memset(&png, 0, sizeof(png));
+    png.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&png, path)) {
+        return false;
+    }
+    png.format = PNG_FORMAT_RGB;
+    std::vector<uint8_t> data(PNG_IMAGE_SIZE(png));
+    if (!png_image_finish_read(&png, nullptr, data.data(), 0, nullptr)) {
+        png_image_free(&png);
+        return false;
+    }
+    width = png.width;
+    height = png.height;
+    pixels.swap(data);
+    return true;
+}
+
+bool RgbImage::writePng(const char* path) const {
+    png_image png;
+    memset(&png, 0, sizeof(png));
+    png.version = PNG_IMAGE_VERSION;
+    png.width = width;
+    png.height = height;
+    png.format = PNG_FORMAT_RGB;
+    return png_image_write_to_file(&png, path, 0, pixels.data(), 0, nullptr) != 0;
+}
+
+uint32_t RgbImage::countDifferences(const RgbImage& other) const {
+    if (width != other.width || height != other.height) {
+        return (uint32_t)std::max(width * height, other.width * other.height);
+    }
+    uint32_t differences = 0;
+    for (size_t i = 0; i < pixels.size(); i += 3) {
+        if (memcmp(&pixels[i], &other.pixels[i], 3) != 0) {
+            differences++;
+        }
+    }
+    return differences;
+}
@@ -0,0 +1,101 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "serial_port.h"
+
+static speed_t toSpeed(uint32_t baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+#ifdef B921600
+        case 921600: return B921600;
+#endif
+        default: return B0;
+    }
+}
+
+SerialPort::SerialPort() {}
+
+SerialPort::~SerialPort() {
+    close();
+}
+
+bool SerialPort::open(const char* path, uint32_t baud) {
+    close();
+    speed_t speed = toSpeed(baud);
+    if (speed == B0) {
+        return false;
+    }
+
+    fd_ = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    struct termios tty;
+    if (tcgetattr(fd_, &tty) != 0) {
+        close();
+        return false;
+    }
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cflag &= ~CRTSCTS;
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+    if (tcsetattr(fd_, TCSANOW, &tty) != 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SerialPort::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+int SerialPort::read(uint8_t* buffer, size_t size, int timeout_millis) {
+    struct pollfd pfd = {};
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    int ready = poll(&pfd, 1, timeout_millis);
+    if (ready < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    if (ready == 0) {
+        return 0;
+    }
+    ssize_t count = ::read(fd_, buffer, size);
+    if (count < 0) {
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    }
+    return (int)count;
+}
+
+bool SerialPort::write(const uint8_t* data, size_t length) {
+    while (length > 0) {
+        ssize_t count = ::write(fd_, data, length);
+        if (count < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                struct pollfd pfd = {};
+                pfd.fd = fd_;
+                pfd.events = POLLOUT;
+                poll(&pfd, 1, 100);
+                continue;
+            }
+            return false;
+        }
+        data += count;
+        length -= count;
+    }
+    return true;
+}
@@ -0,0 +1,398 @@
+// Equivalence test and benchmark for the motor loop's detent math (see firmware/src/detent_math.h): drives the float
+// and fixed point DetentTrackers in lockstep through the same simulated hand (turns, pushes against endstops, rests
+// and sensor noise) for each built-in kind of config, alongside a double precision tracker as the exact answer, then
+// times both.
+//
+// Both must stay within a tolerance of the exact answer throughout, on both the position and the detent error, and so
+// agree with each other. A knob within the tolerance of a snap point may legitimately snap in one tracker and not
+// another, and one resting at the limit of idle correction may have its detent center corrected in one and not
+// another. Those ties are counted, and the tracker is put back on the exact one's detent. The host's FPU is nothing
+// like the ESP32's, so the timings are only a relative guide.
+//
+// Then a soak: the knob spun steadily through millions of detents, hundreds of thousands of turns from where it
+// started, where a detent center kept as a plain float angle (as motor.shaft_angle is) would long since have lost all
+// its precision. The exact answer there is the starting center plus a whole number of detent widths, so the soak
+// steers clear of snap points and expects no ties at all. The old plain float math is run alongside for comparison.
+//
+// Exits non-zero if either strays.
+//
+// Usage: sk_detent_bench [seconds_per_config] [seed] [soak_detents]
+
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "detent_math.h"
+
+static const float LOOP_HZ = 1000;
+// Well below anything the torque controller could feel (about one count of a 14 bit angle sensor)...
+static const float ERROR_TOLERANCE_RAD = 0.0005;
+// ...plus a few roundings of the error itself, which is far from small when the knob is pushed turns past an endstop
+static const float ERROR_TOLERANCE_RELATIVE = 1.0f / (1 << 20);
+// Within FixedDetentMath's range of 128 turns between the knob and the detent center, even pushed past an endstop
+static const double MAX_TURNS = 100;
+static const double TURN_RADIANS = KNOB_TURN_RADIANS;
+// For the soak: how close the knob may come to a snap point (so there are no ties), and how far the error may stray
+// from the exact answer, however far the knob has been turned
+static const double SOAK_SNAP_CLEARANCE_RAD = 0.0001;
+static const double SOAK_ERROR_TOLERANCE_RAD = 0.00001;
+// Loop iterations the knob must rest before the center is corrected, as in MotorTask
+static const uint32_t IDLE_CORRECTION_DELAY_STEPS = 500;
+
+struct Scenario {
+    const char* name;
+    KnobConfig config;
+};
+
+static KnobConfig makeConfig(int32_t num_positions, int32_t position, float width_degrees, float snap_point) {
+    KnobConfig config = {};
+    config.num_positions = num_positions;
+    config.position = position;
+    config.position_width_radians = width_degrees * M_PI / 180;
+    config.snap_point = snap_point;
+    return config;
+}
+
+struct Step {
+    double angle;
+    KnobAngle knob;
+    bool idle;
+};
+
+// As the sensor would report angle
+static KnobAngle toKnobAngle(double angle) {
+    double turns = floor(angle / TURN_RADIANS);
+    return makeKnobAngle((int32_t)turns, (float)(angle - turns * TURN_RADIANS));
+}
+
+static Step makeStep(double angle, bool idle) {
+    Step s = {angle, toKnobAngle(angle), idle};
+    return s;
+}
+
+// A hand turning the knob: alternating turns at random speeds (up to where MotorTask stops applying torque) and rests,
+// with sensor noise throughout. The hand ignores the detents (there's no motor here), so in bounded configs it pushes
+// on well past the endstops. Wanders over up to MAX_TURNS in either direction.
+static std::vector<Step> makeTrajectory(uint32_t steps, std::mt19937& random) {
+    std::uniform_real_distribution<float> speed(-40, 40);
+    std::uniform_real_distribution<float> noise(-0.002, 0.002);
+    std::uniform_int_distribution<uint32_t> segment(50, 2000);
+
+    std::vector<Step> trajectory;
+    trajectory.reserve(steps);
+    double angle = 0;
+    while (trajectory.size() < steps) {
+        bool idle = random() % 3 == 0;
+        float velocity = idle ? 0 : speed(random);
+        // Turn back toward the middle
+        if (fabs(angle) > MAX_TURNS * 2 * M_PI * 0.9 && velocity * angle > 0) {
+            velocity = -velocity;
+        }
+        uint32_t length = segment(random);
+        for (uint32_t i = 0; i < length && trajectory.size() < steps; i++) {
+            angle += velocity / LOOP_HZ;
+            trajectory.push_back(makeStep(angle + noise(random), idle && i >= IDLE_CORRECTION_DELAY_STEPS));
+        }
+    }
+    return trajectory;
+}
+
+template<typename Math>
+static void step(DetentTracker<Math>& tracker, KnobConfig& config, const Step& step, DetentError& error) {
+    if (step.idle) {
+        tracker.correctIdle(step.knob);
+    }
+    error = tracker.update(step.knob, config);
+}
+
+// Double precision radians, for the exact answer
+struct DoubleDetentMath {
+    typedef double Angle;
+    typedef double Delta;
+    typedef double Fraction;
+
+    static Angle fromKnobAngle(const KnobAngle& angle) { return angle.turns * TURN_RADIANS + angle.radians; }
+    static Delta deltaFromRadians(float radians) { return radians; }
+    static float toRadians(Delta delta) { return delta; }
+    static Fraction fraction(float value) { return value; }
+
+    static Delta difference(Angle a, Angle b) { return a - b; }
+    static Angle offset(Angle angle, Delta delta) { return angle + delta; }
+    static Delta scale(Delta delta, Fraction fraction) { return delta * fraction; }
+    static Delta abs(Delta delta) { return fabs(delta); }
+};
+
+// A tracker run in lockstep with the exact one, and how far it strays from it
+template<typename Math>
+struct Follower {
+    DetentTracker<Math> tracker;
+    KnobConfig config;
+    DetentError error;
+    // Whether the last step was within the tolerance of the exact answer
+    bool accurate = true;
+
+    uint32_t ties = 0;
+    uint32_t inaccurate_steps = 0;
+    float max_difference = 0;
+
+    Follower(const KnobConfig& initial, const KnobAngle& angle) : config(initial) {
+        tracker.configure(config, angle);
+    }
+
+    void follow(const Step& s, const KnobConfig& exact_config, const DetentError& exact) {
+        step(tracker, config, s, error);
+        float tolerance = ERROR_TOLERANCE_RAD + fabsf(exact.angle_to_center) * ERROR_TOLERANCE_RELATIVE;
+
+        bool tie = false;
+        if (config.position != exact_config.position) {
+            // The one that didn't snap is still the farther from its center, right at the snap point
+            float unsnapped = fmaxf(fabsf(exact.angle_to_center), fabsf(error.angle_to_center));
+            float snap = config.position_width_radians * config.snap_point;
+            tie = abs(config.position - exact_config.position) == 1 && fabsf(unsnapped - snap) < tolerance;
+        } else if (s.idle) {
+            tie = fabsf(fabsf(exact.angle_to_center) - IDLE_CORRECTION_MAX_ANGLE_RAD) < tolerance
+                && fabsf(exact.angle_to_center - error.angle_to_center) > ERROR_TOLERANCE_RAD / 2;
+        }
+        if (tie) {
+            ties++;
+            config = exact_config;
+            tracker.configure(config, toKnobAngle(s.angle - exact.angle_to_center));
+            error = exact;
+        }
+
+        float difference = fmaxf(fabsf(exact.angle_to_center - error.angle_to_center),
+            fabsf(exact.dead_zone_adjustment - error.dead_zone_adjustment));
+        max_difference = fmaxf(max_difference, difference);
+        // Which side of the center the knob is on is only ambiguous within the tolerance of it
+        bool bounds_agree = exact.out_of_bounds == error.out_of_bounds || fabsf(exact.angle_to_center) < tolerance;
+        accurate = config.position == exact_config.position && difference <= tolerance && bounds_agree;
+        if (!accurate) {
+            inaccurate_steps++;
+        }
+    }
+};
+
+// The detent math before angles were kept as turns plus the angle into the turn: radians in a float that grows with
+// every turn, as motor.shaft_angle does
+struct PlainFloatDetentMath {
+    typedef float Angle;
+    typedef float Delta;
+    typedef float Fraction;
+
+    // As SimpleFOC's Sensor::getAngle() adds them up
+    static Angle fromKnobAngle(const KnobAngle& angle) { return (float)angle.turns * KNOB_TURN_RADIANS + angle.radians; }
+    static Delta deltaFromRadians(float radians) { return radians; }
+    static float toRadians(Delta delta) { return delta; }
+    static Fraction fraction(float value) { return value; }
+
+    static Delta difference(Angle a, Angle b) { return a - b; }
+    static Angle offset(Angle angle, Delta delta) { return angle + delta; }
+    static Delta scale(Delta delta, Fraction fraction) { return delta * fraction; }
+    static Delta abs(Delta delta) { return fabsf(delta); }
+};
+
+struct SoakScenario {
+    const char* name;
+    KnobConfig config;
+    // Where the soak starts
+    double start_turns;
+    // Which way the knob is turned first
+    int direction;
+};
+
+// A tracker turned through a soak, and how far it strays from the exact answer
+template<typename Math>
+struct SoakFollower {
+    DetentTracker<Math> tracker;
+    KnobConfig config;
+    uint32_t off_steps = 0;
+    double max_difference = 0;
+
+    SoakFollower(const KnobConfig& initial, const KnobAngle& angle) : config(initial) {
+        tracker.configure(config, angle);
+    }
+
+    void follow(const Step& s, int32_t exact_position, double exact_error) {
+        DetentError error;
+        step(tracker, config, s, error);
+        double difference = fabs(exact_error - error.angle_to_center);
+        max_difference = fmax(max_difference, difference);
+        if (config.position != exact_position || difference > SOAK_ERROR_TOLERANCE_RAD) {
+            off_steps++;
+        }
+    }
+};
+
+// Turns the knob through the given number of detents at about half a detent per loop iteration, with sensor noise.
+// Bounded configs are swept from end to end and back. No idle correction, so the exact detent center is always the
+// starting one plus a whole number of detent widths; returns whether float and fixed point stayed on it.
+static bool runSoak(const SoakScenario& soak, uint32_t detents, std::mt19937& random) {
+    std::uniform_real_distribution<double> speed(0.4, 0.6);
+    std::uniform_real_distribution<double> noise(-0.002, 0.002);
+
+    double width = soak.config.position_width_radians;
+    double snap = width * soak.config.snap_point;
+    double angle = soak.start_turns * TURN_RADIANS;
+    double start_center = angle;
+    int32_t start_position = soak.config.position;
+    int32_t position = start_position;
+    int direction = soak.direction;
+
+    KnobAngle start = toKnobAngle(angle);
+    SoakFollower<FloatDetentMath> floating(soak.config, start);
+    SoakFollower<FixedDetentMath> fixed(soak.config, start);
+    SoakFollower<PlainFloatDetentMath> plain(soak.config, start);
+
+    uint32_t detents_turned = 0;
+    while (detents_turned < detents) {
+        // Turning toward higher positions is turning toward lower angles
+        if (soak.config.num_positions > 0
+                && ((direction > 0 && position == soak.config.num_positions - 1) || (direction < 0 && position == 0))) {
+            direction = -direction;
+        }
+        double sample = angle - direction * speed(random) * width + noise(random);
+        // Steer clear of the snap points, so every tracker should snap exactly where the exact one does
+        double center = start_center - (position - start_position) * width;
+        double past_snap = fabs(sample - center) - snap;
+        if (fabs(past_snap) < SOAK_SNAP_CLEARANCE_RAD) {
+            sample += (sample > center ? 1 : -1) * (past_snap < 0 ? -1 : 1) * 2 * SOAK_SNAP_CLEARANCE_RAD;
+        }
+        angle = sample;
+
+        if (angle - center > snap && (soak.config.num_positions <= 0 || position > 0)) {
+            position--;
+            detents_turned++;
+        } else if (angle - center < -snap
+                && (soak.config.num_positions <= 0 || position < soak.config.num_positions - 1)) {
+            position++;
+            detents_turned++;
+        }
+        double exact_error = angle - (start_center - (position - start_position) * width);
+
+        Step s = makeStep(angle, false);
+        floating.follow(s, position, exact_error);
+        fixed.follow(s, position, exact_error);
+        plain.follow(s, position, exact_error);
+    }
+
+    printf("%-30s %9u %9.0f   %6u %9.2e   %6u %9.2e   %6u %9.2e\n", soak.name, detents_turned,
+        fabs(angle - soak.start_turns * TURN_RADIANS) / TURN_RADIANS, floating.off_steps, floating.max_difference,
+        fixed.off_steps, fixed.max_difference, plain.off_steps, plain.max_difference);
+    return floating.off_steps == 0 && fixed.off_steps == 0;
+}
+
+template<typename Math>
+static double benchmark(const KnobConfig& initial, const std::vector<Step>& trajectory, uint32_t repeats, float& sink) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < repeats; r++) {
+        KnobConfig config = initial;
+        DetentTracker<Math> tracker;
+        tracker.configure(config, trajectory[0].knob);
+        DetentError error;
+        for (const Step& s : trajectory) {
+            step(tracker, config, s, error);
+            sink += error.angle_to_center;
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ((double)repeats * trajectory.size());
+}
+
+int main(int argc, char** argv) {
+    float seconds = argc > 1 ? atof(argv[1]) : 600;
+    uint32_t seed = argc > 2 ? strtoul(argv[2], nullptr, 0) : 1;
+    uint32_t soak_detents = argc > 3 ? strtoul(argv[3], nullptr, 0) : 10000000;
+
+    // One of each kind of built-in config (see InterfaceTask)
+    const Scenario scenarios[] = {
+        {"unbounded, no detents", makeConfig(0, 0, 10, 1.1)},
+        {"bounded 0-10", makeConfig(11, 0, 10, 1.1)},
+        {"on/off", makeConfig(2, 0, 60, 0.55)},
+        {"return to center", makeConfig(1, 0, 60, 1.1)},
+        {"fine values", makeConfig(256, 127, 1, 1.1)},
+        {"coarse values", makeConfig(32, 0, 8.225806452, 1.1)},
+    };
+
+    std::mt19937 random(seed);
+    uint32_t steps = seconds * LOOP_HZ;
+    uint32_t failures = 0;
+    float sink = 0;
+    printf("%-22s %9s   %-22s   %-22s   %-12s %8s %8s\n", "", "", "float vs exact", "fixed vs exact", "fixed vs float",
+        "float", "fixed");
+    printf("%-22s %9s   %5s %6s %9s   %5s %6s %9s   %-12s %8s %8s\n", "config", "positions", "ties", "off", "max rad",
+        "ties", "off", "max rad", "max rad", "ns", "ns");
+    for (const Scenario& scenario : scenarios) {
+        std::vector<Step> trajectory = makeTrajectory(steps, random);
+
+        KnobConfig exact_config = scenario.config;
+        DetentTracker<DoubleDetentMath> exact_tracker;
+        exact_tracker.configure(exact_config, trajectory[0].knob);
+        Follower<FloatDetentMath> floating(scenario.config, trajectory[0].knob);
+        Follower<FixedDetentMath> fixed(scenario.config, trajectory[0].knob);
+
+        uint32_t position_changes = 0;
+        int32_t last_position = scenario.config.position;
+        float max_fixed_float_difference = 0;
+        for (const Step& s : trajectory) {
+            DetentError exact;
+            step(exact_tracker, exact_config, s, exact);
+            floating.follow(s, exact_config, exact);
+            fixed.follow(s, exact_config, exact);
+
+            if (!floating.accurate && floating.inaccurate_steps == 1) {
+                printf("%s: at %.6f rad: exact position %d error %.6f, float position %d error %.6f\n",
+                    scenario.name, s.angle, exact_config.position, exact.angle_to_center, floating.config.position,
+                    floating.error.angle_to_center);
+            }
+            if (!fixed.accurate && fixed.inaccurate_steps == 1) {
+                printf("%s: at %.6f rad: exact position %d error %.6f, fixed point position %d error %.6f\n",
+                    scenario.name, s.angle, exact_config.position, exact.angle_to_center, fixed.config.position,
+                    fixed.error.angle_to_center);
+            }
+            if (floating.accurate && fixed.accurate) {
+                max_fixed_float_difference = fmaxf(max_fixed_float_difference,
+                    fabsf(floating.error.angle_to_center - fixed.error.angle_to_center));
+            }
+            if (exact_config.position != last_position) {
+                position_changes++;
+                last_position = exact_config.position;
+            }
+        }
+
+        // Enough passes for a stable timing without taking long
+        uint32_t repeats = 20000000 / trajectory.size() + 1;
+        double float_nanos = benchmark<FloatDetentMath>(scenario.config, trajectory, repeats, sink);
+        double fixed_nanos = benchmark<FixedDetentMath>(scenario.config, trajectory, repeats, sink);
+
+        printf("%-22s %9u   %5u %6u %9.2e   %5u %6u %9.2e   %-12.2e %8.2f %8.2f\n", scenario.name, position_changes,
+            floating.ties, floating.inaccurate_steps, floating.max_difference, fixed.ties, fixed.inaccurate_steps,
+            fixed.max_difference, max_fixed_float_difference, float_nanos, fixed_nanos);
+        if (floating.inaccurate_steps > 0 || fixed.inaccurate_steps > 0) {
+            failures++;
+        }
+    }
+
+    printf("\n%-30s %9s %9s   %-16s   %-16s   %-16s\n", "", "", "", "float", "fixed", "plain float");
+    printf("%-30s %9s %9s   %6s %9s   %6s %9s   %6s %9s\n", "soak", "detents", "turns", "off", "max rad", "off",
+        "max rad", "off", "max rad");
+    const SoakScenario soaks[] = {
+        {"unbounded, spun up", makeConfig(0, 0, 10, 1.1), 0, 1},
+        {"unbounded, spun down", makeConfig(0, 0, 10, 1.1), 0, -1},
+        {"multi-rev, swept far out", makeConfig(73, 0, 10, 1.1), 10000, 1},
+    };
+    for (const SoakScenario& soak : soaks) {
+        if (!runSoak(soak, soak_detents, random)) {
+            failures++;
+        }
+    }
+
+    // Keeps the benchmarked work from being optimized away
+    if (sink == 12345) {
+        printf("\n");
+    }
+    printf("%s\n", failures == 0 ? "float and fixed point match exact detent math" : "FAILED: detent math strays");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+// Motor loop jitter benchmark on the simulated firmware: boots a build with the synthetic display and serial load of
+// the view_jitter envs (see load_task.h) on the motor's core, lets it run with the hand sweeping the knob, and prints
+// the profile's "motor period" line, whose spread is the loop's scheduling jitter. Built twice, like the envs:
+// sk_jitter with the task priorities of task_config.h, and sk_jitter_flat with every task at priority 1.
+//
+// The simulated CPU charges no time to the firmware's own code (see sim_kernel.cpp), only to the load's busy-waits,
+// so this measures how long the scheduler keeps the motor task waiting, not the loop's own variation.
+//
+// Usage: sk_jitter [seconds]
+
+#include <chrono>
+#include <string>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "knob_client.h"
+#include "sim.h"
+
+#ifndef PARTITIONS_CSV
+#define PARTITIONS_CSV "partitions.csv"
+#endif
+
+void setup();
+void loop();
+
+static double wallSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs the unpaced simulation in slices, draining the serial port in between so the firmware never blocks on a full
+// pseudo-terminal. The serial load's filler fills it much faster than sk_sim_test's traffic, hence the short slices.
+static void runDraining(KnobClient& client, uint64_t until_micros) {
+    while (Simulation::micros() < until_micros) {
+        Simulation::runUntil(std::min<uint64_t>(until_micros, Simulation::micros() + 10000));
+        client.poll(0);
+    }
+}
+
+// Handles input from the (real-time) simulation for a while
+static void pollFor(KnobClient& client, int millis) {
+    double end = wallSeconds() + millis / 1000.0;
+    while (wallSeconds() < end) {
+        client.poll(10);
+    }
+}
+
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 30;
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("pty");
+        return 1;
+    }
+    struct termios tty;
+    tcgetattr(master, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(master, TCSANOW, &tty);
+    const char* slave_path = ptsname(master);
+
+    SerialPort port;
+    if (!port.open(slave_path, 115200)) {
+        fprintf(stderr, "Failed to open %s\n", slave_path);
+        return 1;
+    }
+    KnobClient client(port);
+    std::string text;
+    client.on_text = [&](const std::string& line) {
+        text += line;
+    };
+
+    SimOptions options;
+    options.serial_fd = master;
+    options.partitions_path = PARTITIONS_CSV;
+    Simulation::start(setup, loop, options);
+
+    // Boot, unpaced, past the motor task's 3 second wait for a calibration request
+    runDraining(client, 4000000);
+
+    // Reporting the profile starts a new window, so this one only covers the run below
+    Simulation::setSpeed(1);
+    Simulation::resume();
+    AckStatus status;
+    if (!client.sendCommand(CommandId::LOG_PROFILE, status) || status != AckStatus::OK) {
+        fprintf(stderr, "No response to the profile request\n");
+        return 1;
+    }
+
+    // A quarter turn back and forth every second, well within the default config's range
+    SimPlant& plant = Simulation::plant();
+    float start_angle = plant.getAngle();
+    plant.grab();
+    Simulation::setSpeed(0);
+    uint64_t start = Simulation::micros();
+    for (int i = 0; i < seconds * 2; i++) {
+        plant.turnTo(start_angle + (i % 2 == 0 ? M_PI / 2 : 0), 400000);
+        runDraining(client, start + (i + 1) * 500000ULL);
+    }
+
+    // Text is only passed through once a frame follows it, which the ping's ACK provides
+    Simulation::setSpeed(1);
+    Simulation::resume();
+    if (!client.sendCommand(CommandId::LOG_PROFILE, status) || status != AckStatus::OK) {
+        fprintf(stderr, "No response to the profile request\n");
+        return 1;
+    }
+    pollFor(client, 100);
+    client.ping(status);
+    size_t line = text.rfind("motor period");
+    if (line == std::string::npos) {
+        fprintf(stderr, "No motor period in the profile\n");
+        return 1;
+    }
+    printf("%s\n", text.substr(line, text.find('\n', line) - line).c_str());
+
+    // The firmware's tasks never return, so leave without running static destructors under them
+    fflush(stdout);
+    _exit(0);
+}
@@ -0,0 +1,258 @@
+// Loopback harness: runs KnobClient against a simulated knob on the other end of a pseudo-terminal, exercising
+// each request type, state/telemetry streaming and text passthrough. Exits non-zero if anything misbehaves.
+//
+// Usage: sk_loopback [state_interval_millis] [seconds]
+
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "knob_client.h"
+#include "ram_flash_region.h"
+
+static int64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Device side, speaking the protocol on the pty master the same way the firmware's InterfaceTask does
+class SimulatedKnob {
+    public:
+        SimulatedKnob(int fd) : fd_(fd), config_flash_(0x8000), config_store_(config_flash_) {}
+
+        uint32_t getLibraryCount() const { return config_store_.getLibrary().getCount(); }
+        uint32_t getSelectedId() const { return selected_id_; }
+
+        void run(std::atomic<bool>& stop) {
+            int64_t start = nowMicros();
+            int64_t next_state = 0;
+            int64_t next_telemetry = 0;
+            int64_t next_text = start;
+            while (!stop) {
+                uint8_t buffer[256];
+                struct pollfd pfd = {};
+                pfd.fd = fd_;
+                pfd.events = POLLIN;
+                if (poll(&pfd, 1, 1) > 0) {
+                    ssize_t count = read(fd_, buffer, sizeof(buffer));
+                    for (ssize_t i = 0; i < count; i++) {
+                        if (decoder_.feed(buffer[i])) {
+                            handleMessage();
+                        }
+                    }
+                }
+
+                int64_t now = nowMicros();
+                if (stream_.state_interval_millis > 0 && now >= next_state) {
+                    float t = (now - start) / 1e6f;
+                    StateMessage state = {(int32_t)(t * 10), 0.25f, 10, (uint32_t)(now - start), config_.num_positions, 0};
+                    uint8_t body[PROTOCOL_MAX_BODY];
+                    send(MessageId::STATE, body, encodeState(state, body, sizeof(body)));
+                    next_state = now + stream_.state_interval_millis * 1000;
+                }
+                if (stream_.telemetry_interval_millis > 0 && now >= next_telemetry) {
+                    TelemetryMessage telemetry = {(uint32_t)((now - start) / 1000), 0, 0, 12.5f, 200000};
+                    uint8_t body[PROTOCOL_MAX_BODY];
+                    send(MessageId::TELEMETRY, body, encodeTelemetry(telemetry, body, sizeof(body)));
+                    next_telemetry = now + stream_.telemetry_interval_millis * 1000;
+                }
+                // Free-text output interleaved with frames, like Serial.print from other tasks
+                if (now >= next_text) {
+                    writeAll((const uint8_t*)"HX711 reading: 1234 (baseline 1200)\n", 36);
+                    next_text = now + 100000;
+                }
+            }
+        }
+
+    private:
+        int fd_;
+        FrameDecoder decoder_;
+        uint8_t sequence_ = 0;
+        StreamMessage stream_ = {};
+        KnobConfig config_ = {};
+        RamFlashRegion config_flash_;
+        ConfigLibraryStore config_store_;
+        uint32_t selected_id_ = 0;
+
+        void handleMessage() {
+            AckStatus status = AckStatus::OK;
+            switch (decoder_.getId()) {
+                case MessageId::PING:
+                    break;
+                case MessageId::SET_CONFIG:
+                    if (!decodeConfig(decoder_.getBody(), decoder_.getBodyLength(), config_)) {
+                        status = AckStatus::INVALID;
+                    }
+                    break;
+                case MessageId::COMMAND:
+                    status = decoder_.getBodyLength() == 1 && decoder_.getBody()[0] <= (uint8_t)CommandId::FREEZE_RECORDING ? AckStatus::OK : AckStatus::UNSUPPORTED;
+                    break;
+                case MessageId::LIBRARY_BEGIN: {
+                    PayloadReader reader(decoder_.getBody(), decoder_.getBodyLength());
+                    uint32_t size = reader.u32();
+                    if (!reader.ok() || !config_store_.beginUpload(size)) {
+                        status = AckStatus::INVALID;
+                    }
+                    break;
+                }
+                case MessageId::LIBRARY_WRITE: {
+                    PayloadReader reader(decoder_.getBody(), decoder_.getBodyLength());
+                    uint32_t offset = reader.u32();
+                    if (!reader.ok(false) || !config_store_.writeUpload(offset, decoder_.getBody() + 4, decoder_.getBodyLength() - 4)) {
+                        status = AckStatus::INVALID;
+                    }
+                    break;
+                }
+                case MessageId::LIBRARY_COMMIT:
+                    if (!config_store_.commitUpload()) {
+                        status = AckStatus::INVALID;
+                    }
+                    break;
+                case MessageId::SELECT_CONFIG: {
+                    PayloadReader reader(decoder_.getBody(), decoder_.getBodyLength());
+                    uint32_t id = reader.u32();
+                    int32_t index = config_store_.getLibrary().find(id);
+                    if (!reader.ok() || index < 0) {
+                        status = AckStatus::INVALID;
+                        break;
+                    }
+                    config_ = config_store_.getLibrary().get(index).config;
+                    selected_id_ = id;
+                    break;
+                }
+                case MessageId::SET_STREAM:
+                    if (!decodeStream(decoder_.getBody(), decoder_.getBodyLength(), stream_)) {
+                        stream_ = {};
+                        status = AckStatus::INVALID;
+                    }
+                    break;
+                default:
+                    status = AckStatus::UNSUPPORTED;
+                    break;
+            }
+            uint8_t body[PROTOCOL_MAX_BODY];
+            send(MessageId::ACK, body, encodeAck({decoder_.getSequence(), status}, body, sizeof(body)));
+        }
+
+        void send(MessageId id, const uint8_t* body, size_t body_length) {
+            uint8_t frame[PROTOCOL_MAX_FRAME];
+            size_t length = encodeFrame(id, sequence_++, body, body_length, frame, sizeof(frame));
+            writeAll(frame, length);
+        }
+
+        void writeAll(const uint8_t* data, size_t length) {
+            while (length > 0) {
+                ssize_t count = write(fd_, data, length);
+                if (count <= 0) {
+                    usleep(100);
+                    continue;
+                }
+                data += count;
+                length -= count;
+            }
+        }
+};
+
+static int failures = 0;
+
+static void check(const char* name, bool passed) {
+    printf("%-40s %s\n", name, passed ? "ok" : "FAILED");
+    if (!passed) {
+        failures++;
+    }
+}
+
+int main(int argc, char** argv) {
+    uint16_t state_interval_millis = argc > 1 ? atoi(argv[1]) : 2;
+    int seconds = argc > 2 ? atoi(argv[2]) : 2;
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("pty");
+        return 1;
+    }
+    struct termios tty;
+    tcgetattr(master, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(master, TCSANOW, &tty);
+    const char* slave_path = ptsname(master);
+
+    SerialPort port;
+    if (!port.open(slave_path, 115200)) {
+        fprintf(stderr, "Failed to open %s\n", slave_path);
+        return 1;
+    }
+
+    std::atomic<bool> stop(false);
+    SimulatedKnob knob(master);
+    std::thread device([&]() { knob.run(stop); });
+
+    KnobClient client(port);
+    uint32_t states = 0;
+    uint32_t telemetry_count = 0;
+    uint32_t text_count = 0;
+    bool states_valid = true;
+    client.on_state = [&](const StateMessage& state) {
+        states++;
+        states_valid = states_valid && state.sub_position_unit == 0.25f && state.num_positions == 11;
+    };
+    client.on_telemetry = [&](const TelemetryMessage& telemetry) {
+        telemetry_count++;
+    };
+    client.on_text = [&](const std::string& text) {
+        text_count++;
+    };
+
+    AckStatus status;
+    check("ping", client.ping(status) && status == AckStatus::OK);
+
+    KnobConfig config = {11, 0, 0.17f, 0, 1, 1.1f, "Loopback\nBounded", DisplayLayout::FILL, LedEffect::POSITION};
+    check("set config", client.setConfig(config, status) && status == AckStatus::OK);
+    KnobConfig invalid = config;
+    invalid.position = 20;
+    check("set invalid config is rejected", client.setConfig(invalid, status) && status == AckStatus::INVALID);
+
+    check("command", client.sendCommand(CommandId::NEXT_CONFIG, status) && status == AckStatus::OK);
+    check("unknown command is rejected", client.sendCommand((CommandId)0x7F, status) && status == AckStatus::UNSUPPORTED);
+
+    ConfigRecord library[40];
+    for (uint32_t i = 0; i < 40; i++) {
+        library[i] = {100 + i, config};
+        snprintf(library[i].config.descriptor, sizeof(library[i].config.descriptor), "Library %u", i);
+    }
+    check("upload config library", client.uploadConfigLibrary(library, 40, status) && status == AckStatus::OK
+        && knob.getLibraryCount() == 40);
+    std::vector<ConfigRecord> oversized(500, library[0]);
+    check("oversized library is rejected", client.uploadConfigLibrary(oversized.data(), oversized.size(), status)
+        && status == AckStatus::INVALID && knob.getLibraryCount() == 40);
+    check("select config by id", client.selectConfig(139, status) && status == AckStatus::OK && knob.getSelectedId() == 139);
+    check("select unknown id is rejected", client.selectConfig(7, status) && status == AckStatus::INVALID);
+    check("reselect config for streaming", client.selectConfig(100, status) && status == AckStatus::OK);
+
+    int64_t start = nowMicros();
+    check("start streaming", client.setStream({state_interval_millis, 100}, status) && status == AckStatus::OK);
+    while (nowMicros() - start < seconds * 1000000LL) {
+        client.poll(10);
+    }
+    check("stop streaming", client.setStream({0, 0}, status) && status == AckStatus::OK);
+    double elapsed = (nowMicros() - start) / 1e6;
+
+    stop = true;
+    device.join();
+
+    check("states received", states > 0 && states_valid);
+    check("telemetry received", telemetry_count > 0);
+    check("text passed through", text_count > 0);
+    printf("%u states (%.0f/s), %u telemetry, %u text lines, %u frames, %u rejected\n",
+        states, states / elapsed, telemetry_count, text_count, client.getFrameCount(), client.getRejectedCount());
+
+    close(master);
+    return failures == 0 ? 0 : 1;
+}
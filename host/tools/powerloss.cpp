@@ -0,0 +1,161 @@
+// Power loss harness for PositionLog: cuts power at random points during writes, copies and erases (leaving the
+// interrupted byte partially programmed or erased), reboots, and checks that every position written before the
+// cut is recovered. Exits non-zero if anything is lost.
+//
+// Usage: sk_powerloss [boots] [seed]
+
+#include <map>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "position_log.h"
+
+// FlashRegion in RAM with NOR semantics that loses power after a given number of byte operations. The operation
+// in progress is torn: the bytes before the cut are done, the byte at the cut only partially.
+class UnreliableFlash : public FlashRegion {
+    public:
+        UnreliableFlash(size_t size, std::mt19937& random) : data_(size, 0xFF), random_(random) {}
+
+        // Cut power after budget more byte operations; negative for never
+        void powerOn(int64_t budget) {
+            budget_ = budget;
+        }
+        bool isPoweredOff() const { return budget_ == 0; }
+
+        size_t getSize() override { return data_.size(); }
+
+        bool erase(size_t offset, size_t length) override {
+            if (offset % SECTOR_SIZE != 0 || length % SECTOR_SIZE != 0 || offset + length > data_.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < length; i++) {
+                if (!spend()) {
+                    data_[offset + i] |= (uint8_t)random_();
+                    return false;
+                }
+                data_[offset + i] = 0xFF;
+            }
+            return true;
+        }
+
+        bool write(size_t offset, const uint8_t* data, size_t length) override {
+            if (offset + length > data_.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < length; i++) {
+                if (!spend()) {
+                    data_[offset + i] &= data[i] | (uint8_t)random_();
+                    return false;
+                }
+                data_[offset + i] &= data[i];
+            }
+            return true;
+        }
+
+        bool read(size_t offset, uint8_t* data, size_t length) override {
+            if (budget_ == 0 || offset + length > data_.size()) {
+                return false;
+            }
+            memcpy(data, &data_[offset], length);
+            return true;
+        }
+
+        const uint8_t* map() override { return budget_ == 0 ? nullptr : data_.data(); }
+
+    private:
+        std::vector<uint8_t> data_;
+        std::mt19937& random_;
+        int64_t budget_ = -1;
+
+        bool spend() {
+            if (budget_ == 0) {
+                return false;
+            }
+            if (budget_ > 0) {
+                budget_--;
+            }
+            return true;
+        }
+};
+
+int main(int argc, char** argv) {
+    int boots = argc > 1 ? atoi(argv[1]) : 20000;
+    uint32_t seed = argc > 2 ? strtoul(argv[2], nullptr, 0) : 1;
+
+    std::mt19937 random(seed);
+    UnreliableFlash flash(0x8000, random);
+
+    // Stays within PositionLog::MAX_IDS, so nothing is evicted and every id must survive
+    const uint32_t ids = 24;
+    std::map<uint32_t, int32_t> written;
+    bool in_flight = false;
+    uint32_t in_flight_id = 0;
+    int32_t in_flight_position = 0;
+
+    uint32_t failures = 0;
+    uint32_t torn_boots = 0;
+    uint32_t writes = 0;
+    uint32_t erases = 0;
+    for (int boot = 0; boot < boots; boot++) {
+        // Mostly short sessions so cuts land in copies and erases, which only happen every few hundred writes
+        flash.powerOn(random() % 4 == 0 ? random() % 200000 : random() % 20000);
+        PositionLog log(flash);
+        if (!log.begin()) {
+            if (!flash.isPoweredOff()) {
+                printf("boot %d: begin failed without a power loss\n", boot);
+                failures++;
+            }
+            torn_boots++;
+            continue;
+        }
+
+        for (auto& entry : written) {
+            int32_t position;
+            bool found = log.get(entry.first, position);
+            if (in_flight && entry.first == in_flight_id && found && position == in_flight_position) {
+                // The write that was cut made it after all
+                entry.second = position;
+            } else if (!found || position != entry.second) {
+                printf("boot %d: id %u recovered %s%d, expected %d\n", boot, entry.first, found ? "" : "nothing, last ",
+                    found ? position : 0, entry.second);
+                failures++;
+                if (found) {
+                    entry.second = position;
+                }
+            }
+        }
+        if (in_flight && written.count(in_flight_id) == 0) {
+            int32_t position;
+            if (log.get(in_flight_id, position) && position == in_flight_position) {
+                written[in_flight_id] = position;
+            }
+        }
+        in_flight = false;
+
+        while (true) {
+            // A few ids change all the time, the rest rarely, so live entries are often in the oldest sector
+            uint32_t id = 1000 + (random() % 50 == 0 ? random() % ids : random() % 3);
+            int32_t position = (int32_t)(random() % 2001) - 1000;
+            if (!log.write(id, position)) {
+                if (!flash.isPoweredOff()) {
+                    printf("boot %d: write failed without a power loss\n", boot);
+                    failures++;
+                }
+                in_flight = true;
+                in_flight_id = id;
+                in_flight_position = position;
+                break;
+            }
+            written[id] = position;
+        }
+        writes += log.getWriteCount();
+        erases += log.getEraseCount();
+    }
+
+    printf("%d boots (%u cut during recovery), %u entries written, %u sectors erased, %u failures\n",
+        boots, torn_boots, writes, erases, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,358 @@
+// Replays strain gauge traces through the firmware's PressDetector (see firmware/src/press_detector.h) and reports,
+// per trace, how long presses took to be detected and how many presses were reported that weren't there.
+//
+// A trace is a CSV of HX711 samples: micros,reading,pressed, where pressed (0 or 1) marks when a finger was actually
+// pressing the knob, from the moment it started pushing until it let go. A labelled press counts as detected if the
+// detector reports PRESS (or harder) before it ends, or within RELEASE_GRACE_MICROS after; latency is measured from its
+// start. Any other report of PRESS is a false press. Lines starting with # are comments.
+//
+// The traces in traces/press are synthesized by --synthesize (which rewrites them, deterministically) rather than
+// recorded: a 10 SPS HX711 with noise, temperature drift, glitches and presses of different shapes, as described at
+// the top of each. The synthesized presses hold for at least 250 ms, so each spans a few samples. Recordings from a
+// knob in the same format can be replayed alongside them.
+//
+// Exits non-zero if any press was missed or any false press reported.
+//
+// Usage: sk_press_replay [trace.csv ...]
+//        sk_press_replay --synthesize <dir>
+
+#include <algorithm>
+#include <dirent.h>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "press_detector.h"
+
+#ifndef PRESS_TRACES_DIR
+#define PRESS_TRACES_DIR "traces/press"
+#endif
+
+// The detector only reports a release a couple of samples after the finger lets go
+static const uint32_t RELEASE_GRACE_MICROS = 500000;
+
+struct Sample {
+    uint32_t micros;
+    int32_t reading;
+    bool pressed;
+};
+
+struct Trace {
+    std::string name;
+    std::vector<Sample> samples;
+};
+
+static bool loadTrace(const std::string& path, Trace& trace) {
+    FILE* file = fopen(path.c_str(), "r");
+    if (file == nullptr) {
+        return false;
+    }
+    trace.name = path.substr(path.rfind('/') + 1);
+    trace.samples.clear();
+    char line[256];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        unsigned int micros;
+        int reading;
+        int pressed;
+        if (line[0] != '#' && sscanf(line, "%u,%d,%d", &micros, &reading, &pressed) == 3) {
+            trace.samples.push_back({micros, reading, pressed != 0});
+        }
+    }
+    fclose(file);
+    return !trace.samples.empty();
+}
+
+struct PressInterval {
+    uint32_t start_micros;
+    uint32_t end_micros;
+};
+
+struct ReplayResult {
+    uint32_t presses = 0;
+    uint32_t detected = 0;
+    std::vector<uint32_t> latencies_micros;
+    uint32_t false_presses = 0;
+    // Time without a finger on the knob, which is when a false press could happen
+    double idle_seconds = 0;
+    uint32_t discarded = 0;
+    uint32_t reseeds = 0;
+};
+
+static ReplayResult replay(const Trace& trace) {
+    ReplayResult result;
+    std::vector<PressInterval> intervals;
+    for (size_t i = 0; i < trace.samples.size(); i++) {
+        const Sample& sample = trace.samples[i];
+        bool started = sample.pressed && (i == 0 || !trace.samples[i - 1].pressed);
+        if (started) {
+            intervals.push_back({sample.micros, sample.micros});
+        }
+        if (sample.pressed) {
+            intervals.back().end_micros = sample.micros;
+        } else if (i > 0) {
+            result.idle_seconds += (sample.micros - trace.samples[i - 1].micros) / 1e6;
+        }
+    }
+    result.presses = intervals.size();
+    std::vector<bool> detected(intervals.size(), false);
+
+    PressDetector detector;
+    bool pressing = false;
+    for (const Sample& sample : trace.samples) {
+        detector.update(sample.reading, sample.micros);
+        bool now_pressing = detector.getLevel() >= PressLevel::PRESS;
+        if (now_pressing && !pressing) {
+            bool matched = false;
+            for (size_t i = 0; i < intervals.size(); i++) {
+                if (sample.micros >= intervals[i].start_micros
+                        && sample.micros <= intervals[i].end_micros + RELEASE_GRACE_MICROS) {
+                    if (!detected[i]) {
+                        detected[i] = true;
+                        result.detected++;
+                        result.latencies_micros.push_back(sample.micros - intervals[i].start_micros);
+                    }
+                    matched = true;
+                }
+            }
+            if (!matched) {
+                result.false_presses++;
+            }
+        }
+        pressing = now_pressing;
+    }
+    result.discarded = detector.getDiscardedCount();
+    result.reseeds = detector.getReseedCount();
+    return result;
+}
+
+static uint32_t percentile(std::vector<uint32_t> values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(fraction * values.size()))];
+}
+
+// --- Synthesis ---
+
+// A load cell on an HX711 at 10 samples per second, scaled like PressDetector::DEFAULT_CONFIG expects
+static const uint32_t SAMPLE_MICROS = 100000;
+static const double ZERO_READING = 950000;
+static const double FULL_SCALE = 850000;
+static const double NOISE_UNIT = 0.002;
+// What an HX711 returns when a read is cut short by an interrupt at the wrong moment
+static const int32_t GLITCH_READINGS[] = {0x7FFFFF, -0x800000, 0};
+
+struct Press {
+    double start_seconds;
+    double peak_unit;
+    double rise_seconds;
+    double hold_seconds;
+    double fall_seconds;
+};
+
+struct Synthesis {
+    const char* name;
+    const char* description;
+    double seconds;
+    // Drift of the zero point: a slow sine of this amplitude and period, as the room and the motor warm and cool
+    double drift_unit;
+    double drift_period_seconds;
+    double glitches_per_minute;
+    // Labelled as pressed
+    std::vector<Press> presses;
+    // A finger resting on the knob: adds to the reading like a press, but isn't one
+    std::vector<Press> touches;
+    // Held down from before startup until this time, this hard (not labelled, since no detector could tell)
+    double held_at_boot_seconds;
+    double held_at_boot_unit;
+};
+
+// How far a press or touch pushes at time t: a ramp up, a hold and a ramp down
+static double pushUnit(const Press& press, double t) {
+    double into = t - press.start_seconds;
+    if (into < 0) {
+        return 0;
+    }
+    if (into < press.rise_seconds) {
+        return press.peak_unit * into / press.rise_seconds;
+    }
+    into -= press.rise_seconds;
+    if (into < press.hold_seconds) {
+        return press.peak_unit;
+    }
+    into -= press.hold_seconds;
+    if (into < press.fall_seconds) {
+        return press.peak_unit * (1 - into / press.fall_seconds);
+    }
+    return 0;
+}
+
+static double pushEnd(const Press& press) {
+    return press.start_seconds + press.rise_seconds + press.hold_seconds + press.fall_seconds;
+}
+
+static bool synthesize(const Synthesis& synthesis, const std::string& dir, std::mt19937& rng) {
+    std::string path = dir + "/" + synthesis.name;
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    fprintf(file, "# Synthesized by sk_press_replay --synthesize: %s\n", synthesis.description);
+    fprintf(file, "micros,reading,pressed\n");
+    std::normal_distribution<double> noise(0, NOISE_UNIT);
+    // A finger holding steady isn't
+    std::normal_distribution<double> tremor(0, 0.02);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::uniform_int_distribution<uint32_t> jitter(0, 400);
+    double glitch_probability = synthesis.glitches_per_minute * SAMPLE_MICROS / 60e6;
+    uint32_t micros = 0;
+    for (double t = 0; t < synthesis.seconds; t = micros / 1e6) {
+        double unit = synthesis.drift_unit * sin(2 * M_PI * t / synthesis.drift_period_seconds) + noise(rng);
+        bool pushed = false;
+        bool pressed = false;
+        if (t < synthesis.held_at_boot_seconds) {
+            unit += synthesis.held_at_boot_unit;
+            pushed = true;
+        }
+        for (const Press& press : synthesis.presses) {
+            double push = pushUnit(press, t);
+            unit += push;
+            pushed = pushed || push > 0;
+            pressed = pressed || push > 0;
+        }
+        for (const Press& touch : synthesis.touches) {
+            double push = pushUnit(touch, t);
+            unit += push;
+            pushed = pushed || push > 0;
+        }
+        if (pushed) {
+            unit += tremor(rng);
+        }
+        int32_t reading = (int32_t)lround(ZERO_READING + unit * FULL_SCALE);
+        if (uniform(rng) < glitch_probability) {
+            reading = GLITCH_READINGS[rng() % (sizeof(GLITCH_READINGS) / sizeof(GLITCH_READINGS[0]))];
+        }
+        fprintf(file, "%u,%d,%d\n", micros, reading, pressed ? 1 : 0);
+        micros += SAMPLE_MICROS - 200 + jitter(rng);
+    }
+    fclose(file);
+    printf("Wrote %s\n", path.c_str());
+    return true;
+}
+
+// Presses of random strength and shape, a few seconds apart, between the given times
+static std::vector<Press> randomPresses(std::mt19937& rng, double start_seconds, double end_seconds, double min_peak,
+        double max_peak) {
+    std::uniform_real_distribution<double> peak(min_peak, max_peak);
+    std::uniform_real_distribution<double> rise(0.04, 0.15);
+    std::uniform_real_distribution<double> hold(0.25, 1.5);
+    std::uniform_real_distribution<double> fall(0.05, 0.2);
+    std::uniform_real_distribution<double> gap(2, 8);
+    std::vector<Press> presses;
+    for (double t = start_seconds + gap(rng); t < end_seconds - 3; t += gap(rng)) {
+        Press press = {t, peak(rng), rise(rng), hold(rng), fall(rng)};
+        presses.push_back(press);
+        t = pushEnd(press);
+    }
+    return presses;
+}
+
+// A finger resting on the knob for a few seconds in some of the gaps between presses
+static std::vector<Press> restingTouches(std::mt19937& rng, const std::vector<Press>& presses) {
+    std::uniform_real_distribution<double> peak(0.1, 0.4);
+    std::uniform_real_distribution<double> rest(2, 6);
+    std::vector<Press> touches;
+    for (size_t i = 0; i + 1 < presses.size(); i++) {
+        double start = pushEnd(presses[i]) + 0.5;
+        double duration = std::min(rest(rng), presses[i + 1].start_seconds - start - 1);
+        if (duration > 1) {
+            touches.push_back({start, peak(rng), 0.3, duration - 0.6, 0.3});
+        }
+    }
+    return touches;
+}
+
+static int synthesizeAll(const std::string& dir) {
+    std::mt19937 rng(31);
+    std::vector<Press> none;
+
+    Synthesis presses = {"presses.csv", "presses from just past the threshold to hard, quick taps to long holds",
+        180, 0.01, 300, 0.5, randomPresses(rng, 0, 180, 0.85, 1.6), none, 0, 0};
+    Synthesis touches = {"light_touches.csv", "fingers resting on the knob with up to 0.4 of a press between presses",
+        180, 0.01, 300, 0.5, randomPresses(rng, 0, 180, 0.85, 1.3), none, 0, 0};
+    touches.touches = restingTouches(rng, touches.presses);
+    Synthesis drift = {"drift_glitches.csv", "ten minutes untouched, with strong drift and a glitch or so a minute",
+        600, 0.3, 240, 1.5, none, none, 0, 0};
+    Synthesis boot = {"boot_pressed.csv", "held down hard from before startup for three seconds, then presses",
+        90, 0.01, 300, 0.5, randomPresses(rng, 3, 90, 0.85, 1.4), none, 3, 2};
+
+    const Synthesis* syntheses[] = {&presses, &touches, &drift, &boot};
+    for (const Synthesis* synthesis : syntheses) {
+        if (!synthesize(*synthesis, dir, rng)) {
+            fprintf(stderr, "Failed to write %s/%s\n", dir.c_str(), synthesis->name);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--synthesize") == 0) {
+        return synthesizeAll(argv[2]);
+    }
+
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        paths.push_back(argv[i]);
+    }
+    if (paths.empty()) {
+        DIR* dir = opendir(PRESS_TRACES_DIR);
+        if (dir == nullptr) {
+            fprintf(stderr, "No traces in %s\n", PRESS_TRACES_DIR);
+            return 1;
+        }
+        while (struct dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".csv") == 0) {
+                paths.push_back(std::string(PRESS_TRACES_DIR) + "/" + name);
+            }
+        }
+        closedir(dir);
+        std::sort(paths.begin(), paths.end());
+    }
+
+    printf("%-20s %7s %7s %8s %8s %8s %6s %9s %7s\n", "trace", "seconds", "presses", "detected", "p50 ms",
+        "max ms", "false", "discarded", "reseeds");
+    bool passed = true;
+    uint32_t total_false = 0;
+    double total_idle_seconds = 0;
+    std::vector<uint32_t> all_latencies;
+    for (const std::string& path : paths) {
+        Trace trace;
+        if (!loadTrace(path, trace)) {
+            fprintf(stderr, "Failed to read %s\n", path.c_str());
+            return 1;
+        }
+        ReplayResult result = replay(trace);
+        printf("%-20s %7.0f %7u %8u %8.0f %8.0f %6u %9u %7u\n", trace.name.c_str(),
+            trace.samples.back().micros / 1e6, result.presses, result.detected,
+            percentile(result.latencies_micros, 0.5) / 1e3, percentile(result.latencies_micros, 1) / 1e3,
+            result.false_presses, result.discarded, result.reseeds);
+        passed = passed && result.detected == result.presses && result.false_presses == 0;
+        total_false += result.false_presses;
+        total_idle_seconds += result.idle_seconds;
+        all_latencies.insert(all_latencies.end(), result.latencies_micros.begin(), result.latencies_micros.end());
+    }
+    printf("\nDetection latency from the start of a press: p50 %.0f ms, p90 %.0f ms, max %.0f ms over %u presses\n",
+        percentile(all_latencies, 0.5) / 1e3, percentile(all_latencies, 0.9) / 1e3,
+        percentile(all_latencies, 1) / 1e3, (unsigned int)all_latencies.size());
+    printf("False presses: %u in %.0f minutes without a press (%.2f per hour)\n", total_false,
+        total_idle_seconds / 60, total_false * 3600 / std::max(total_idle_seconds, 1.0));
+    printf("%s\n", passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,341 @@
+// Golden image test and benchmark for the display drawing code (display_renderer.h, display_layouts.h and widgets.h),
+// built for the host against a SoftwareCanvas. Renders each built-in config as the display first shows it, with the
+// framebuffer at each color depth (SK_DISPLAY_COLOR_DEPTH), and compares the frames, pixel for pixel, against
+// golden/display/config_<id>.png. Then has the knob sweep through each config, out past the endstops and back, over
+// 600 frames, and checks that every frame rendered incrementally (as the display task does) matches redrawing the
+// whole screen; once more switching configs every 15 frames. Then times the renderer following the sweeps: frames per
+// second and pixels drawn per frame, both incrementally and redrawing the whole screen every frame. Last, compares the
+// color depths: the memory each framebuffer takes, and the time rendering and pushing a frame (reading the dirty
+// regions out as RGB565, as TFT_eSprite does to send them) takes. The host's CPU is nothing like the ESP32's, so the
+// timings are only a relative guide; the pixel counts and sizes carry over.
+//
+// Exits non-zero if a frame doesn't match its golden image or full redraw. Those frames are written to the working
+// directory as PNGs. With --update, the golden images are rewritten instead (look at what changed before committing
+// them).
+//
+// Usage: sk_render [--update] [seconds_per_config]
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "builtin_configs.h"
+#include "display_renderer.h"
+#include "rgb_image.h"
+
+#include "font/roboto_light_60.h"
+
+#ifndef GOLDEN_DISPLAY_DIR
+#define GOLDEN_DISPLAY_DIR "golden/display"
+#endif
+
+// One sweep from the middle of a config out past one endstop, across to past the other and back. At the display's
+// usual 60 frames per second that's 10 s, turning a bounded config end to end in 2.5 s.
+static const uint32_t SWEEP_FRAMES = 600;
+// How far past the endstops a bounded config is swept, in positions
+static const float SWEEP_OVERSHOOT_POSITIONS = 1.5;
+// How far either way an unbounded config is swept
+static const float SWEEP_UNBOUNDED_POSITIONS = 20;
+
+// As in DisplayTask
+static const DisplayFonts FONTS = {
+    .value = &Roboto_Light_60,
+    .description = &DESCRIPTION_FONT,
+};
+
+// The framebuffer color depths the display task can be built with (SK_DISPLAY_COLOR_DEPTH)
+static const int8_t COLOR_DEPTHS[] = {16, 4};
+
+// As in DisplayTask
+enum PaletteIndex : uint8_t {
+    PALETTE_BLACK = 0,
+    PALETTE_WHITE,
+    PALETTE_DARKGREY,
+    PALETTE_FILL,
+    PALETTE_DOT,
+};
+
+// What the display task keeps between frames, set up as it does for the given color depth
+struct Display {
+    FillLayout fill_layout;
+    DialLayout dial_layout;
+    DisplayRenderer renderer;
+    SoftwareCanvas canvas;
+    DisplayColors colors;
+
+    Display(int8_t color_depth = 16) : fill_layout(FONTS), dial_layout(FONTS) {
+        canvas.setColorDepth(color_depth);
+        canvas.createSprite(TFT_WIDTH, TFT_HEIGHT);
+        canvas.setTextDatum(CC_DATUM);
+
+        uint16_t fill = canvas.color565(90, 18, 151);
+        uint16_t dot = canvas.color565(80, 100, 200);
+        if (color_depth == 4) {
+            uint16_t palette[16] = {};
+            palette[PALETTE_BLACK] = TFT_BLACK;
+            palette[PALETTE_WHITE] = TFT_WHITE;
+            palette[PALETTE_DARKGREY] = TFT_DARKGREY;
+            palette[PALETTE_FILL] = fill;
+            palette[PALETTE_DOT] = dot;
+            canvas.createPalette(palette, 16);
+            colors = {PALETTE_BLACK, PALETTE_WHITE, PALETTE_DARKGREY, PALETTE_FILL, PALETTE_DOT};
+        } else {
+            colors = {TFT_BLACK, TFT_WHITE, TFT_DARKGREY, fill, dot};
+        }
+    }
+
+    // Returns the number of dirty regions, as DisplayRenderer::render()
+    uint8_t render(const KnobState& state) {
+        renderer.setLayout(state.config.display_layout == DisplayLayout::DIAL ? (Layout*)&dial_layout : &fill_layout);
+        renderer.update(state);
+        return renderer.render(canvas, colors);
+    }
+
+    // As the display task pushes a frame
+    void push(uint8_t dirty_regions) {
+        for (uint8_t i = 0; i < dirty_regions; i++) {
+            const Rect& region = renderer.getDirtyRegion(i);
+            canvas.pushSprite(region.x, region.y, region.x, region.y, region.w, region.h);
+        }
+    }
+};
+
+static KnobState makeState(const KnobConfig& config) {
+    KnobState state = {};
+    state.current_position = config.position;
+    state.config = config;
+    return state;
+}
+
+// The state for a frame of the sweep: the knob at a whole number of positions from where the sweep starts, plus the
+// sub-position, which past an endstop grows without bound
+static KnobState sweepState(const KnobConfig& config, uint32_t frame) {
+    float phase = sinf(2 * M_PI * (frame % SWEEP_FRAMES) / SWEEP_FRAMES);
+    KnobState state = makeState(config);
+    float position;
+    if (config.num_positions > 0) {
+        float middle = (config.num_positions - 1) / 2.0f;
+        position = middle + (middle + SWEEP_OVERSHOOT_POSITIONS) * phase;
+        state.current_position = std::min(std::max((int32_t)lroundf(position), (int32_t)0), config.num_positions - 1);
+    } else {
+        position = config.position + SWEEP_UNBOUNDED_POSITIONS * phase;
+        state.current_position = lroundf(position);
+    }
+    state.sub_position_unit = position - state.current_position;
+    return state;
+}
+
+// Id and descriptor, on one line
+static std::string configName(uint8_t index) {
+    std::string name = std::to_string(index + 1) + " " + BUILTIN_CONFIGS[index].descriptor;
+    std::replace(name.begin(), name.end(), '\n', ' ');
+    return name;
+}
+
+static std::string goldenPath(uint32_t id) {
+    return std::string(GOLDEN_DISPLAY_DIR) + "/config_" + std::to_string(id) + ".png";
+}
+
+struct RenderStats {
+    double frames_per_second;
+    double pixels_per_frame;
+};
+
+// Renders sweeps for at least a while, redrawing only what changed or (if full) the whole screen every frame
+static RenderStats benchmark(const KnobConfig& config, double seconds, bool full) {
+    Display display;
+    display.render(makeState(config));
+    display.canvas.resetStats();
+
+    uint32_t frames = 0;
+    double elapsed = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (elapsed < seconds) {
+        // Whole sweeps, so the pixel counts don't depend on how fast the host is
+        for (uint32_t i = 0; i < SWEEP_FRAMES; i++, frames++) {
+            if (full) {
+                display.renderer.invalidate();
+            }
+            display.render(sweepState(config, frames));
+        }
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    RenderStats stats = {frames / elapsed, (double)display.canvas.getPixelsTouched() / frames};
+    return stats;
+}
+
+static uint32_t countDifferences(const SoftwareCanvas& a, const SoftwareCanvas& b) {
+    uint32_t differences = 0;
+    for (int32_t y = 0; y < a.height(); y++) {
+        for (int32_t x = 0; x < a.width(); x++) {
+            if (a.readPixel(x, y) != b.readPixel(x, y)) {
+                differences++;
+            }
+        }
+    }
+    return differences;
+}
+
+// Renders one sweep incrementally and, alongside, redrawing the whole screen every frame, going through the configs
+// in turn (frames_per_config each), and compares every frame. Returns false (having written both frames to the
+// working directory) at the first that differs.
+static bool compareWithFullRedraws(const std::string& name, const std::string& file_name, const KnobConfig* configs,
+        uint8_t count, uint32_t frames_per_config) {
+    Display incremental;
+    Display full;
+    for (uint32_t frame = 0; frame < SWEEP_FRAMES; frame++) {
+        KnobState state = sweepState(configs[(frame / frames_per_config) % count], frame);
+        incremental.render(state);
+        full.renderer.invalidate();
+        full.render(state);
+
+        uint32_t differences = countDifferences(incremental.canvas, full.canvas);
+        if (differences > 0) {
+            std::string prefix = file_name + "_frame_" + std::to_string(frame);
+            RgbImage::fromCanvas(incremental.canvas).writePng((prefix + ".incremental.png").c_str());
+            RgbImage::fromCanvas(full.canvas).writePng((prefix + ".full.png").c_str());
+            printf("  %-30s FAILED: %u pixels differ in frame %u, see %s.*.png\n", name.c_str(), differences, frame,
+                prefix.c_str());
+            return false;
+        }
+    }
+    printf("  %-30s ok, %.1fx fewer pixels drawn\n", name.c_str(),
+        (double)full.canvas.getPixelsTouched() / incremental.canvas.getPixelsTouched());
+    return true;
+}
+
+static RgbImage renderFirstFrame(const KnobConfig& config, int8_t color_depth) {
+    Display display(color_depth);
+    display.render(makeState(config));
+    return RgbImage::fromCanvas(display.canvas);
+}
+
+struct DepthStats {
+    size_t frame_bytes;
+    double render_micros;
+    double push_micros;
+    double pixels_pushed;
+};
+
+static double seconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+// Sweeps every config in turn, for at least a while, rendering and pushing frames as the display task does; returns
+// the averages per frame
+static DepthStats benchmarkDepth(int8_t color_depth, double min_seconds) {
+    Display display(color_depth);
+    display.canvas.resetStats();
+
+    uint32_t frames = 0;
+    double render_seconds = 0;
+    double push_seconds = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (seconds(std::chrono::steady_clock::now() - start) < min_seconds) {
+        for (uint8_t i = 0; i < BUILTIN_CONFIG_COUNT; i++) {
+            for (uint32_t frame = 0; frame < SWEEP_FRAMES; frame++, frames++) {
+                std::chrono::steady_clock::time_point render_start = std::chrono::steady_clock::now();
+                uint8_t dirty_regions = display.render(sweepState(BUILTIN_CONFIGS[i], frame));
+                std::chrono::steady_clock::time_point push_start = std::chrono::steady_clock::now();
+                display.push(dirty_regions);
+                std::chrono::steady_clock::time_point push_end = std::chrono::steady_clock::now();
+                render_seconds += seconds(push_start - render_start);
+                push_seconds += seconds(push_end - push_start);
+            }
+        }
+    }
+    DepthStats stats = {
+        display.canvas.getFrameBytes(),
+        render_seconds * 1e6 / frames,
+        push_seconds * 1e6 / frames,
+        (double)display.canvas.getPixelsPushed() / frames,
+    };
+    return stats;
+}
+
+int main(int argc, char** argv) {
+    bool update = argc > 1 && strcmp(argv[1], "--update") == 0;
+    int arg = update ? 2 : 1;
+    double seconds_per_config = argc > arg ? atof(argv[arg]) : 1;
+
+    int failures = 0;
+    printf("Golden images (%s), at each color depth\n", GOLDEN_DISPLAY_DIR);
+    for (uint8_t i = 0; i < BUILTIN_CONFIG_COUNT; i++) {
+        const KnobConfig& config = BUILTIN_CONFIGS[i];
+        uint32_t id = i + 1;
+        std::string path = goldenPath(id);
+        std::string name = "config " + std::to_string(id);
+
+        RgbImage golden;
+        if (update) {
+            golden = renderFirstFrame(config, 16);
+            if (!golden.writePng(path.c_str())) {
+                printf("  %-12s FAILED to write %s\n", name.c_str(), path.c_str());
+                failures++;
+                continue;
+            }
+        } else if (!golden.readPng(path.c_str())) {
+            printf("  %-12s FAILED: can't read %s\n", name.c_str(), path.c_str());
+            failures++;
+            continue;
+        }
+
+        bool matched = true;
+        for (int8_t depth : COLOR_DEPTHS) {
+            RgbImage frame = renderFirstFrame(config, depth);
+            uint32_t differences = frame.countDifferences(golden);
+            if (differences > 0) {
+                std::string actual_path = "config_" + std::to_string(id) + "_" + std::to_string(depth) + "bit.actual.png";
+                frame.writePng(actual_path.c_str());
+                printf("  %-12s FAILED: %u pixels differ at %d-bit, see %s\n", name.c_str(), differences, depth,
+                    actual_path.c_str());
+                failures++;
+                matched = false;
+                break;
+            }
+        }
+        if (matched) {
+            printf("  %-12s %s\n", name.c_str(), update ? "updated" : "ok");
+        }
+    }
+
+    printf("\nIncremental rendering vs. full redraws (%u frames)\n", SWEEP_FRAMES);
+    for (uint8_t i = 0; i < BUILTIN_CONFIG_COUNT; i++) {
+        std::string file_name = "config_" + std::to_string(i + 1);
+        failures += compareWithFullRedraws(configName(i), file_name, &BUILTIN_CONFIGS[i], 1, SWEEP_FRAMES) ? 0 : 1;
+    }
+    // Switching between layouts and configs mid-turn
+    failures += compareWithFullRedraws("switching configs", "switching", BUILTIN_CONFIGS, BUILTIN_CONFIG_COUNT,
+        SWEEP_FRAMES / 40) ? 0 : 1;
+
+    printf("\nSweeping each config (%.1f s each)\n", seconds_per_config);
+    printf("  %-30s %26s  %26s\n", "", "incremental", "full redraw");
+    printf("  %-30s %12s %13s  %12s %13s\n", "config", "frames/s", "pixels/frame", "frames/s", "pixels/frame");
+    for (uint8_t i = 0; i < BUILTIN_CONFIG_COUNT; i++) {
+        const KnobConfig& config = BUILTIN_CONFIGS[i];
+        std::string name = configName(i);
+        RenderStats incremental = benchmark(config, seconds_per_config / 2, false);
+        RenderStats full = benchmark(config, seconds_per_config / 2, true);
+        printf("  %-30s %12.0f %13.0f  %12.0f %13.0f\n", name.c_str(), incremental.frames_per_second,
+            incremental.pixels_per_frame, full.frames_per_second, full.pixels_per_frame);
+    }
+
+    printf("\nColor depth (every config swept in turn, %.1f s each)\n", seconds_per_config);
+    printf("  %-8s %12s %16s %14s %20s\n", "depth", "frame bytes", "render us/frame", "push us/frame",
+        "pixels pushed/frame");
+    for (int8_t depth : COLOR_DEPTHS) {
+        DepthStats stats = benchmarkDepth(depth, seconds_per_config);
+        std::string name = std::to_string(depth) + "-bit";
+        printf("  %-8s %12zu %16.2f %14.2f %20.0f\n", name.c_str(), stats.frame_bytes, stats.render_micros,
+            stats.push_micros, stats.pixels_pushed);
+    }
+
+    if (failures > 0) {
+        printf("\n%d FAILED\n", failures);
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+// Runs the firmware as a Linux process, paced to real time, with its serial port on a pseudo-terminal whose path is
+// printed at startup (e.g. for skctl). The knob can be turned from stdin: "+" and "-" step the hand a quarter turn.
+//
+// Usage: sk_sim [speed]
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#ifndef PARTITIONS_CSV
+#define PARTITIONS_CSV "partitions.csv"
+#endif
+
+void setup();
+void loop();
+
+int main(int argc, char** argv) {
+    double speed = argc > 1 ? atof(argv[1]) : 1;
+    if (speed <= 0) {
+        fprintf(stderr, "Speed must be positive\n");
+        return 1;
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("pty");
+        return 1;
+    }
+    struct termios tty;
+    tcgetattr(master, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(master, TCSANOW, &tty);
+    printf("Serial port: %s\n", ptsname(master));
+    fflush(stdout);
+
+    SimOptions options;
+    options.speed = speed;
+    options.serial_fd = master;
+    options.partitions_path = PARTITIONS_CSV;
+    Simulation::start(setup, loop, options);
+
+    SimPlant& plant = Simulation::plant();
+    float hand_angle = 0;
+    plant.grab();
+    int c;
+    while ((c = getchar()) != EOF) {
+        if (c == '+' || c == '-') {
+            hand_angle += (c == '+' ? 1 : -1) * M_PI / 2;
+            plant.turnTo(hand_angle, 250000);
+        }
+    }
+
+    // The firmware's tasks never return, so leave without running static destructors under them
+    fflush(stdout);
+    _exit(0);
+}
@@ -0,0 +1,332 @@
+// Integration test and benchmark for the simulated firmware (see sim/include/sim.h): boots the whole firmware, checks
+// the display and LEDs came up, talks to it with KnobClient over a pseudo-terminal while a simulated hand turns the
+// knob, checks that flash erases and writes (which stall the whole chip) and holding the knob against an endstop don't
+// trip the motor supervisor (which should scale the voltage down instead), and then runs it unpaced with the knob
+// sweeping back and forth to measure how fast the firmware runs on the host, where the CPU time goes and how long knob
+// states take through the pipeline. Finally spins the knob like a runaway motor would, which should trip the motor
+// supervisor and freeze the flight recorder, and prints the heap report. The simulation is built to abort if a task
+// allocates once it is set up (see heap_monitor.h). Exits non-zero if any check fails.
+//
+// Usage: sk_sim_test [benchmark_seconds] [screenshot.png]
+
+#include <chrono>
+#include <string>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "flight_recorder.h"
+#include "knob_client.h"
+#include "motor_supervisor.h"
+#include "rgb_image.h"
+#include "sim.h"
+#include "software_canvas.h"
+
+#ifndef PARTITIONS_CSV
+#define PARTITIONS_CSV "partitions.csv"
+#endif
+
+void setup();
+void loop();
+
+// Built-in "Coarse values / Strong detents" config: 32 positions, 8.23 degrees apart
+static const uint32_t DETENT_CONFIG_ID = 8;
+static const float DETENT_WIDTH_RADIANS = 8.225806452 * M_PI / 180;
+// Id for a second config in the uploaded library
+static const uint32_t OTHER_CONFIG_ID = 100;
+
+static int failures = 0;
+
+static void check(const char* name, bool passed) {
+    printf("%-40s %s\n", name, passed ? "ok" : "FAILED");
+    if (!passed) {
+        failures++;
+    }
+}
+
+static double wallSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs the unpaced simulation in slices, draining the serial port in between so the firmware never blocks on a full
+// pseudo-terminal
+static void runDraining(KnobClient& client, uint64_t until_micros) {
+    while (Simulation::micros() < until_micros) {
+        Simulation::runUntil(std::min<uint64_t>(until_micros, Simulation::micros() + 100000));
+        client.poll(0);
+    }
+}
+
+// Handles input from the (real-time) simulation for a while
+static void pollFor(KnobClient& client, int millis) {
+    double end = wallSeconds() + millis / 1000.0;
+    while (wallSeconds() < end) {
+        client.poll(10);
+    }
+}
+
+static uint64_t countWakes(const std::vector<SimTaskStats>& stats, const char* name) {
+    for (const SimTaskStats& task : stats) {
+        if (task.name == name) {
+            return task.wakes;
+        }
+    }
+    return 0;
+}
+
+static uint32_t countLitPixels(const SoftwareCanvas* panel) {
+    uint32_t lit = 0;
+    for (int32_t y = 0; y < panel->height(); y++) {
+        for (int32_t x = 0; x < panel->width(); x++) {
+            if (panel->readPixel(x, y) != TFT_BLACK) {
+                lit++;
+            }
+        }
+    }
+    return lit;
+}
+
+int main(int argc, char** argv) {
+    int benchmark_seconds = argc > 1 ? atoi(argv[1]) : 10;
+    const char* screenshot_path = argc > 2 ? argv[2] : nullptr;
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("pty");
+        return 1;
+    }
+    struct termios tty;
+    tcgetattr(master, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(master, TCSANOW, &tty);
+    const char* slave_path = ptsname(master);
+
+    SerialPort port;
+    if (!port.open(slave_path, 115200)) {
+        fprintf(stderr, "Failed to open %s\n", slave_path);
+        return 1;
+    }
+    KnobClient client(port);
+    int32_t position = 0;
+    int32_t num_positions = 0;
+    uint32_t states = 0;
+    client.on_state = [&](const StateMessage& state) {
+        position = state.current_position;
+        num_positions = state.num_positions;
+        states++;
+    };
+    std::string text;
+    client.on_text = [&](const std::string& line) {
+        text += line;
+    };
+
+    SimOptions options;
+    options.serial_fd = master;
+    options.partitions_path = PARTITIONS_CSV;
+    Simulation::start(setup, loop, options);
+
+    // Boot, unpaced, past the motor task's 3 second wait for a calibration request
+    runDraining(client, 4000000);
+    const SoftwareCanvas* panel = Simulation::display();
+    check("display pushed", panel != nullptr && Simulation::getDisplayPushCount() > 0);
+    check("display shows something", panel != nullptr && countLitPixels(panel) > 0);
+    check("backlight on", Simulation::getLedcDuty(0) > 0);
+    check("leds shown", Simulation::getLedCount() == 8 && Simulation::getLedShowCount() > 0);
+
+    // With the knob at rest and nothing streaming, the interface task only wakes for its own jobs (the position
+    // check, 4 times a second): serial input and the motor watchdog don't need it
+    std::vector<SimTaskStats> idle_before;
+    std::vector<SimTaskStats> idle_after;
+    Simulation::getTaskStats(idle_before);
+    runDraining(client, Simulation::micros() + 2000000);
+    Simulation::getTaskStats(idle_after);
+    uint64_t idle_wakes = countWakes(idle_after, "Interface") - countWakes(idle_before, "Interface");
+    check("interface task sleeps at rest", idle_wakes <= 2 * 5);
+
+    // Talk to it in real time, like a host would
+    Simulation::setSpeed(1);
+    Simulation::resume();
+    AckStatus status;
+    check("ping", client.ping(status) && status == AckStatus::OK);
+    check("select detent config", client.selectConfig(DETENT_CONFIG_ID, status) && status == AckStatus::OK);
+    check("start streaming", client.setStream({10, 0}, status) && status == AckStatus::OK);
+    pollFor(client, 200);
+    int32_t start_position = position;
+    uint32_t start_states = states;
+
+    SimPlant& plant = Simulation::plant();
+    float start_angle = plant.getAngle();
+    plant.grab();
+    // Detents only snap over past the snap point (1.1 widths), so the hand turns half a detent further each way
+    plant.turnTo(start_angle + 5.5f * DETENT_WIDTH_RADIANS, 500000);
+    pollFor(client, 1000);
+    int32_t turned_position = position;
+    check("states streamed", states - start_states > 50);
+    check("turning moves five detents", abs(turned_position - start_position) == 5);
+
+    plant.turnTo(start_angle - 0.5f * DETENT_WIDTH_RADIANS, 500000);
+    pollFor(client, 1000);
+    check("turning back returns", position == start_position);
+
+    // Erasing and writing flash stalls everything, motor loop included (the simulated flash takes as long as the
+    // real one), which the supervisor has to let pass: upload a library with the same config (erasing a sector),
+    // then turn the knob a detent and let it rest until the position is written
+    ConfigRecord records[] = {
+        {DETENT_CONFIG_ID, {32, 0, DETENT_WIDTH_RADIANS, 2, 10, 1.1, "Coarse values\nStrong detents",
+            DisplayLayout::DIAL, LedEffect::POSITION}},
+        {OTHER_CONFIG_ID, {0, 0, 10 * PI / 180, 0, 1, 1.1, "Unbounded\nNo detents", DisplayLayout::DIAL,
+            LedEffect::POSITION}},
+    };
+    check("upload config library", client.uploadConfigLibrary(records, 2, status) && status == AckStatus::OK);
+    check("select uploaded config", client.selectConfig(DETENT_CONFIG_ID, status) && status == AckStatus::OK);
+    // Too big for the partition, so refused before anything is erased, and the selected config stays
+    std::vector<ConfigRecord> oversized(500, records[0]);
+    check("oversized library is rejected", client.uploadConfigLibrary(oversized.data(), oversized.size(), status)
+        && status == AckStatus::INVALID);
+    pollFor(client, 200);
+    check("config kept", num_positions == 32);
+    start_position = position;
+    plant.turnTo(start_angle + 1.5f * DETENT_WIDTH_RADIANS, 300000);
+    pollFor(client, 500);
+    check("turning moves a detent", abs(position - start_position) == 1);
+    // Switching away and back before the knob has rested leaves the position unsaved, but not lost
+    int32_t turned = position;
+    uint32_t flash_writes = Simulation::getFlashWriteCount();
+    check("select another config", client.selectConfig(OTHER_CONFIG_ID, status) && status == AckStatus::OK);
+    check("select it again", client.selectConfig(DETENT_CONFIG_ID, status) && status == AckStatus::OK);
+    pollFor(client, 200);
+    check("switching configs doesn't write flash", Simulation::getFlashWriteCount() == flash_writes);
+    check("unsaved position kept", position == turned);
+    Simulation::setSpeed(0);
+    runDraining(client, Simulation::micros() + 4000000);
+    Simulation::setSpeed(1);
+    Simulation::resume();
+    check("ping", client.ping(status) && status == AckStatus::OK);
+    check("position saved once at rest", Simulation::getFlashWriteCount() > flash_writes);
+    check("flash stalls don't trip the supervisor", text.find("Motor fault") == std::string::npos);
+
+    // Pushing past an endstop (more detents than the config has) drives the motor at its full 5V, which the heat
+    // budget allows for about 8 seconds before the supervisor starts scaling the voltage down. Hold it there for 20
+    // (counting the quick turns there and back), by when it should be down to the continuous rating, then let go.
+    Simulation::setSpeed(0);
+    plant.turnTo(start_angle - 40 * DETENT_WIDTH_RADIANS, 200000);
+    runDraining(client, Simulation::micros() + 1000000);
+    float endstop_voltage = fabsf(plant.getVoltage());
+    runDraining(client, Simulation::micros() + 18600000);
+    float derated_voltage = fabsf(plant.getVoltage());
+    plant.turnTo(start_angle, 200000);
+    runDraining(client, Simulation::micros() + 1000000);
+    Simulation::setSpeed(1);
+    Simulation::resume();
+    check("ping", client.ping(status) && status == AckStatus::OK);
+    check("endstop held at full voltage", endstop_voltage > 4.9f);
+    check("voltage scaled down after 20 s", derated_voltage < CONTINUOUS_VOLTAGE + 0.1f);
+    check("holding the endstop doesn't trip", text.find("Motor fault") == std::string::npos);
+
+    uint32_t uploads = Simulation::getDisplayPushCount();
+    if (screenshot_path != nullptr) {
+        Simulation::runFor(0);
+        check("screenshot written", RgbImage::fromCanvas(*panel).writePng(screenshot_path));
+    }
+
+    // Benchmark: unpaced, still streaming state, with the hand sweeping the knob four detents back and forth every half
+    // second. The sweep stays clear of the endstop just held: pushing into it again so soon would use up the rest of
+    // the heat budget.
+    std::vector<LatencyMessage> latencies;
+    check("reset latency", client.getLatency(latencies, true, status) && status == AckStatus::OK);
+    Simulation::setSpeed(0);
+    Simulation::runFor(0);
+    std::vector<SimTaskStats> before;
+    std::vector<SimTaskStats> after;
+    Simulation::getTaskStats(before);
+    uint32_t pushes_before = Simulation::getDisplayPushCount();
+    uint32_t shows_before = Simulation::getLedShowCount();
+    uint64_t bench_start = Simulation::micros();
+    double wall_start = wallSeconds();
+    for (int i = 0; i < benchmark_seconds * 2; i++) {
+        plant.turnTo(start_angle + (i % 2 == 0 ? 5 : 1) * DETENT_WIDTH_RADIANS, 400000);
+        runDraining(client, bench_start + (i + 1) * 500000ULL);
+    }
+    double wall = wallSeconds() - wall_start;
+    double simulated = (Simulation::micros() - bench_start) / 1e6;
+    Simulation::getTaskStats(after);
+    check("display kept up", Simulation::getDisplayPushCount() > uploads);
+
+    printf("\n%.1f s simulated in %.2f s (%.1fx real time), %.0f display pushes/s, %.0f led frames/s\n",
+        simulated, wall, simulated / wall,
+        (Simulation::getDisplayPushCount() - pushes_before) / simulated,
+        (Simulation::getLedShowCount() - shows_before) / simulated);
+    printf("%-14s %4s %14s %8s\n", "task", "prio", "host cpu ms/s", "wakes/s");
+    for (const SimTaskStats& task : after) {
+        double cpu_before = 0;
+        uint64_t wakes_before = 0;
+        for (const SimTaskStats& earlier : before) {
+            if (earlier.name == task.name) {
+                cpu_before = earlier.cpu_seconds;
+                wakes_before = earlier.wakes;
+            }
+        }
+        printf("%-14s %4u %14.2f %8.0f\n", task.name.c_str(), task.priority, (task.cpu_seconds - cpu_before) * 1000 / simulated,
+            (task.wakes - wakes_before) / simulated);
+    }
+    printf("\n");
+
+    // Virtual time doesn't advance while code runs, so these only cover the waits between pipeline stages
+    Simulation::setSpeed(1);
+    Simulation::resume();
+    check("latency histograms", client.getLatency(latencies, false, status) && status == AckStatus::OK
+        && latencies.size() == (size_t)LatencyPath::COUNT);
+    bool all_sampled = true;
+    printf("%-18s %8s %8s %8s %8s\n", "latency", "samples", "p50 us", "p99 us", "max us");
+    for (const LatencyMessage& latency : latencies) {
+        all_sampled = all_sampled && latencySampleCount(latency) > 0;
+        printf("%-18s %8u %8u %8u %8u\n", latencyPathName(latency.path), latencySampleCount(latency),
+            latencyPercentileMicros(latency, 0.5), latencyPercentileMicros(latency, 0.99), latency.max_micros);
+    }
+    printf("\n");
+    check("every latency path sampled", all_sampled);
+    Simulation::setSpeed(0);
+    Simulation::runFor(0);
+
+    // Well over the velocity limit for longer than the supervisor allows
+    check("no motor fault yet", text.find("Motor fault") == std::string::npos);
+    uint64_t spin_start = Simulation::micros();
+    plant.turnTo(plant.getAngle() + 150, 1500000);
+    runDraining(client, spin_start + 2000000);
+
+    // Text is only passed through once a frame follows it, which the ACK provides
+    Simulation::setSpeed(1);
+    Simulation::resume();
+    check("stop streaming", client.setStream({0, 0}, status) && status == AckStatus::OK);
+    check("spinning trips the supervisor", text.find("Motor fault: over velocity") != std::string::npos);
+
+    FlightRecording recording;
+    check("download flight recording", client.getRecording(recording, true, status) && status == AckStatus::OK);
+    uint32_t healthy_samples = 0;
+    uint32_t faulted_samples = 0;
+    for (const FlightRecord& record : recording.records) {
+        if (record.type == FlightRecordType::SAMPLE) {
+            (record.detail == 0 ? healthy_samples : faulted_samples)++;
+        }
+    }
+    printf("Flight recording: %u records, frozen by %s at %u ms, %u samples before the fault and %u after\n",
+        (unsigned int)recording.records.size(), flightFreezeReasonName(recording.reason), recording.freeze_millis,
+        healthy_samples, faulted_samples);
+    check("recorder frozen by the fault", recording.reason == FlightFreezeReason::MOTOR_FAULT
+        && recording.records.size() == SK_FLIGHT_RECORDER_RECORDS);
+    check("recording spans the fault", healthy_samples > 0 && faulted_samples > 0);
+
+    // The simulation aborts on any allocation by a task past its setup, so getting here means there were none
+    check("heap report", client.sendCommand(CommandId::LOG_HEAP, status) && status == AckStatus::OK);
+    pollFor(client, 100);
+    check("ping", client.ping(status) && status == AckStatus::OK);
+    check("allocations counted per task", text.find("Heap Motor: ") != std::string::npos);
+    printf("%s", text.substr(text.rfind('\n', text.find("Heap: ")) + 1).c_str());
+
+    // The firmware's tasks never return, so leave without running static destructors under them
+    fflush(stdout);
+    _exit(failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,159 @@
+// Command line client for a knob running the framed serial protocol.
+//
+// Usage: skctl <port> <command> [args]
+//   ping
+//   next | prev
+//   click
+//   stacks   (prints each task's peak stack usage)
+//   profile  (prints CPU time per profiled section since the last report)
+//   heap     (prints heap use, peak and fragmentation, and allocations per task)
+//   latency [reset]   (prints sensor-to-torque and sensor-to-pixels latency percentiles and histograms)
+//   recorder freeze | dump [clear]   (freezes the flight recorder, or prints its capture as CSV)
+//   select <config_id>
+//   config <num_positions> <position> <width_degrees> <detent_strength> <endstop_strength> <snap_point> <descriptor>
+//   stream <state_interval_millis> [telemetry_interval_millis]   (prints until interrupted)
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knob_client.h"
+
+static const uint32_t BAUD = 115200;
+
+static int usage() {
+    fprintf(stderr, "usage: skctl <port> ping|next|prev|click|stacks|profile|heap|latency [reset]|recorder freeze|dump [clear]|select <id>|config ...|stream <state_ms> [telemetry_ms]\n");
+    return 2;
+}
+
+static int report(bool acked, AckStatus status) {
+    if (!acked) {
+        fprintf(stderr, "No response\n");
+        return 1;
+    }
+    if (status != AckStatus::OK) {
+        fprintf(stderr, "Rejected (status %d)\n", (int)status);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        return usage();
+    }
+
+    SerialPort port;
+    if (!port.open(argv[1], BAUD)) {
+        fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return 1;
+    }
+    KnobClient client(port);
+    client.on_text = [](const std::string& text) {
+        fputs(text.c_str(), stderr);
+    };
+
+    const char* command = argv[2];
+    AckStatus status = AckStatus::OK;
+    if (strcmp(command, "ping") == 0) {
+        return report(client.ping(status), status);
+    } else if (strcmp(command, "next") == 0) {
+        return report(client.sendCommand(CommandId::NEXT_CONFIG, status), status);
+    } else if (strcmp(command, "prev") == 0) {
+        return report(client.sendCommand(CommandId::PREVIOUS_CONFIG, status), status);
+    } else if (strcmp(command, "click") == 0) {
+        return report(client.sendCommand(CommandId::HAPTIC_PRESS, status), status);
+    } else if (strcmp(command, "stacks") == 0 || strcmp(command, "profile") == 0 || strcmp(command, "heap") == 0) {
+        client.on_text = [](const std::string& text) {
+            fputs(text.c_str(), stdout);
+        };
+        CommandId log_command = strcmp(command, "stacks") == 0 ? CommandId::LOG_STACKS
+            : strcmp(command, "profile") == 0 ? CommandId::LOG_PROFILE : CommandId::LOG_HEAP;
+        if (report(client.sendCommand(log_command, status), status) != 0) {
+            return 1;
+        }
+        // The report is logged as text, which is only recognized once the next frame arrives
+        client.poll(200);
+        return report(client.ping(status), status);
+    } else if (strcmp(command, "latency") == 0) {
+        std::vector<LatencyMessage> latencies;
+        bool reset = argc > 3 && strcmp(argv[3], "reset") == 0;
+        if (report(client.getLatency(latencies, reset, status), status) != 0) {
+            return 1;
+        }
+        printf("%-18s %8s %8s %8s %8s %8s   histogram (from <64 us, doubling)\n", "path", "samples", "p50 us", "p90 us", "p99 us", "max us");
+        for (const LatencyMessage& latency : latencies) {
+            printf("%-18s %8u %8u %8u %8u %8u  ", latencyPathName(latency.path), latencySampleCount(latency),
+                latencyPercentileMicros(latency, 0.5), latencyPercentileMicros(latency, 0.9),
+                latencyPercentileMicros(latency, 0.99), latency.max_micros);
+            for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+                printf(" %u", latency.buckets[i]);
+            }
+            printf("\n");
+        }
+        return 0;
+    } else if (strcmp(command, "recorder") == 0) {
+        if (argc > 3 && strcmp(argv[3], "freeze") == 0) {
+            return report(client.sendCommand(CommandId::FREEZE_RECORDING, status), status);
+        }
+        if (argc < 4 || strcmp(argv[3], "dump") != 0) {
+            return usage();
+        }
+        FlightRecording recording;
+        bool clear = argc > 4 && strcmp(argv[4], "clear") == 0;
+        if (report(client.getRecording(recording, clear, status), status) != 0) {
+            return 1;
+        }
+        printf("# frozen: %s at %u ms\n", flightFreezeReasonName(recording.reason), recording.freeze_millis);
+        printf("millis,type,angle_rad,velocity_rad_s,torque_v,position,detail\n");
+        for (const FlightRecord& record : recording.records) {
+            printf("%u,%s,%.4f,%.2f,%.2f,%d,%u\n", record.millis, flightRecordTypeName(record.type), record.angle_radians,
+                record.velocity_centiradians / 100.0, record.torque_centivolts / 100.0, record.position, record.detail);
+        }
+        return 0;
+    } else if (strcmp(command, "select") == 0) {
+        if (argc != 4) {
+            return usage();
+        }
+        return report(client.selectConfig(strtoul(argv[3], nullptr, 0), status), status);
+    } else if (strcmp(command, "config") == 0) {
+        if (argc != 10) {
+            return usage();
+        }
+        KnobConfig config = {};
+        config.num_positions = atoi(argv[3]);
+        config.position = atoi(argv[4]);
+        config.position_width_radians = atof(argv[5]) * M_PI / 180;
+        config.detent_strength_unit = atof(argv[6]);
+        config.endstop_strength_unit = atof(argv[7]);
+        config.snap_point = atof(argv[8]);
+        strncpy(config.descriptor, argv[9], sizeof(config.descriptor) - 1);
+        return report(client.setConfig(config, status), status);
+    } else if (strcmp(command, "stream") == 0) {
+        if (argc < 4) {
+            return usage();
+        }
+        StreamMessage stream = {
+            (uint16_t)atoi(argv[3]),
+            (uint16_t)(argc > 4 ? atoi(argv[4]) : 0),
+        };
+        client.on_state = [](const StateMessage& state) {
+            printf("state %u: position %d %+.3f (%+.2f/s) config %u\n", state.timestamp_micros, state.current_position,
+                state.sub_position_unit, state.sub_position_velocity_unit, state.config_index);
+        };
+        client.on_telemetry = [](const TelemetryMessage& telemetry) {
+            printf("telemetry %u: press %u (%.2f) lux %.3f heap %u\n", telemetry.uptime_millis, telemetry.press_level,
+                telemetry.press_value_unit, telemetry.lux, telemetry.free_heap);
+        };
+        if (report(client.setStream(stream, status), status) != 0) {
+            return 1;
+        }
+        while (client.poll(1000)) {
+            fflush(stdout);
+        }
+        return 1;
+    }
+    return usage();
+}